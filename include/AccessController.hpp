@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -7,6 +8,8 @@
 
 #include "Forward.hpp"
 #include "EventhubBase.hpp"
+#include "TopicMatcher.hpp"
+#include "TokenCache.hpp"
 #include "jwt/jwt.hpp"
 
 namespace eventhub {
@@ -28,33 +31,65 @@ struct NoRateLimitForTopic : public std::exception {
 class RateLimitConfig final {
   private:
     std::vector<rlimit_config_t> _limitConfigs;
+    TopicMatcher _matcher;
 
   public:
     bool loadFromJSON(const nlohmann::json::array_t& config);
-    const rlimit_config_t getRateLimitForTopic(const std::string& topic);
+    const rlimit_config_t getRateLimitForTopic(const std::string& topic) const;
+    const rlimit_config_t* findRateLimitForTopic(const std::string& topic) const;
 };
 
+/**
+ * What a verified token grants, with the ACLs compiled for matching.
+ * Immutable once created, connections authenticated with the same token
+ * share it through the TokenCache.
+ */
+struct TokenPermissions {
+  std::string subject;
+  TopicMatcher publishAcl;
+  TopicMatcher subscribeAcl;
+  RateLimitConfig rlimit;
+  int64_t expires = 0; // Unix time, 0 if the token doesn't expire.
+};
+
+/**
+ * Permissions of a connection. Only what is extracted from the token is
+ * kept, not the decoded token itself.
+ *
+ * The ACLs are compiled into a TopicMatcher when the token is loaded, and
+ * the last few decisions are remembered per topic.
+ */
 class AccessController final : public EventhubBase {
 private:
+  enum class Verdict : uint8_t { UNKNOWN, ALLOW, DENY };
+
+  struct TopicDecision {
+    std::string topic;
+    std::size_t hash;
+    uint64_t lastUse;
+    Verdict publish;
+    Verdict subscribe;
+  };
+
   bool _token_loaded;
-  std::string _jwt_secret;
-  std::string _subject;
-  jwt::jwt_object _token;
-  std::vector<std::string> _publish_acl;
-  std::vector<std::string> _subscribe_acl;
-  RateLimitConfig _rlimit;
+  bool _auth_disabled;
+  TokenPermissionsPtr _permissions;
+  std::vector<TopicDecision> _decisions;
+  uint64_t _decision_clock;
+
+  TopicDecision& _getDecision(const std::string& topic);
+  static TokenPermissionsPtr _verifyToken(const std::string& jwtToken, const std::string& secret);
 
 public:
-  AccessController(Config &cfg) :
-    EventhubBase(cfg), _token_loaded(false), _subject("") {};
+  AccessController(Config &cfg);
 
-  bool authenticate(const std::string& jwtToken, const std::string& secret);
+  bool authenticate(const std::string& jwtToken, const std::string& secret, TokenCache* tokenCache = nullptr);
   bool isAuthenticated();
   bool allowPublish(const std::string& topic);
   bool allowSubscribe(const std::string& topic);
   bool allowCreateToken(const std::string& path);
   const std::string& subject();
-  RateLimitConfig& getRateLimitConfig() { return _rlimit; };
+  const RateLimitConfig& getRateLimitConfig();
 };
 
 } // namespace eventhub
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+namespace eventhub {
+
+/**
+ * Monotonic allocator for memory that only lives as long as one request.
+ *
+ * Allocations bump a cursor through a chunk and are never freed one by one,
+ * the whole arena is rewound with reset() when the request is done. When a
+ * request needed more than one chunk the chunks are merged into one on reset,
+ * so after a few requests the arena has grown to fit and stops calling
+ * malloc(). What is kept between requests is capped at maxRetained bytes, so
+ * one large request doesn't pin its memory for the life of the arena.
+ *
+ * An arena is made current for the calling thread with Arena::Scope, which
+ * also resets it on the way out. ArenaAllocator picks up the current arena.
+ */
+class Arena final {
+public:
+  class Scope final {
+  public:
+    explicit Scope(Arena& arena);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Arena& _arena;
+    Arena* _previous;
+  };
+
+  Arena(std::size_t chunkSize, std::size_t maxRetained);
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+  void reset();
+
+  std::size_t getCapacity() const { return _capacity; }
+  std::size_t getChunkCount() const { return _chunk_count; }
+
+  static Arena* current();
+
+private:
+  struct Chunk {
+    Chunk* next;
+    std::size_t size;
+  };
+
+  std::size_t _chunk_size;
+  std::size_t _max_retained;
+  Chunk* _chunks;
+  char* _cursor;
+  char* _end;
+  std::size_t _capacity;
+  std::size_t _chunk_count;
+
+  void _addChunk(std::size_t minSize);
+  void _freeChunks();
+};
+
+/**
+ * Standard allocator that takes memory from an arena. Without an arena, as
+ * when used outside of an Arena::Scope, it falls back to the heap.
+ */
+template <class T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator() : _arena(Arena::current()) {}
+  explicit ArenaAllocator(Arena* arena) : _arena(arena) {}
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.getArena()) {}
+
+  T* allocate(std::size_t n) {
+    if (_arena != nullptr) {
+      return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t) {
+    if (_arena == nullptr) {
+      ::operator delete(p);
+    }
+  }
+
+  Arena* getArena() const { return _arena; }
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U>& other) const { return _arena == other.getArena(); }
+
+  template <class U>
+  bool operator!=(const ArenaAllocator<U>& other) const { return _arena != other.getArena(); }
+
+private:
+  Arena* _arena;
+};
+
+// String that lives in the current arena. Must not outlive its Arena::Scope.
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+} // namespace eventhub
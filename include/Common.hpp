@@ -33,6 +33,89 @@ static constexpr unsigned int METRIC_DELAY_SAMPLE_RATE_MS = 5000;
 // Cache purger interval.
 static constexpr unsigned int CACHE_PURGER_INTERVAL_MS = (60 * 1000);
 
+// Interval between each slice of the websocket/SSE ping sweep.
+static constexpr unsigned int PING_SWEEP_INTERVAL_MS = 100;
+
+// Hangup websocket connection if no PONG has been received in this many ping intervals.
+static constexpr unsigned int PING_MAX_MISSED_PONGS = 3;
+
+// Each millisecond of event loop delay counts as this many connections in the worker load score.
+static constexpr unsigned int LOAD_EVENTLOOP_DELAY_WEIGHT = 100;
+
+// Published batches each worker keeps to catch up connections migrated to it.
+static constexpr std::size_t MIGRATION_REPLAY_BATCHES = 64;
+
+// Submission queue entries of a worker io_uring. The completion queue is URING_CQ_FACTOR times larger
+// since multishot requests produce many completions.
+static constexpr unsigned int URING_ENTRIES   = 4096;
+static constexpr unsigned int URING_CQ_FACTOR = 4;
+
+// Provided receive buffers per worker io_uring. The count must be a power of two.
+static constexpr unsigned int URING_RECV_BUFFER_COUNT = 512;
+static constexpr unsigned int URING_RECV_BUFFER_SIZE  = 4096;
+
+// Sends at least this large use zero-copy SEND_ZC when the kernel supports it.
+static constexpr std::size_t URING_SEND_ZC_THRESHOLD = 16 * 1024;
+
+// Packets the kernel may process per NAPI busy poll of a worker epoll instance (kernel default).
+static constexpr unsigned int EPOLL_BUSY_POLL_BUDGET = 8;
+
+// Max messages a worker queues for fan-out. A publish to a full queue
+// delivers queued messages first, holding up the worker's jobs.
+static constexpr std::size_t FANOUT_QUEUE_MAX_MESSAGES = 100000;
+
+// Deliveries a publish to a full fan-out queue makes at a time until there is room again.
+static constexpr std::size_t FANOUT_DRAIN_SUBSCRIBERS = 256;
+
+// Shards of the process wide topic name table, each with its own lock.
+static constexpr std::size_t TOPIC_REGISTRY_SHARDS = 16;
+
+// Size of the slabs connection objects are pooled in. Slabs are aligned to their size.
+static constexpr std::size_t SLAB_POOL_SLAB_SIZE = 64 * 1024;
+
+// Size of the chunks the per-request arena of a worker grows by.
+static constexpr std::size_t RPC_ARENA_CHUNK_SIZE = 16 * 1024;
+
+// Most memory the per-request arena of a worker keeps between requests.
+static constexpr std::size_t RPC_ARENA_MAX_RETAINED = 4 * RPC_ARENA_CHUNK_SIZE;
+
+// Largest message buffer a decoded RPC request keeps between requests.
+static constexpr std::size_t RPC_REQUEST_MESSAGE_KEEP_SIZE = 16 * 1024;
+
+// Number of topics a connection remembers its ACL decisions for.
+static constexpr std::size_t ACL_DECISION_CACHE_SIZE = 8;
+
+// Number of shards in the cache of verified tokens.
+static constexpr std::size_t TOKEN_CACHE_SHARDS = 16;
+
+// Max rate limit patterns that get a throttle counter of their own in the metrics.
+static constexpr std::size_t RATE_LIMIT_METRIC_MAX_PATTERNS = 100;
+
+// Room the slow consumer high watermark leaves below NET_WRITE_BUFFER_MAX, so a client
+// just below the watermark can take one more message without being disconnected.
+static constexpr std::size_t SLOW_CONSUMER_WATERMARK_HEADROOM = (1024 * 1000) * 2;
+
+// Max topics that get slow consumer counters of their own in the metrics.
+static constexpr std::size_t SLOW_CONSUMER_METRIC_MAX_TOPICS = 100;
+
+// How often workers make their per topic slow consumer counters visible to the metrics.
+static constexpr unsigned int SLOW_CONSUMER_METRIC_PUBLISH_INTERVAL_MS = 1000;
+
+// Max topics listed in the gap notification sent to a client that was paused.
+static constexpr std::size_t SLOW_CONSUMER_GAP_MAX_TOPICS = 64;
+
+// How often workers check that the output waiting to be sent is within budget.
+static constexpr unsigned int OUTPUT_BUDGET_CHECK_INTERVAL_MS = 100;
+
+// The slow consumer high watermark is divided by this while the output budget is exceeded.
+static constexpr std::size_t OUTPUT_BUDGET_WATERMARK_DIVISOR = 4;
+
+// Number of shards in the node-local rate limit buckets.
+static constexpr std::size_t LOCAL_RATE_LIMIT_SHARDS = 16;
+
+// Max buckets synced with Redis in one script call.
+static constexpr std::size_t RATE_LIMIT_SYNC_BATCH_SIZE = 256;
+
 // Maximum SSL handshake retries.
 static const unsigned int SSL_MAX_HANDSHAKE_RETRY = 5;
 
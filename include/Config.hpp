@@ -132,6 +132,11 @@ private:
   bool _hasValue;
 };
 
+/**
+ * Every option eventhub understands, with its default value.
+ */
+ConfigMap defaultConfigMap();
+
 class Config final {
 public:
   Config();
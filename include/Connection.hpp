@@ -4,10 +4,10 @@
 #include <stdint.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <chrono>
 #include <ctime>
 #include <list>
 #include <memory>
-#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -15,6 +15,9 @@
 
 #include "Forward.hpp"
 #include "EventhubBase.hpp"
+#include "SlabPool.hpp"
+#include "TimerWheel.hpp"
+#include "TopicRegistry.hpp"
 #include "websocket/Types.hpp"
 #include "http/Types.hpp"
 #include "jsonrpc/jsonrpcpp.hpp"
@@ -22,7 +25,8 @@
 namespace eventhub {
 using ConnectionPtr          = std::shared_ptr<Connection>;
 using ConnectionWeakPtr      = std::weak_ptr<Connection>;
-using ConnectionListIterator = std::list<ConnectionPtr>::iterator;
+using ConnectionList         = std::list<ConnectionPtr, PoolAllocator<ConnectionPtr>>;
+using ConnectionListIterator = ConnectionList::iterator;
 
 enum class ConnectionState {
   HTTP,
@@ -30,20 +34,59 @@ enum class ConnectionState {
   SSE
 };
 
+// What to do with messages published to a connection that can't keep up.
+enum class SlowConsumerPolicy : uint8_t {
+  DISCONNECT,  // Disconnect the client.
+  DROP_OLDEST, // Queue messages, dropping the oldest when the queue is full.
+  CONFLATE,    // Queue only the latest message of each topic.
+  PAUSE        // Drop messages until the client catches up, then tell it what it missed.
+};
+
+// How client sockets trade throughput for latency.
+enum class SocketProfile : uint8_t {
+  DEFAULT, // Let the kernel size the send buffer.
+  LATENCY  // Keep unsent data in our buffers, where the slow consumer policy can act on it.
+};
+
+enum class SlowConsumerAction : uint8_t {
+  DROPPED,
+  CONFLATED,
+  DISCONNECTED,
+  RESUMED
+};
+
+// Stable reference to a subscriber of a Topic.
+using TopicSubscriberHandle = uint32_t;
+
 struct TopicSubscription {
   std::shared_ptr<Topic> topic;
-  std::list<std::pair<ConnectionWeakPtr, jsonrpcpp::Id>>::iterator topicListIterator;
+  TopicSubscriberHandle handle;
   jsonrpcpp::Id rpcSubscriptionRequestId;
 };
 
+/**
+ * Client connection. Only used by the thread of the worker it belongs to,
+ * see ThreadOwner.
+ *
+ * A node may hold a very large number of idle connections, so keep this
+ * small: reads go through a buffer shared by the worker, the parsers are
+ * created when data arrives for them and the HTTP parser is dropped after
+ * the handshake.
+ */
 class Connection : public EventhubBase, public std::enable_shared_from_this<Connection> {
 public:
   Connection(int fd, struct sockaddr_in* csin, Worker* worker, Config& cfg);
   virtual ~Connection();
 
   void write(const std::string& data);
+  void write(const char* data, std::size_t length);
+  bool beginMessage(const InternedTopic& topic, const std::string& rpcId);
+  void endMessage();
   virtual void read();
   virtual ssize_t flushSendBuffer();
+  void onReceive(char* data, std::size_t len);
+  void onSendComplete(bool success);
+  void onWritable();
 
   int addToEpoll(uint32_t epollEvents);
   int removeFromEpoll();
@@ -51,15 +94,27 @@ public:
   ConnectionState setState(ConnectionState newState);
   ConnectionState getState();
   AccessController* getAccessController();
-  void assignConnectionListIterator(std::list<ConnectionPtr>::iterator connectionIterator);
+  void assignConnectionListIterator(ConnectionListIterator connectionIterator);
   ConnectionListIterator getConnectionListIterator();
   ConnectionPtr getSharedPtr();
   const std::string getIP();
+  int getFileDescriptor() { return _fd; }
+  virtual bool isSSL() const { return false; }
 
   void subscribe(const std::string& topicPattern, const jsonrpcpp::Id subscriptionRequestId);
   bool unsubscribe(const std::string& topicPattern);
   std::size_t unsubscribeAll();
   std::vector<std::string> listSubscriptions();
+  const std::unordered_map<TopicId, TopicSubscription>& getSubscriptions() const { return _subscribedTopics; }
+
+  void setHandshakeTimer(TimerHandle timer) { _handshake_timer = timer; }
+  void touchLastPong() { _last_pong = std::chrono::steady_clock::now(); }
+  std::chrono::steady_clock::time_point getLastPong() { return _last_pong; }
+
+  bool isMigratable();
+  void setWorker(Worker* worker) { _worker = worker; }
+  void setSkipPublishSeq(uint64_t seq) { _skip_publish_seq = seq; }
+  uint64_t getSkipPublishSeq() { return _skip_publish_seq; }
 
   void onHTTPRequest(http::ParserCallback callback);
   void onWebsocketRequest(websocket::ParserCallback callback);
@@ -67,29 +122,60 @@ public:
   void shutdownAfterFlush();
   void shutdown();
   bool isShutdown() { return _is_shutdown; }
+  std::size_t getOutputBytes() const { return _output_bytes; }
+  std::chrono::steady_clock::time_point getOutputSince() const { return _output_since; }
+  std::size_t shedOutput();
+
+  static bool parseSlowConsumerPolicy(const std::string& name, SlowConsumerPolicy& policy);
+  static bool parseSocketProfile(const std::string& name, SocketProfile& profile);
 
 protected:
+  Connection(int fd, struct sockaddr_in* csin, Worker* worker, Config& cfg, SocketProfile socketProfile);
+
+  struct SlowConsumerState;
+
+  // Updates the output accounting of the worker when it goes out of scope.
+  struct OutputAccountingScope {
+    Connection* conn;
+    ~OutputAccountingScope() { conn->_accountOutput(); }
+  };
+
   int _fd;
   struct sockaddr_in _csin;
   Worker* _worker;
   struct epoll_event _epoll_event;
   std::string _write_buffer;
-  std::vector<char> _read_buffer;
-  std::mutex _write_lock;
-  std::mutex _subscription_list_lock;
-  std::unique_ptr<http::Parser> _http_parser;
-  std::unique_ptr<websocket::Parser> _websocket_parser;
-  std::unique_ptr<AccessController> _access_controller;
+  PoolPtr<http::Parser> _http_parser;
+  PoolPtr<websocket::Parser> _websocket_parser;
+  PoolPtr<AccessController> _access_controller;
   ConnectionState _state;
   bool _is_shutdown;
   bool _is_shutdown_after_flush;
-  std::list<std::shared_ptr<Connection>>::iterator _connection_list_iterator;
-  std::unordered_map<std::string, TopicSubscription> _subscribedTopics;
+  ConnectionListIterator _connection_list_iterator;
+  std::unordered_map<TopicId, TopicSubscription> _subscribedTopics;
+  TimerHandle _handshake_timer;
+  std::chrono::steady_clock::time_point _last_pong;
+  uint64_t _skip_publish_seq;
+  bool _edge_triggered;
+  bool _uring_send_in_flight;
+  bool _uring_poll_out_armed;
+  std::unique_ptr<SlowConsumerState> _slow_consumer; // Only while the client is lagging.
+  std::size_t _output_bytes; // Bytes waiting to be sent, as last reported to the worker.
+  std::chrono::steady_clock::time_point _output_since; // When _output_bytes last went above 0.
 
   void _enableEpollOut();
   void _disableEpollOut();
   std::size_t _pruneWriteBuffer(std::size_t bytes);
-  void _parseRequest(std::size_t bytesRead);
+  bool _hasBacklog() const;
+  void _accountOutput();
+  void _applySocketProfile(SocketProfile profile);
+  void _refillFromBacklog();
+  ssize_t _submitSend();
+  std::size_t _writeSocket(const char* data, std::size_t length, ssize_t& ret);
+  std::size_t _writeDirect(const char* data, std::size_t length);
+  void _parseRequest(char* data, std::size_t len);
+  http::Parser* _getHTTPParser();
+  websocket::Parser* _getWebsocketParser();
 };
 
 } // namespace eventhub
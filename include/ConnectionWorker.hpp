@@ -1,55 +1,182 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <deque>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "Forward.hpp"
 #include "metrics/Types.hpp"
+#include "Arena.hpp"
 #include "EventhubBase.hpp"
 #include "EventLoop.hpp"
+#include "IoUring.hpp"
 #include "Worker.hpp"
 #include "Connection.hpp"
+#include "PublishBatcher.hpp"
+#include "SlabPool.hpp"
+#include "ThreadOwner.hpp"
+#include "http/Types.hpp"
+#include "websocket/Types.hpp"
 
 namespace eventhub {
 
-typedef std::list<ConnectionPtr> ConnectionList;
+/**
+ * Slab pools for the objects the connections of a worker are made of.
+ * Objects are returned to the pool they came from, also after migrating
+ * to another worker.
+ */
+struct ConnectionPools {
+  SlabPool* connection;
+  SlabPool* ssl_connection;
+  SlabPool* list_node;
+  SlabPool* http_parser;
+  SlabPool* websocket_parser;
+  SlabPool* access_controller;
 
+  ConnectionPools();
+  ~ConnectionPools();
+
+  void bind();
+  void release();
+  SlabPoolStats getStats() const;
+
+private:
+  std::vector<SlabPool*> _all;
+};
+
+// Kinds of requests a worker has in flight on its io_uring.
+enum class UringOpType : uint8_t {
+  WAKEUP,
+  ACCEPT,
+  ACCEPT_SSL,
+  RECV,
+  SEND,
+  POLL_IN,
+  POLL_OUT
+};
+
+// A subscription of a connection that moves to another worker.
+struct MigratedSubscription {
+  std::string topic;
+  jsonrpcpp::Id rpcId;
+  uint64_t deliveredSeq; // Sequence number of the last message the subscription received.
+};
+
+/**
+ * Connection worker. Its connections, topics and event loop state are
+ * confined to the worker thread. Other threads only use the public methods
+ * documented as thread safe, which queue a job for the worker.
+ */
 class Worker final : public EventhubBase, public WorkerBase {
 public:
-  Worker(Server* srv, unsigned int workerId);
+  Worker(Server* srv, unsigned int workerId, int cpu = -1);
   ~Worker();
 
   TopicManager* getTopicManager() { return _topic_manager.get(); }
 
   void subscribeConnection(ConnectionPtr conn, const std::string& topicFilterName);
-  void publish(const std::string& topicName, const std::string& data);
-  void addTimer(int64_t delay, std::function<void(TimerCtx* ctx)> callback, bool repeat = false);
+  void publish(const InternedTopic& topic, const std::string& data);
+  void publishBatch(PublishBatchPtr batch);
+  TimerHandle addTimer(int64_t delay, std::function<void(TimerCtx* ctx)> callback, bool repeat = false);
+  void cancelTimer(TimerHandle& handle) { _ev->cancelTimer(handle); }
   unsigned int getWorkerId() { return _workerId; }
   int getEpollFileDescriptor() { return _epoll_fd; }
+  int getListenSocket() { return _listen_socket; }
+  int getSSLListenSocket() { return _listen_socket_ssl; }
   const metrics::WorkerMetrics& getMetrics() { return _metrics; }
+  uint64_t getLoad();
+  void migrateConnections(Worker* target, std::size_t count);
+  bool usesIoUring() { return _ring != nullptr; }
+  bool submitSend(ConnectionPtr conn, std::shared_ptr<const std::string> buffer, std::size_t offset);
+  void pollWritable(ConnectionPtr conn);
+  const ThreadOwner& getThreadOwner() { return _thread_owner; }
+  ConnectionPools& getConnectionPools() { return _pools; }
+  std::vector<char>& getReadBuffer();
+  Arena& getRPCArena() { return _rpc_arena; }
+  SlowConsumerPolicy getSlowConsumerPolicy() const { return _slow_consumer_policy; }
+  std::size_t getSlowConsumerHighWatermark() const { return _slow_consumer_high_watermark; }
+  void countSlowConsumer(SlowConsumerAction action, const InternedTopic& topic);
+  std::unordered_map<std::string, metrics::SlowConsumerTopicMetrics> getSlowConsumerTopicMetrics();
+  void publishSlowConsumerTopicMetrics();
+  void accountOutputBytes(std::ptrdiff_t delta) { _metrics.output_bytes.fetch_add(static_cast<unsigned long>(delta), std::memory_order_relaxed); }
+  bool isOverOutputBudget() const { return _over_output_budget; }
+  static std::size_t getOutputBudgetExcess(std::size_t workerBytes, std::size_t processBytes, std::size_t workerBudget, std::size_t processBudget);
+  SocketProfile getSocketProfile(bool ssl) const { return ssl ? _ssl_socket_profile : _socket_profile; }
+  void handleHTTPRequest(ConnectionPtr conn, http::Parser* req, http::RequestState reqState);
+  void handleWebsocketRequest(ConnectionPtr conn, websocket::ParserStatus status, websocket::FrameType frameType, const std::string& data);
 
 private:
+  // Lets tests run worker thread only methods on a worker that isn't running.
+  friend struct WorkerTestAccess;
+
+  struct UringOp;
+
+  struct SlowConsumerTopicCount {
+    InternedTopic topic; // Keeps the id from being reused while counted.
+    metrics::SlowConsumerTopicMetrics counts;
+  };
+
   unsigned int _workerId;
+  int _cpu;
   Server* _server;
   int _epoll_fd;
   int _event_fd;
   int _timer_fd;
+  int _listen_socket;
+  int _listen_socket_ssl;
+  bool _owns_listen_sockets;
   std::unique_ptr<EventLoop> _ev;
+  ThreadOwner _thread_owner;
+  ConnectionPools _pools;
   ConnectionList _connection_list;
-  std::mutex _connection_list_mutex;
   std::unique_ptr<TopicManager> _topic_manager;
   metrics::WorkerMetrics _metrics;
   int64_t _ev_delay_sample_start;
+  ConnectionListIterator _ping_cursor;
+  uint64_t _ping_sweep_credit;
+  uint64_t _last_publish_seq;
+  std::deque<PublishBatchPtr> _recent_batches;
+  std::unique_ptr<IoUring> _ring;
+  UringOp* _uring_ops;
+  bool _uring_stopping;
+  std::chrono::microseconds _busy_poll_window;
+  std::atomic<bool> _spinning;
+  std::vector<char> _read_buffer;
+  Arena _rpc_arena;
+  SlowConsumerPolicy _slow_consumer_policy;
+  std::size_t _slow_consumer_high_watermark;
+  std::unordered_map<TopicId, SlowConsumerTopicCount> _slow_consumer_topics;
+  bool _slow_consumer_topics_changed;
+  std::mutex _slow_consumer_lock; // Guards _slow_consumer_snapshot.
+  std::unordered_map<std::string, metrics::SlowConsumerTopicMetrics> _slow_consumer_snapshot;
+  std::size_t _output_budget_bytes;
+  std::size_t _output_budget_worker_bytes;
+  bool _over_output_budget;
+  SocketProfile _socket_profile;
+  SocketProfile _ssl_socket_profile;
 
   void _acceptConnection(bool ssl);
+  void _acceptedConnection(int fd, bool ssl);
+  void _placeConnection(int fd, struct sockaddr_in csin, bool ssl);
   ConnectionPtr _addConnection(int fd, struct sockaddr_in* csin, bool ssl);
   void _removeConnection(ConnectionPtr conn);
+  void _unlinkConnection(ConnectionPtr conn);
+  void _migrateConnections(Worker* target, std::size_t count);
+  void _adoptConnection(ConnectionPtr conn, std::vector<MigratedSubscription> subscriptions);
+  void _replayMessages(ConnectionPtr conn, const std::vector<MigratedSubscription>& subscriptions);
   void _read(ConnectionPtr conn);
+  void _pingSweep();
+  void _initListenSockets();
+  void _closeListenSockets();
   void _initEventFd();
   void _closeEventFd();
   void _initTimerFd();
@@ -58,8 +185,23 @@ private:
   void _drainEventFd();
   void _drainTimerFd();
   void _armTimerFd();
+  void _initEpollBusyPoll();
+  bool _spinForWork(const std::function<bool()>& poll);
+  void _enforceOutputBudget();
+  void _initIoUring();
+  int _watchConnection(ConnectionPtr conn, bool ssl);
+  UringOp* _newUringOp(UringOpType type, int fd, ConnectionPtr conn);
+  void _freeUringOp(UringOp* op);
+  bool _submitUringOp(UringOp* op);
+  void _handleUringCompletion(const struct io_uring_cqe* cqe);
+  bool _handleUringRecv(UringOp* op, const struct io_uring_cqe* cqe);
+  bool _handleUringPoll(UringOp* op, const struct io_uring_cqe* cqe);
+  void _handleUringSend(UringOp* op, const struct io_uring_cqe* cqe);
+  void _stopIoUring();
 
   void _workerMain();
+  void _runEpoll();
+  void _runIoUring();
 };
 
 } // namespace eventhub
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace eventhub {
+
+/**
+ * Discovers the CPUs this process may run on and pins threads to them.
+ */
+class CpuTopology final {
+public:
+  static std::vector<int> getAllowedCpus();
+  static unsigned int getCpuQuotaMillis();
+  static unsigned int getDefaultWorkerCount();
+  static int getNumaNode(int cpu);
+  static unsigned int getNumaNodeCount();
+  static bool pinCurrentThread(int cpu);
+
+  static unsigned int parseCgroupV2CpuMax(const std::string& cpuMax);
+  static unsigned int parseCgroupV1CpuQuota(const std::string& quota, const std::string& period);
+
+private:
+  CpuTopology() {}
+  ~CpuTopology() {}
+};
+
+} // namespace eventhub
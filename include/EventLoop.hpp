@@ -1,29 +1,19 @@
 #pragma once
 
 #include <chrono>
-#include <deque>
 #include <functional>
-#include <iostream>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <utility>
 
-namespace eventhub {
-
-struct TimerCtx {
-  std::chrono::milliseconds fire_time;
-  std::chrono::milliseconds repeat_delay;
-  std::function<void(TimerCtx* ctx)> callback;
-  bool repeat;
-};
+#include "JobQueue.hpp"
+#include "TimerWheel.hpp"
 
-using timer_queue_t = std::deque<TimerCtx>;
-using job_queue_t   = std::deque<std::function<void()>>;
+namespace eventhub {
 
 class EventLoop final {
 public:
-  EventLoop() {
-    _next_timer_fire_time = std::chrono::milliseconds::zero();
-  }
+  EventLoop() : _timer_wheel(_now().count()) {}
 
   void process() {
     processJobs();
@@ -31,123 +21,133 @@ public:
   }
 
   void processJobs() {
-    std::lock_guard<std::mutex> lock(_job_queue_lock);
+    // Detach the jobs queued so far before running any of them. Jobs added
+    // by a running job are left for the next call, so a job that keeps
+    // re-queueing itself cannot starve the rest of the loop.
+    JobQueue::Node* first = nullptr;
+    JobQueue::Node* last  = nullptr;
+
+    while (auto node = _job_queue.pop()) {
+      node->next.store(nullptr, std::memory_order_relaxed);
+
+      if (last == nullptr) {
+        first = node;
+      } else {
+        last->next.store(node, std::memory_order_relaxed);
+      }
 
-    if (_job_queue.empty()) {
-      return;
+      last = node;
     }
 
-    for (auto& callback : _job_queue) {
-      callback();
+    while (first != nullptr) {
+      auto next = static_cast<JobQueue::Node*>(first->next.load(std::memory_order_relaxed));
+      first->job();
+      delete first;
+      first = next;
     }
-
-    _job_queue.clear();
   }
 
   void processTimers() {
-    std::lock_guard<std::mutex> lock(_timer_queue_lock);
-    const auto now = _now();
-    std::chrono::milliseconds nextFire;
     {
-      std::lock_guard<std::mutex> nextLock(_next_timer_fire_time_lock);
-      nextFire = _next_timer_fire_time;
+      std::lock_guard<std::mutex> lock(_timer_queue_lock);
+      _timer_wheel.advance(_now().count(), _expired_timers);
     }
 
-    if (_timer_queue.empty() || nextFire > now) {
+    if (_expired_timers.empty()) {
       return;
     }
 
+    // Run callbacks without holding the lock so they can add or cancel timers.
+    for (auto& timer : _expired_timers) {
+      if (!timer->_cancelled) {
+        timer->callback(timer.get());
+      }
+    }
+
     {
-      std::lock_guard<std::mutex> nextLock(_next_timer_fire_time_lock);
-      _next_timer_fire_time = std::chrono::milliseconds::zero();
+      std::lock_guard<std::mutex> lock(_timer_queue_lock);
+      for (auto& timer : _expired_timers) {
+        if (timer->repeat && !timer->_cancelled) {
+          timer->fire_time = _now() + timer->repeat_delay;
+          _timer_wheel.add(timer);
+        }
+      }
     }
 
-    for (auto timerQueueIterator = _timer_queue.begin(); timerQueueIterator != _timer_queue.end();) {
-      auto& timerTask = *timerQueueIterator;
+    _expired_timers.clear();
+  }
 
-      if (timerTask.fire_time <= now) {
-        timerTask.callback(&timerTask);
+  TimerHandle addTimer(int64_t delay, std::function<void(TimerCtx* ctx)> callback, bool repeat = false) {
+    auto timer          = std::make_shared<TimerCtx>();
+    timer->fire_time    = _now() + std::chrono::milliseconds(delay);
+    timer->repeat_delay = std::chrono::milliseconds(delay);
+    timer->callback     = std::move(callback);
+    timer->repeat       = repeat;
 
-        if (timerTask.repeat) {
-          timerTask.fire_time = _now() + timerTask.repeat_delay;
-          _decreaseNextFiretimeIfLess(timerTask.fire_time);
-          timerQueueIterator++;
-        } else {
-          timerQueueIterator = _timer_queue.erase(timerQueueIterator);
-        }
+    std::lock_guard<std::mutex> lock(_timer_queue_lock);
+    _timer_wheel.add(timer);
 
-        continue;
-      }
+    return TimerHandle(timer);
+  }
+
+  /**
+   * Cancel a timer. Safe to call with a handle to a timer that has already
+   * fired or been cancelled.
+   */
+  void cancelTimer(TimerHandle& handle) {
+    auto timer = handle.lock();
+    handle.reset();
 
-      _decreaseNextFiretimeIfLess(timerTask.fire_time);
-      timerQueueIterator++;
+    if (!timer) {
+      return;
     }
-  }
 
-  void addTimer(int64_t delay, std::function<void(TimerCtx* ctx)> callback, bool repeat = false) {
     std::lock_guard<std::mutex> lock(_timer_queue_lock);
-    const auto fireTime = _now() + std::chrono::milliseconds(delay);
-    TimerCtx ctx{fireTime, std::chrono::milliseconds(delay), callback, repeat};
-    _decreaseNextFiretimeIfLess(fireTime);
-    _timer_queue.push_back(ctx);
+    _timer_wheel.cancel(timer.get());
   }
 
   const std::chrono::milliseconds getNextTimerDelay() {
-    {
-      std::lock_guard<std::mutex> lock(_job_queue_lock);
-      if (!_job_queue.empty()) {
-        return std::chrono::milliseconds(0);
-      }
+    if (!_job_queue.empty()) {
+      return std::chrono::milliseconds(0);
     }
 
-    std::chrono::milliseconds nextFire;
-    {
-      std::lock_guard<std::mutex> lock(_next_timer_fire_time_lock);
-      nextFire = _next_timer_fire_time;
-    }
-
-    const auto delay = nextFire - _now();
+    const auto delay = getNextTimerFireTime() - _now();
     return (delay < std::chrono::milliseconds(0) || delay == std::chrono::milliseconds::zero()) ? std::chrono::milliseconds(0) : delay;
   }
 
+  // Fire time of the nearest timer wheel slot, or zero if there are no timers.
   const std::chrono::milliseconds getNextTimerFireTime() {
-    std::lock_guard<std::mutex> lock(_next_timer_fire_time_lock);
-    return _next_timer_fire_time;
+    std::lock_guard<std::mutex> lock(_timer_queue_lock);
+    return std::chrono::milliseconds(_timer_wheel.nextExpiry());
+  }
+
+  // Safe to call from any thread, including from within a running job.
+  template <class F>
+  void addJob(F&& callback) {
+    _job_queue.push(std::forward<F>(callback));
   }
 
-  void addJob(std::function<void()> callback) {
-    std::lock_guard<std::mutex> lock(_job_queue_lock);
-    _job_queue.push_back(callback);
+  // Only call from the thread running the loop.
+  bool hasPendingJobs() const {
+    return !_job_queue.empty();
   }
 
   bool hasWork() {
-    {
-      std::lock_guard<std::mutex> lock(_job_queue_lock);
-      if (!_job_queue.empty()) {
-        return true;
-      }
+    if (!_job_queue.empty()) {
+      return true;
     }
 
     std::lock_guard<std::mutex> lock(_timer_queue_lock);
-    return !_timer_queue.empty();
+    return _timer_wheel.size() > 0;
   }
 
 private:
-  timer_queue_t _timer_queue;
-  job_queue_t _job_queue;
+  TimerWheel _timer_wheel;
+  TimerWheel::TimerList _expired_timers;
+  JobQueue _job_queue;
   std::mutex _timer_queue_lock;
-  std::mutex _job_queue_lock;
-  std::mutex _next_timer_fire_time_lock;
-  std::chrono::milliseconds _next_timer_fire_time;
-
-  void _decreaseNextFiretimeIfLess(const std::chrono::milliseconds& fireTime) {
-    std::lock_guard<std::mutex> lock(_next_timer_fire_time_lock);
-    if (_next_timer_fire_time == std::chrono::milliseconds::zero() || _next_timer_fire_time > fireTime) {
-      _next_timer_fire_time = fireTime;
-    }
-  }
 
-  const std::chrono::milliseconds _now() {
+  static const std::chrono::milliseconds _now() {
     return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
   }
 };
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace eventhub {
+
+/**
+ * Minimal io_uring wrapper on top of the raw system calls.
+ *
+ * Covers what the connection workers need: a submission and completion
+ * ring, opcode probing and a ring of provided receive buffers.
+ * Not thread safe, a ring is used by a single worker thread.
+ */
+class IoUring final {
+public:
+  IoUring();
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  bool init(unsigned int entries, unsigned int cqEntries);
+  const std::string& getError() const { return _error; }
+  bool isOpSupported(uint8_t opcode) const { return _supported_ops.test(opcode); }
+
+  bool setupBufferRing(uint16_t groupId, unsigned int count, unsigned int size);
+  uint16_t getBufferGroup() const { return _buffer_group; }
+  char* getBuffer(uint16_t bufferId) { return _buffers + std::size_t(bufferId) * _buffer_size; }
+  void recycleBuffer(uint16_t bufferId);
+
+  struct io_uring_sqe* getSqe();
+  int submit();
+  int submitAndWait(std::chrono::milliseconds timeout);
+  bool hasCqe() const { return *_cq_head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE); }
+
+  /**
+   * Call fn for every completion that is ready and mark them as consumed.
+   * fn may queue new submissions.
+   * @return Number of completions processed.
+   */
+  template <class F>
+  unsigned int forEachCqe(F&& fn) {
+    unsigned int head  = *_cq_head;
+    unsigned int count = 0;
+
+    while (head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+      fn(&_cqes[head & *_cq_mask]);
+      head++;
+      count++;
+
+      // Hand the slot back right away, fn may submit requests that complete
+      // before we are done.
+      __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return count;
+  }
+
+private:
+  int _ring_fd;
+  uint32_t _features;
+  std::string _error;
+  std::bitset<256> _supported_ops;
+
+  void* _ring_ptr;
+  std::size_t _ring_size;
+  struct io_uring_sqe* _sqes;
+  std::size_t _sqes_size;
+
+  unsigned int* _sq_head;
+  unsigned int* _sq_tail;
+  unsigned int* _sq_mask;
+  unsigned int* _sq_entries;
+  unsigned int* _sq_array;
+  unsigned int _sqe_tail;
+  unsigned int _sqe_submitted;
+
+  unsigned int* _cq_head;
+  unsigned int* _cq_tail;
+  unsigned int* _cq_mask;
+  struct io_uring_cqe* _cqes;
+
+  struct io_uring_buf_ring* _buf_ring;
+  std::size_t _buf_ring_size;
+  char* _buffers;
+  unsigned int _buffer_count;
+  unsigned int _buffer_size;
+  uint16_t _buffer_group;
+
+  bool _probeOps();
+  int _enter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags, void* arg, std::size_t argSize);
+  void _addBuffer(uint16_t bufferId, unsigned int offset);
+  void _close();
+};
+
+} // namespace eventhub
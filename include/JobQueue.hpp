@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace eventhub {
+
+/**
+ * Type-erased void() callable with inline storage.
+ * Callables up to JOB_INLINE_SIZE bytes are stored in place, larger ones
+ * are moved to the heap.
+ */
+class Job final {
+public:
+  static constexpr std::size_t JOB_INLINE_SIZE = 64;
+
+  template <class F, class Fn = std::decay_t<F>>
+  explicit Job(F&& fn) {
+    if constexpr (_fitsInline<Fn>()) {
+      new (&_storage) Fn(std::forward<F>(fn));
+      _ops = &_InlineOps<Fn>::ops;
+    } else {
+      _heap = new Fn(std::forward<F>(fn));
+      _ops  = &_HeapOps<Fn>::ops;
+    }
+  }
+
+  ~Job() { _ops->destroy(this); }
+
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+
+  void operator()() { _ops->invoke(this); }
+
+private:
+  struct Ops {
+    void (*invoke)(Job* job);
+    void (*destroy)(Job* job);
+  };
+
+  template <class Fn>
+  static constexpr bool _fitsInline() {
+    return sizeof(Fn) <= JOB_INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t);
+  }
+
+  template <class Fn>
+  struct _InlineOps {
+    static Fn* get(Job* job) { return std::launder(reinterpret_cast<Fn*>(&job->_storage)); }
+    static void invoke(Job* job) { (*get(job))(); }
+    static void destroy(Job* job) { get(job)->~Fn(); }
+    static constexpr Ops ops{invoke, destroy};
+  };
+
+  template <class Fn>
+  struct _HeapOps {
+    static void invoke(Job* job) { (*static_cast<Fn*>(job->_heap))(); }
+    static void destroy(Job* job) { delete static_cast<Fn*>(job->_heap); }
+    static constexpr Ops ops{invoke, destroy};
+  };
+
+  const Ops* _ops;
+  union {
+    std::aligned_storage_t<JOB_INLINE_SIZE, alignof(std::max_align_t)> _storage;
+    void* _heap;
+  };
+};
+
+/**
+ * Intrusive multi-producer/single-consumer queue of jobs (Vyukov).
+ *
+ * push() is wait-free and may be called from any thread. pop(), empty() and
+ * the destructor may only be called from the consumer thread.
+ */
+class JobQueue final {
+private:
+  struct NodeBase {
+    std::atomic<NodeBase*> next{nullptr};
+  };
+
+public:
+  struct Node final : NodeBase {
+    template <class F>
+    explicit Node(F&& fn) : job(std::forward<F>(fn)) {}
+
+    Job job;
+  };
+
+  JobQueue() : _head(&_stub), _tail(&_stub) {}
+
+  ~JobQueue() {
+    while (auto node = pop()) {
+      delete node;
+    }
+  }
+
+  JobQueue(const JobQueue&) = delete;
+  JobQueue& operator=(const JobQueue&) = delete;
+
+  template <class F>
+  void push(F&& fn) {
+    _push(new Node(std::forward<F>(fn)));
+  }
+
+  /**
+   * Remove the oldest job from the queue.
+   * Returns nullptr if the queue is empty, or if the oldest job is still
+   * being linked in by a producer. Caller owns the returned node.
+   */
+  Node* pop() {
+    NodeBase* tail = _tail;
+    NodeBase* next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &_stub) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+
+      _tail = next;
+      tail  = next;
+      next  = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+      _tail = next;
+      return static_cast<Node*>(tail);
+    }
+
+    if (tail != _head.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+
+    _push(&_stub);
+    next = tail->next.load(std::memory_order_acquire);
+
+    if (next != nullptr) {
+      _tail = next;
+      return static_cast<Node*>(tail);
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * The consumer always parks on the stub node once the last job is popped,
+   * so the queue is empty when the stub is the tail and nothing follows it.
+   */
+  bool empty() const {
+    return _tail == &_stub && _stub.next.load(std::memory_order_acquire) == nullptr;
+  }
+
+private:
+  NodeBase _stub;
+  alignas(64) std::atomic<NodeBase*> _head;
+  alignas(64) NodeBase* _tail;
+
+  void _push(NodeBase* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    NodeBase* prev = _head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+};
+
+} // namespace eventhub
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Common.hpp"
+#include "Redis.hpp"
+
+namespace eventhub {
+
+/**
+ * Rate limits enforced from token buckets in memory, so a publish with a
+ * rate limit needs no round-trip to Redis.
+ *
+ * There is one bucket per subject and rate limit pattern. It holds up to
+ * max tokens and refills at max per interval. Every sync the publishes each
+ * node has counted are added to a total in Redis, and each node takes what
+ * the other nodes consumed since the last sync out of its buckets.
+ */
+class LocalRateLimiter final {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit LocalRateLimiter(std::chrono::milliseconds syncInterval);
+  LocalRateLimiter(const LocalRateLimiter&) = delete;
+  LocalRateLimiter& operator=(const LocalRateLimiter&) = delete;
+
+  RateLimitResult check(const std::string& topic, const std::string& subject, unsigned long interval, unsigned long max, Clock::time_point now = Clock::now());
+  void sync(Redis& redis);
+  std::vector<RateLimitUsage> collectUsage(Clock::time_point now = Clock::now());
+  void applyTotals(const std::vector<RateLimitUsage>& usage, const std::vector<long long>& totals);
+  void restoreUsage(const std::vector<RateLimitUsage>& usage);
+  std::size_t size();
+
+private:
+  struct Bucket {
+    double tokens;
+    unsigned long interval;
+    unsigned long max;
+    Clock::time_point refilledAt;
+    unsigned long long pending = 0; // Publishes counted since the last sync.
+    long long synced           = -1; // Total in Redis after the last sync.
+  };
+
+  using PatternBuckets = std::unordered_map<std::string, Bucket>;
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<std::string, PatternBuckets> subjects;
+  };
+
+  std::array<Shard, LOCAL_RATE_LIMIT_SHARDS> _shards;
+  std::chrono::milliseconds _sync_interval;
+
+  Shard& _getShard(const std::string& subject) { return _shards[std::hash<std::string>()(subject) % LOCAL_RATE_LIMIT_SHARDS]; }
+  Bucket* _findBucket(Shard& shard, const std::string& subject, const std::string& topic);
+  static void _refill(Bucket& bucket, Clock::time_point now);
+};
+
+} // namespace eventhub
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TopicRegistry.hpp"
+
+namespace eventhub {
+
+struct PublishMessage {
+  InternedTopic topic;
+  std::string data;
+  uint64_t seq; // Position in the stream of published messages, starting at 1.
+};
+
+using PublishBatch         = std::vector<PublishMessage>;
+using PublishBatchPtr      = std::shared_ptr<const PublishBatch>;
+using PublishBatchCallback = std::function<void(PublishBatchPtr batch)>;
+
+/**
+ * Accumulates messages from a producer thread and hands them off in batches.
+ *
+ * A batch is handed to the callback when it reaches maxBatchSize messages or
+ * when the oldest message in it has waited maxLatency, whichever comes first.
+ * Callbacks are serialized, so batches are delivered in the order they were
+ * filled, and every message is stamped with a sequence number in that order.
+ */
+class PublishBatcher final {
+public:
+  PublishBatcher(std::size_t maxBatchSize, std::chrono::microseconds maxLatency, PublishBatchCallback callback);
+  ~PublishBatcher();
+
+  void start();
+  void stop();
+  void add(const InternedTopic& topic, const std::string& data);
+  void flush();
+
+private:
+  std::size_t _max_batch_size;
+  std::chrono::microseconds _max_latency;
+  PublishBatchCallback _callback;
+  std::unique_ptr<PublishBatch> _batch;
+  std::chrono::steady_clock::time_point _batch_started;
+  std::mutex _batch_lock;
+  std::mutex _flush_lock;
+  std::condition_variable _batch_cv;
+  std::thread _flusher;
+  bool _stop_requested;
+  uint64_t _next_seq;
+
+  bool _isBatchingEnabled() const;
+  void _flusherMain();
+};
+
+} // namespace eventhub
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "jsonrpc/jsonrpcpp.hpp"
+
+namespace eventhub {
+
+enum class RPCRequestMethod {
+  OTHER,
+  PUBLISH,
+  SUBSCRIBE
+};
+
+/**
+ * Publish or subscribe request with the parameters we know of.
+ */
+struct RPCRequest {
+  RPCRequestMethod method = RPCRequestMethod::OTHER;
+  jsonrpcpp::Id id;
+  std::string topic;
+  std::string message;
+  std::string sinceEventId;
+  long long since     = 0;
+  long long timestamp = 0;
+  unsigned long ttl   = 0;
+  std::optional<long long> limit;
+
+  void clear();
+};
+
+/**
+ * Decodes publish and subscribe requests straight from the frame, without
+ * building a nlohmann::json DOM and a jsonrpcpp::Request for them.
+ *
+ * Only requests the decoder is sure about are decoded. Any other method,
+ * parameter types it doesn't expect, floating point numbers and malformed
+ * input are left to jsonrpcpp, which handles and reports them as before.
+ */
+class RPCDecoder final {
+public:
+  static bool decode(const std::string& data, RPCRequest& request);
+
+private:
+  RPCDecoder() {}
+  ~RPCDecoder() {}
+};
+
+} // namespace eventhub
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <functional>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "Forward.hpp"
 #include "Connection.hpp"
 #include "HandlerContext.hpp"
+#include "RPCDecoder.hpp"
 #include "jsonrpc/jsonrpcpp.hpp"
 #include "jwt/json/json.hpp"
 
@@ -16,16 +19,31 @@ namespace eventhub {
 using RPCMethod      = std::function<void(HandlerContext& hCtx, jsonrpcpp::request_ptr)>;
 using RPCHandlerList = std::vector<std::pair<std::string, RPCMethod>>;
 
+// Result object with string values only. Keys must be in sorted order, like
+// nlohmann::json would write them.
+using RPCStringResult = std::initializer_list<std::pair<const char*, std::string_view>>;
+
 class RPCHandler final {
 public:
   static RPCMethod getHandler(const std::string& methodName);
+  static void handleRequest(HandlerContext& hCtx, const RPCRequest& req);
 
 private:
   static void _sendSuccessResponse(HandlerContext& hCtx, jsonrpcpp::request_ptr req, const nlohmann::json& result);
+  static void _sendStringResult(HandlerContext& hCtx, const jsonrpcpp::Id& id, RPCStringResult result);
+  static void _sendResult(HandlerContext& hCtx, const jsonrpcpp::Id& id, std::string_view result);
+  static const std::string& _getStringParam(jsonrpcpp::request_ptr req, const std::string& key);
+  template <class T>
+  static T _getNumberParam(jsonrpcpp::request_ptr req, const std::string& key, T defaultValue);
+  static RPCRequest _toRPCRequest(jsonrpcpp::request_ptr req, RPCRequestMethod method);
   static void _sendInvalidParamsError(HandlerContext& hCtx, jsonrpcpp::request_ptr req, const std::string& message);
-  static void _sendCacheToClient(HandlerContext &hCtx, jsonrpcpp::request_ptr req, const std::string& topic);
+  static void _sendInvalidParamsError(HandlerContext& hCtx, const jsonrpcpp::Id& id, const std::string& message);
+  static void _sendCacheToClient(HandlerContext &hCtx, const RPCRequest& req);
   static unsigned long long _calculateRelativeSince(long long since);
 
+  static void _subscribe(HandlerContext& hCtx, const RPCRequest& req);
+  static void _publish(HandlerContext& hCtx, const RPCRequest& req);
+
   static void _handleSubscribe(HandlerContext& hCtx, jsonrpcpp::request_ptr req);
   static void _handleUnsubscribe(HandlerContext& hCtx, jsonrpcpp::request_ptr req);
   static void _handleUnsubscribeAll(HandlerContext& hCtx, jsonrpcpp::request_ptr req);
@@ -10,7 +10,9 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <initializer_list>
 
+#include "Arena.hpp"
 #include "EventhubBase.hpp"
 #include "jwt/json/json.hpp"
 
@@ -39,11 +41,29 @@ private:
   std::string _origin;
 };
 
+enum class RateLimitAlgorithm {
+  FIXED_WINDOW,
+  SLIDING_WINDOW,
+  GCRA
+};
+
+struct RateLimitResult {
+  bool limited;
+  long long count; // Publishes counted against the limit, including this one if allowed.
+};
+
+// Publishes a node has counted against a rate limit since it last synced.
+struct RateLimitUsage {
+  std::string topic;
+  std::string subject;
+  unsigned long long consumed;
+  unsigned long ttl; // Seconds to keep the total after the last sync.
+};
+
 class Redis final : public EventhubBase {
 #define REDIS_PREFIX(key) std::string((_prefix.length() > 0) ? _prefix + ":" + key : key)
 #define REDIS_CACHE_SCORE_PATH(key) std::string(REDIS_PREFIX(key) + ":scores")
 #define REDIS_CACHE_DATA_PATH(key) std::string(REDIS_PREFIX(key) + ":cache")
-#define REDIS_RATE_LIMIT_PATH(key, subject, topic) std::string(REDIS_PREFIX(key) + ":rlimit:" + topic + ":" + subject)
 
 public:
   explicit Redis(Config &cfg);
@@ -63,14 +83,29 @@ public:
   std::vector<std::string> _getTopicsSeen(const std::string& topicPattern);
   const std::string _getNextCacheId(long long timestamp);
 
-  bool isRateLimited(const std::string& topic, const std::string& subject, unsigned long max);
-  void incrementLimitCount(const std::string& topic, const std::string& subject, unsigned long interval);
+  RateLimitResult checkRateLimit(const std::string& topic, const std::string& subject, unsigned long interval, unsigned long max);
+  static bool parseRateLimitAlgorithm(const std::string& name, RateLimitAlgorithm& algorithm);
+  std::vector<long long> syncRateLimitUsage(const std::vector<RateLimitUsage>& usage);
 
 private:
+  struct Script {
+    const char* source;
+    std::string sha;
+  };
+
   std::unique_ptr<sw::redis::Redis> _redisInstance;
   std::unique_ptr<sw::redis::Subscriber> _redisSubscriber;
   std::string _prefix;
   std::mutex _publish_mtx;
+  RateLimitAlgorithm _rate_limit_algorithm;
+  Script _rate_limit_script;
+  Script _rate_limit_sync_script;
+
+  std::vector<long long> _evalScript(const Script& script, const sw::redis::StringView& key, std::initializer_list<sw::redis::StringView> args);
+  std::vector<long long> _evalScript(const Script& script, const std::vector<sw::redis::StringView>& keys, const std::vector<sw::redis::StringView>& args);
+
+  template <class... Parts>
+  ArenaString _key(const Parts&... parts) const;
 };
 
 } // namespace eventhub
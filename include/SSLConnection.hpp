@@ -18,6 +18,7 @@ public:
 
   ssize_t flushSendBuffer();
   void read();
+  bool isSSL() const { return true; }
 
 private:
   using SSL_ptr = std::unique_ptr<SSL, decltype(&SSL_free)>;
@@ -25,6 +26,7 @@ private:
   SSL_ptr _ssl;
   SSL_CTX* _ssl_ctx;
   unsigned int _ssl_handshake_retries;
+  bool _ssl_handshake_want_write; // The handshake waits for the socket to become writable.
 
   void _init();
   void _handshake();
@@ -6,6 +6,8 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Forward.hpp"
 #include "KVStore.hpp"
@@ -13,6 +15,9 @@
 #include "metrics/Types.hpp"
 #include "EventLoop.hpp"
 #include "Redis.hpp"
+#include "PublishBatcher.hpp"
+#include "TokenCache.hpp"
+#include "LocalRateLimiter.hpp"
 
 namespace eventhub {
 
@@ -27,10 +32,15 @@ public:
   Config& config() { return _config; }
   int getServerSocket() { return _server_socket; };
   Worker* getWorker();
+  static int openListenSocket(int port, bool reusePort);
   void publish(const std::string& topicName, const std::string& data);
   Redis& getRedis() { return _redis; }
   KVStore* getKVStore() { return _kv_store.get(); }
+  TokenCache& getTokenCache() { return _token_cache; }
   metrics::AggregatedMetrics getAggregatedMetrics();
+  std::size_t getOutputBytes();
+  RateLimitResult checkRateLimit(const std::string& topic, const std::string& subject, unsigned long interval, unsigned long max);
+  void countRateLimited(const std::string& pattern);
 
   int getSSLServerSocket() { return _server_socket_ssl; };
   bool isSSL() { return _ssl_enabled; }
@@ -51,16 +61,23 @@ private:
   std::string _ssl_cert_md5_hash;
   std::string _ssl_priv_key_md5_hash;
   WorkerGroup<Worker> _connection_workers;
-  WorkerGroup<Worker>::iterator _cur_worker;
   std::mutex _connection_workers_lock;
   Redis _redis;
   std::unique_ptr<KVStore> _kv_store;
   metrics::ServerMetrics _metrics;
+  TokenCache _token_cache;
+  std::unique_ptr<LocalRateLimiter> _local_rate_limiter;
+  std::mutex _rate_limited_lock;
+  std::unordered_map<std::string, unsigned long long> _rate_limited_patterns;
   EventLoop _ev;
+  std::unique_ptr<PublishBatcher> _publish_batcher;
 
   void _listenerInit();
+  void _publishBatch(PublishBatchPtr batch);
+  void _rebalanceWorkers();
 
   void _sslListenerInit();
+  void _attachReusePortSteering(int listenSocket, const std::vector<int>& socketCpus);
   void _initSSL();
   void _loadSSLCertificates();
   void _checkSSLCertUpdated();
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "ThreadOwner.hpp"
+
+namespace eventhub {
+
+struct SlabPoolStats {
+  std::size_t blocks_in_use = 0;
+  std::size_t blocks_free   = 0;
+  std::size_t bytes         = 0;
+};
+
+/**
+ * Pool of equally sized blocks carved out of larger slabs.
+ *
+ * A pool serves one kind of object and belongs to a worker. Only the owner
+ * thread allocates, and blocks it frees go straight back on its free list.
+ * Blocks freed by other threads, for example by a connection that has
+ * migrated to another worker, are pushed on a lock free list that the owner
+ * takes over once its own runs dry. Slabs are aligned to their size, so the
+ * pool of a block is found from its address.
+ *
+ * The block size is taken from the first allocation. That lets a pool serve
+ * types only the standard library knows the size of, like the combined
+ * object and control block of std::allocate_shared().
+ *
+ * Slabs are kept until the pool is gone. The owner gives the pool up with
+ * orphan(), and the pool is deleted once the last block comes back.
+ */
+class SlabPool final {
+public:
+  explicit SlabPool(const std::string& name);
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+
+  void* allocate(std::size_t size);
+  static void deallocate(void* block);
+  void orphan();
+
+  const std::string& getName() const { return _name; }
+  ThreadOwner& getThreadOwner() { return _owner; }
+
+  // Safe to call from any thread.
+  SlabPoolStats getStats() const;
+
+private:
+  struct Slab {
+    SlabPool* pool;
+    Slab* next;
+  };
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  std::string _name;
+  ThreadOwner _owner;
+  std::size_t _block_size;
+  std::size_t _blocks_per_slab;
+  Slab* _slabs;
+  FreeBlock* _free;
+  std::atomic<FreeBlock*> _remote_free;
+  std::atomic<std::size_t> _refs; // Blocks handed out plus one for the owner.
+  std::atomic<std::size_t> _slab_count;
+  std::atomic<std::size_t> _capacity;
+
+  ~SlabPool();
+  void _addSlab();
+};
+
+/**
+ * Standard allocator handing out single objects from a SlabPool, for
+ * std::allocate_shared() and node based containers.
+ */
+template <class T>
+class PoolAllocator {
+public:
+  using value_type = T;
+
+  explicit PoolAllocator(SlabPool* pool) : _pool(pool) {}
+
+  template <class U>
+  PoolAllocator(const PoolAllocator<U>& other) : _pool(other.getPool()) {}
+
+  T* allocate(std::size_t n) {
+    assert(n == 1);
+    return static_cast<T*>(_pool->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t) { SlabPool::deallocate(p); }
+
+  SlabPool* getPool() const { return _pool; }
+
+  // Blocks know their pool, so any instance can free what another allocated.
+  template <class U>
+  bool operator==(const PoolAllocator<U>&) const { return true; }
+
+  template <class U>
+  bool operator!=(const PoolAllocator<U>&) const { return false; }
+
+private:
+  SlabPool* _pool;
+};
+
+struct PoolDeleter {
+  template <class T>
+  void operator()(T* object) const {
+    object->~T();
+    SlabPool::deallocate(object);
+  }
+};
+
+template <class T>
+using PoolPtr = std::unique_ptr<T, PoolDeleter>;
+
+/**
+ * Construct an object in a block from pool.
+ */
+template <class T, class... Args>
+PoolPtr<T> makePooled(SlabPool* pool, Args&&... args) {
+  void* block = pool->allocate(sizeof(T));
+
+  try {
+    return PoolPtr<T>(new (block) T(std::forward<Args>(args)...));
+  } catch (...) {
+    SlabPool::deallocate(block);
+    throw;
+  }
+}
+
+} // namespace eventhub
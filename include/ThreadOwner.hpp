@@ -0,0 +1,39 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <thread>
+
+namespace eventhub {
+
+/**
+ * Thread an object is confined to.
+ *
+ * Connections, topics and the topic manager of a worker are only touched by
+ * the worker thread and have no locks of their own. Other threads hand work
+ * to a worker through its job queue. Until the owner is bound, for example
+ * while a worker is set up or in tests, any thread may use the object.
+ */
+class ThreadOwner final {
+public:
+  void bind() { _owner.store(std::this_thread::get_id(), std::memory_order_relaxed); }
+  void release() { _owner.store(std::thread::id(), std::memory_order_relaxed); }
+
+  bool isCurrentThread() const {
+    const auto owner = _owner.load(std::memory_order_relaxed);
+    return owner == std::thread::id() || owner == std::this_thread::get_id();
+  }
+
+  // Unlike isCurrentThread(), false while the owner is not bound.
+  bool isBoundToCurrentThread() const {
+    return _owner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+  }
+
+private:
+  std::atomic<std::thread::id> _owner{std::thread::id()};
+};
+
+} // namespace eventhub
+
+// Debug builds check that a thread confined object is used from its owner.
+#define ASSERT_OWNER_THREAD(owner) assert((owner).isCurrentThread())
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace eventhub {
+
+struct TimerCtx {
+  std::chrono::milliseconds fire_time;
+  std::chrono::milliseconds repeat_delay;
+  std::function<void(TimerCtx* ctx)> callback;
+  bool repeat;
+
+  // Bookkeeping owned by TimerWheel.
+  TimerCtx* _prev = nullptr;
+  TimerCtx* _next = nullptr;
+  int _slot       = -1;
+  std::atomic<bool> _cancelled{false};
+  std::shared_ptr<TimerCtx> _self;
+};
+
+/**
+ * Handle to a scheduled timer, used to cancel it.
+ * Does not keep the timer alive; a handle to a timer that has fired or been
+ * cancelled is simply inactive.
+ */
+class TimerHandle final {
+public:
+  TimerHandle() {}
+  explicit TimerHandle(const std::shared_ptr<TimerCtx>& timer) : _timer(timer) {}
+
+  bool active() const { return !_timer.expired(); }
+  std::shared_ptr<TimerCtx> lock() const { return _timer.lock(); }
+  void reset() { _timer.reset(); }
+
+private:
+  std::weak_ptr<TimerCtx> _timer;
+};
+
+/**
+ * Hierarchical timing wheel with millisecond ticks.
+ *
+ * Level 0 has 256 one-tick slots, the four levels above it have 64 slots
+ * each, every slot spanning a full revolution of the level below. Timers
+ * are filed in the lowest level that can hold them and cascade downwards
+ * as time advances. Insert and cancel are O(1).
+ *
+ * Not thread safe, EventLoop serializes access.
+ */
+class TimerWheel final {
+public:
+  using TimerList = std::vector<std::shared_ptr<TimerCtx>>;
+
+  explicit TimerWheel(uint64_t nowTick) : _current_tick(nowTick), _count(0) {
+    for (auto& slot : _slots) {
+      slot = nullptr;
+    }
+
+    for (auto& word : _occupied) {
+      word = 0;
+    }
+  }
+
+  ~TimerWheel() {
+    for (auto& slot : _slots) {
+      while (slot != nullptr) {
+        auto timer = slot;
+        _unlink(timer);
+        timer->_self.reset();
+      }
+    }
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /**
+   * Schedule a timer at timer->fire_time. The wheel keeps the timer alive
+   * until it fires or is cancelled.
+   */
+  void add(const std::shared_ptr<TimerCtx>& timer) {
+    timer->_self      = timer;
+    timer->_cancelled = false;
+    _insert(timer.get());
+    _count++;
+  }
+
+  void cancel(TimerCtx* timer) {
+    timer->_cancelled = true;
+
+    if (timer->_slot != -1) {
+      _unlink(timer);
+      _count--;
+    }
+
+    timer->_self.reset();
+  }
+
+  /**
+   * Advance the wheel to nowTick and move every timer that is due into expired.
+   * Ownership of the expired timers is passed to the caller.
+   */
+  void advance(uint64_t nowTick, TimerList& expired) {
+    _drainSlot(DUE_SLOT, expired);
+
+    while (_current_tick < nowTick) {
+      if (_count == 0) {
+        _current_tick = nowTick;
+        break;
+      }
+
+      // Skip directly to the next tick where something happens. No slot
+      // in between holds any timers, so nothing is missed.
+      const auto nextTick = _nextEventTick();
+      if (nextTick > nowTick) {
+        _current_tick = nowTick;
+        break;
+      }
+
+      _current_tick = nextTick;
+
+      for (std::size_t level = NUM_LEVELS - 1; level > 0; level--) {
+        if ((_current_tick & ((uint64_t(1) << LEVEL_SHIFT[level]) - 1)) == 0) {
+          _cascade(_slotIndex(level, _current_tick >> LEVEL_SHIFT[level]));
+        }
+      }
+
+      _drainSlot(_slotIndex(0, _current_tick), expired);
+      _drainSlot(DUE_SLOT, expired);
+    }
+  }
+
+  /**
+   * Tick of the nearest non-empty slot, or 0 if there are no timers.
+   * For slots above level 0 this is the tick where the slot cascades, which
+   * is never later than the earliest timer in it.
+   */
+  uint64_t nextExpiry() const {
+    if (_count == 0) {
+      return 0;
+    }
+
+    return _nextEventTick();
+  }
+
+  std::size_t size() const { return _count; }
+  uint64_t currentTick() const { return _current_tick; }
+
+private:
+  static constexpr std::size_t NUM_LEVELS                = 5;
+  static constexpr unsigned int LEVEL_SHIFT[NUM_LEVELS]  = {0, 8, 14, 20, 26};
+  static constexpr std::size_t LEVEL_SIZE[NUM_LEVELS]    = {256, 64, 64, 64, 64};
+  static constexpr std::size_t LEVEL_OFFSET[NUM_LEVELS]  = {0, 256, 320, 384, 448};
+  static constexpr std::size_t NUM_SLOTS                 = 512;
+  static constexpr int DUE_SLOT                          = NUM_SLOTS;
+  static constexpr uint64_t MAX_DELAY                    = uint64_t(63) << 26;
+
+  TimerCtx* _slots[NUM_SLOTS + 1];
+  uint64_t _occupied[NUM_SLOTS / 64];
+  uint64_t _current_tick;
+  std::size_t _count;
+
+  static int _slotIndex(std::size_t level, uint64_t position) {
+    return LEVEL_OFFSET[level] + (position & (LEVEL_SIZE[level] - 1));
+  }
+
+  void _insert(TimerCtx* timer) {
+    const uint64_t fireTick = timer->fire_time.count() > 0 ? timer->fire_time.count() : 0;
+
+    if (fireTick <= _current_tick) {
+      _link(timer, DUE_SLOT);
+      return;
+    }
+
+    // Timers further away than the top level can hold are parked in the top
+    // level and re-filed when they cascade.
+    const uint64_t tick = (fireTick - _current_tick > MAX_DELAY) ? _current_tick + MAX_DELAY : fireTick;
+
+    for (std::size_t level = 0; level < NUM_LEVELS; level++) {
+      const auto shift = LEVEL_SHIFT[level];
+      if ((tick >> shift) - (_current_tick >> shift) < LEVEL_SIZE[level]) {
+        _link(timer, _slotIndex(level, tick >> shift));
+        return;
+      }
+    }
+  }
+
+  void _link(TimerCtx* timer, int slot) {
+    timer->_slot = slot;
+    timer->_prev = nullptr;
+    timer->_next = _slots[slot];
+
+    if (_slots[slot] != nullptr) {
+      _slots[slot]->_prev = timer;
+    }
+
+    _slots[slot] = timer;
+
+    if (slot != DUE_SLOT) {
+      _occupied[slot / 64] |= (uint64_t(1) << (slot % 64));
+    }
+  }
+
+  void _unlink(TimerCtx* timer) {
+    const int slot = timer->_slot;
+
+    if (timer->_prev != nullptr) {
+      timer->_prev->_next = timer->_next;
+    } else {
+      _slots[slot] = timer->_next;
+    }
+
+    if (timer->_next != nullptr) {
+      timer->_next->_prev = timer->_prev;
+    }
+
+    if (slot != DUE_SLOT && _slots[slot] == nullptr) {
+      _occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+
+    timer->_prev = nullptr;
+    timer->_next = nullptr;
+    timer->_slot = -1;
+  }
+
+  void _cascade(int slot) {
+    auto timer    = _slots[slot];
+    _slots[slot] = nullptr;
+
+    if (slot != DUE_SLOT) {
+      _occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+
+    while (timer != nullptr) {
+      auto next    = timer->_next;
+      timer->_slot = -1;
+      _insert(timer);
+      timer = next;
+    }
+  }
+
+  void _drainSlot(int slot, TimerList& expired) {
+    while (_slots[slot] != nullptr) {
+      auto timer = _slots[slot];
+      _unlink(timer);
+      _count--;
+      expired.push_back(std::move(timer->_self));
+    }
+  }
+
+  bool _isOccupied(int slot) const {
+    return _occupied[slot / 64] & (uint64_t(1) << (slot % 64));
+  }
+
+  uint64_t _nextEventTick() const {
+    if (_slots[DUE_SLOT] != nullptr) {
+      return _current_tick;
+    }
+
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+
+    for (std::size_t level = 0; level < NUM_LEVELS; level++) {
+      const auto position = _current_tick >> LEVEL_SHIFT[level];
+
+      for (std::size_t i = 1; i < LEVEL_SIZE[level]; i++) {
+        if (_isOccupied(_slotIndex(level, position + i))) {
+          const uint64_t tick = (position + i) << LEVEL_SHIFT[level];
+          if (tick < next) {
+            next = tick;
+          }
+          break;
+        }
+      }
+
+      // Slots in higher levels can not be reached before this one.
+      if (next != std::numeric_limits<uint64_t>::max() && level + 1 < NUM_LEVELS &&
+          next <= (((_current_tick >> LEVEL_SHIFT[level + 1]) + 1) << LEVEL_SHIFT[level + 1])) {
+        break;
+      }
+    }
+
+    return next;
+  }
+};
+
+} // namespace eventhub
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <openssl/sha.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "Common.hpp"
+
+namespace eventhub {
+
+struct TokenPermissions;
+using TokenPermissionsPtr = std::shared_ptr<const TokenPermissions>;
+
+/**
+ * Process wide cache of verified tokens, so a client reconnecting with a
+ * token we have seen before skips signature verification, claim parsing
+ * and ACL compilation.
+ *
+ * Entries are keyed by a SHA-256 digest of the secret and the token, and
+ * only verified tokens are added. An entry is dropped once the token
+ * expires. The cache is sharded and each shard evicts its least recently
+ * used token when full.
+ */
+class TokenCache final {
+public:
+  using Digest = std::array<unsigned char, SHA256_DIGEST_LENGTH>;
+
+  explicit TokenCache(std::size_t capacity);
+  TokenCache(const TokenCache&) = delete;
+  TokenCache& operator=(const TokenCache&) = delete;
+
+  static Digest digest(const std::string& token, const std::string& secret);
+  TokenPermissionsPtr get(const Digest& digest);
+  void put(const Digest& digest, TokenPermissionsPtr permissions);
+
+  bool isEnabled() const { return _shard_capacity > 0; }
+  std::size_t size();
+  unsigned long long getHitCount() const { return _hits.load(std::memory_order_relaxed); }
+  unsigned long long getMissCount() const { return _misses.load(std::memory_order_relaxed); }
+
+private:
+  struct DigestHash {
+    std::size_t operator()(const Digest& digest) const {
+      std::size_t hash;
+      std::memcpy(&hash, digest.data(), sizeof(hash));
+      return hash;
+    }
+  };
+
+  using LRUList = std::list<std::pair<Digest, TokenPermissionsPtr>>;
+
+  struct Shard {
+    std::mutex lock;
+    LRUList lru; // Most recently used first.
+    std::unordered_map<Digest, LRUList::iterator, DigestHash> index;
+  };
+
+  std::array<Shard, TOKEN_CACHE_SHARDS> _shards;
+  std::size_t _shard_capacity;
+  std::atomic<unsigned long long> _hits{0};
+  std::atomic<unsigned long long> _misses{0};
+
+  Shard& _getShard(const Digest& digest) { return _shards[digest[sizeof(std::size_t)] % TOKEN_CACHE_SHARDS]; }
+};
+
+} // namespace eventhub
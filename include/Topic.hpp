@@ -1,36 +1,107 @@
 #pragma once
 
 #include <stddef.h>
-#include <list>
+#include <chrono>
+#include <cstdint>
 #include <memory>
-#include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Connection.hpp"
+#include "TopicRegistry.hpp"
 #include "jsonrpc/jsonrpcpp.hpp"
 
 namespace eventhub {
 
-using TopicPtr            = std::shared_ptr<class Topic>;
-using TopicSubscriberList = std::list<std::pair<ConnectionWeakPtr, jsonrpcpp::Id>>;
+using TopicPtr        = std::shared_ptr<class Topic>;
+using TopicMessagePtr = std::shared_ptr<const nlohmann::json>;
 
+/**
+ * A subscriber as stored by its topic.
+ * The connection pointer is raw: a connection unsubscribes from all topics
+ * before it is destroyed, and both are confined to the same worker thread.
+ */
+struct TopicSubscriber {
+  Connection* conn;
+  std::string rpc_id; // Subscription request ID rendered as JSON.
+  TopicSubscriberHandle handle;
+};
+
+/**
+ * Limits how much fan-out work is done in one event loop iteration.
+ * A limit of 0 means no limit.
+ */
+class FanoutBudget final {
+public:
+  FanoutBudget(std::size_t maxSubscribers, std::chrono::microseconds maxTime) :
+    _max_subscribers(maxSubscribers), _has_deadline(maxTime.count() > 0), _delivered(0) {
+    if (_has_deadline) {
+      _deadline = std::chrono::steady_clock::now() + maxTime;
+    }
+  }
+
+  void consume() { _delivered++; }
+  std::size_t delivered() const { return _delivered; }
+
+  bool exhausted() const {
+    if (_max_subscribers > 0 && _delivered >= _max_subscribers) {
+      return true;
+    }
+
+    // Reading the clock for every subscriber would cost more than the
+    // delivery itself, so only look at it every 64 deliveries.
+    if (_has_deadline && (_delivered & 63) == 0 && _delivered > 0) {
+      return std::chrono::steady_clock::now() >= _deadline;
+    }
+
+    return false;
+  }
+
+private:
+  std::size_t _max_subscribers;
+  bool _has_deadline;
+  std::chrono::steady_clock::time_point _deadline;
+  std::size_t _delivered;
+};
+
+/**
+ * Subscribers of a topic or filter. Only used through the TopicManager of a
+ * worker, so it shares its thread confinement and has no lock of its own.
+ *
+ * Subscribers are kept in a contiguous vector so a fan-out is a linear scan,
+ * and removed by swapping in the last one. Handles stay valid while
+ * subscribers move around, they index a table of slot positions.
+ */
 class Topic final {
 public:
-  explicit Topic(const std::string& topicFilter) { _id = topicFilter; }
+  explicit Topic(const InternedTopic& topicFilter) : _name(topicFilter) {}
   ~Topic();
 
-  TopicSubscriberList::iterator addSubscriber(ConnectionPtr conn, const jsonrpcpp::Id subscriptionRequestId);
-  void deleteSubscriberByIterator(TopicSubscriberList::iterator it);
-  void publish(const std::string& data);
-  std::size_t getSubscriberCount();
+  TopicSubscriberHandle addSubscriber(Connection* conn, const jsonrpcpp::Id& subscriptionRequestId);
+  void deleteSubscriber(TopicSubscriberHandle handle);
+  void beginPublish(TopicMessagePtr message, uint64_t seq = 0, const InternedTopic& publishTopic = InternedTopic());
+  bool continuePublish(FanoutBudget& budget);
+  bool hasDelivered(TopicSubscriberHandle handle) const;
+  std::size_t getSubscriberCount() const { return _subscribers.size(); }
+  const InternedTopic& getName() const { return _name; }
+
+  static std::string renderRpcId(const jsonrpcpp::Id& subscriptionRequestId);
+  static void deliver(Connection* conn, const std::string& rpcId, const nlohmann::json& message, const std::string& renderedMessage, const InternedTopic& publishTopic);
+  static void deliver(ConnectionPtr conn, const jsonrpcpp::Id& subscriptionRequestId, const nlohmann::json& message, const InternedTopic& publishTopic = InternedTopic());
 
 private:
-  std::string _id;
-  TopicSubscriberList _subscriber_list;
-  std::mutex _subscriber_lock;
+  InternedTopic _name;
+  std::vector<TopicSubscriber> _subscribers;
+  std::vector<uint32_t> _handle_slots;
+  std::vector<TopicSubscriberHandle> _free_handles;
+  TopicMessagePtr _publish_message;
+  InternedTopic _publish_topic;
+  std::string _publish_rendered;
+  std::size_t _publish_cursor = 0;
+  uint64_t _publish_seq       = 0;
+
+  void _moveSubscriber(std::size_t from, std::size_t to);
 };
 
 }; // namespace eventhub
-
-
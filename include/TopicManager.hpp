@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <memory>
-#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -10,17 +12,38 @@
 #include "Common.hpp"
 #include "Connection.hpp"
 #include "Topic.hpp"
+#include "TopicRegistry.hpp"
+#include "ThreadOwner.hpp"
 #include "jsonrpc/jsonrpcpp.hpp"
 
 namespace eventhub {
 
-using TopicList = std::unordered_map<std::string, TopicPtr>;
+using TopicList = std::unordered_map<TopicId, TopicPtr>;
 
+// Sequence numbers of the first two messages queued for each topic, 0 if there is none.
+using PendingFanoutSeqs = std::unordered_map<const Topic*, std::pair<uint64_t, uint64_t>>;
+
+/**
+ * Topics of a single worker. Confined to the worker thread, see ThreadOwner.
+ *
+ * Topics are keyed by interned ID. A publish looks up the exact topic
+ * directly and only has to match the name against the wildcard filters.
+ */
 class TopicManager final {
 public:
-  std::pair<TopicPtr, TopicSubscriberList::iterator> subscribeConnection(ConnectionPtr conn, const std::string& topicFilter, const jsonrpcpp::Id subscriptionRequestId);
-  void publish(const std::string& topicName, const std::string& data);
-  void deleteTopic(const std::string& topicFilter);
+  std::pair<TopicPtr, TopicSubscriberHandle> subscribeConnection(ConnectionPtr conn, const InternedTopic& topicFilter, const jsonrpcpp::Id subscriptionRequestId);
+  void unsubscribeConnection(TopicSubscription& subscription);
+  void publish(const InternedTopic& topic, const std::string& data, uint64_t seq = 0);
+  bool processFanout(FanoutBudget& budget);
+  bool hasPendingFanout() { return !_fanout_queue.empty(); }
+  std::size_t getPendingFanoutCount() { return _fanout_queue.size(); }
+  PendingFanoutSeqs getPendingFanoutSeqs();
+  uint64_t getDeliveredSeq(const TopicSubscription& subscription, const PendingFanoutSeqs& pending, uint64_t lastSeq);
+  void deleteTopic(const InternedTopic& topicFilter);
+  ThreadOwner& getThreadOwner() { return _owner; }
+
+  // Safe to call from any thread.
+  std::size_t getSubscriptionCount() { return _subscription_count; }
 
   static bool isValidTopic(const std::string& topicName);
   static bool isValidTopicFilter(const std::string& filterName);
@@ -28,7 +51,19 @@ public:
   static bool isFilterMatched(const std::string& filterName, const std::string& topicName);
 
 private:
+  // A message waiting to be delivered to the subscribers of a topic.
+  struct FanoutMessage {
+    TopicPtr topic;
+    TopicMessagePtr message;
+    uint64_t seq;
+    InternedTopic publishTopic;
+  };
+
+  ThreadOwner _owner;
   TopicList _topic_list;
-  std::mutex _topic_list_lock;
+  TopicList _filter_list;
+  std::deque<FanoutMessage> _fanout_queue; // In publish order.
+  bool _fanout_started = false;            // The front message is being delivered.
+  std::atomic<std::size_t> _subscription_count{0};
 };
 } // namespace eventhub
\ No newline at end of file
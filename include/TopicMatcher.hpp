@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace eventhub {
+
+/**
+ * A set of topic filters compiled into a trie of topic levels, so a topic
+ * is matched against all of them in one walk instead of one
+ * TopicManager::isFilterMatched() call per filter. Matches exactly what
+ * isFilterMatched() matches.
+ *
+ * Filters are numbered in the order they are added.
+ */
+class TopicMatcher final {
+public:
+  TopicMatcher();
+
+  std::size_t add(const std::string& filter);
+  void clear();
+  bool matches(std::string_view topic) const;
+  std::optional<std::size_t> findClosestMatch(std::string_view topic) const;
+  std::size_t size() const { return _filter_lengths.size(); }
+
+  static std::string_view nextLevel(std::string_view& rest, bool& hasMore);
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Node {
+    std::vector<std::pair<std::string, uint32_t>> children; // Sorted by level.
+    uint32_t plus     = NONE; // Child for the '+' level.
+    uint32_t terminal = NONE; // First filter ending at this node.
+    uint32_t rest     = NONE; // First filter with '#' as the next level.
+  };
+
+  struct Match {
+    uint32_t filter = NONE;
+    bool exact      = false;
+  };
+
+  std::vector<Node> _nodes;
+  std::vector<std::size_t> _filter_lengths;
+
+  uint32_t _getChild(uint32_t node, std::string_view level);
+  bool _match(uint32_t node, std::string_view rest, bool hasMore, bool exact, bool firstOnly, Match& best) const;
+  bool _addMatch(uint32_t filter, bool exact, bool firstOnly, Match& best) const;
+};
+
+} // namespace eventhub
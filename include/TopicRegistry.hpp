@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace eventhub {
+
+using TopicId = uint32_t;
+
+/**
+ * Process wide table of interned topic and filter names.
+ *
+ * Every distinct name is stored once and has a compact TopicId. Names are
+ * interned where they enter the process, from there on they travel as
+ * InternedTopic handles and are compared and looked up by ID. The table is
+ * sharded by name hash so threads interning different names rarely contend.
+ * An entry lives as long as an InternedTopic refers to it, after that its ID
+ * is reused.
+ */
+class TopicRegistry final {
+public:
+  struct Entry {
+    std::string name;
+    TopicId id;
+    std::atomic<uint32_t> refs;
+  };
+
+  static Entry* acquire(const std::string& name);
+  static void retain(Entry* entry) { entry->refs.fetch_add(1, std::memory_order_relaxed); }
+  static void release(Entry* entry);
+
+  // Number of names currently interned.
+  static std::size_t size();
+};
+
+/**
+ * Reference counted handle to an interned topic or filter name.
+ */
+class InternedTopic final {
+public:
+  InternedTopic() = default;
+  explicit InternedTopic(const std::string& name) : _entry(TopicRegistry::acquire(name)) {}
+  InternedTopic(const InternedTopic& other) : _entry(other._entry) {
+    if (_entry != nullptr) {
+      TopicRegistry::retain(_entry);
+    }
+  }
+  InternedTopic(InternedTopic&& other) noexcept : _entry(other._entry) { other._entry = nullptr; }
+  ~InternedTopic() {
+    if (_entry != nullptr) {
+      TopicRegistry::release(_entry);
+    }
+  }
+
+  InternedTopic& operator=(InternedTopic other) noexcept {
+    std::swap(_entry, other._entry);
+    return *this;
+  }
+
+  TopicId id() const { return _entry->id; }
+  const std::string& name() const { return _entry->name; }
+  bool empty() const { return _entry == nullptr; }
+
+  bool operator==(const InternedTopic& other) const { return _entry == other._entry; }
+  bool operator!=(const InternedTopic& other) const { return _entry != other._entry; }
+
+private:
+  TopicRegistry::Entry* _entry = nullptr;
+};
+
+} // namespace eventhub
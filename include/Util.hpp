@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <chrono>
 #include <string>
+#include <string_view>
 
 namespace eventhub {
 
@@ -16,6 +17,37 @@ public:
   static std::string getSSLErrorString(unsigned long e);
   static std::string getFileMD5Sum(const std::string& filePath);
 
+  /**
+   * Append str to out as a quoted JSON string, escaped like nlohmann::json does.
+   */
+  template <class String>
+  static void appendJsonString(String& out, std::string_view str) {
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+
+    for (const char c : str) {
+      switch (c) {
+        case '"': out.append("\\\"", 2); break;
+        case '\\': out.append("\\\\", 2); break;
+        case '\b': out.append("\\b", 2); break;
+        case '\f': out.append("\\f", 2); break;
+        case '\n': out.append("\\n", 2); break;
+        case '\r': out.append("\\r", 2); break;
+        case '\t': out.append("\\t", 2); break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20) {
+            const char escaped[] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF]};
+            out.append(escaped, sizeof(escaped));
+          } else {
+            out += c;
+          }
+      }
+    }
+
+    out += '"';
+  }
+
 private:
   Util() {}
   ~Util() {}
@@ -12,6 +12,9 @@ namespace metrics {
 class PrometheusRenderer final {
 public:
   static const std::string RenderMetrics(Server* server);
+
+private:
+  static std::string _escapeLabelValue(const std::string& value);
 };
 
 } // namespace metrics
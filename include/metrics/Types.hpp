@@ -2,6 +2,9 @@
 
 #include <atomic>
 #include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace eventhub {
@@ -12,6 +15,20 @@ struct WorkerMetrics {
   std::atomic<unsigned long long> total_connect_count{0};
   std::atomic<unsigned long long> total_disconnect_count{0};
   std::atomic<unsigned long> eventloop_delay_ms{0};
+  std::atomic<unsigned long long> total_migrated_count{0};
+  std::atomic<unsigned long long> slow_consumer_dropped_count{0};
+  std::atomic<unsigned long long> slow_consumer_conflated_count{0};
+  std::atomic<unsigned long long> slow_consumer_disconnect_count{0};
+  std::atomic<unsigned long long> slow_consumer_resume_count{0};
+  std::atomic<unsigned long> output_bytes{0}; // Bytes waiting to be sent to clients.
+  std::atomic<unsigned long long> output_budget_shed_count{0};
+  std::atomic<bool> pinned{false}; // The worker thread is pinned to its CPU.
+};
+
+// Messages dropped and conflated for slow consumers of a topic.
+struct SlowConsumerTopicMetrics {
+  unsigned long long dropped   = 0;
+  unsigned long long conflated = 0;
 };
 
 struct ServerMetrics {
@@ -20,6 +37,10 @@ struct ServerMetrics {
   std::atomic<unsigned long long> publish_count{0};
   std::atomic<unsigned int> redis_connection_fail_count{0};
   std::atomic<unsigned long> redis_publish_delay_ms{0};
+  std::atomic<unsigned int> allowed_cpu_count{0};
+  std::atomic<unsigned int> cpu_quota_millis{0};
+  std::atomic<unsigned int> numa_node_count{0};
+  std::atomic<unsigned long long> rate_limited_count{0};
 };
 
 struct AggregatedMetrics {
@@ -28,21 +49,69 @@ struct AggregatedMetrics {
                         publish_count(0),
                         redis_connection_fail_count(0),
                         redis_publish_delay_ms(0),
+                        allowed_cpu_count(0),
+                        cpu_quota_millis(0),
+                        numa_node_count(0),
+                        pinned_worker_count(0),
                         current_connections_count(0),
                         total_connect_count(0),
                         total_disconnect_count(0),
-                        eventloop_delay_ms(0){};
+                        eventloop_delay_ms(0),
+                        eventloop_delay_max_ms(0),
+                        current_subscription_count(0),
+                        total_migrated_count(0),
+                        pool_blocks_in_use(0),
+                        pool_blocks_free(0),
+                        pool_bytes(0),
+                        jwt_cache_hits(0),
+                        jwt_cache_misses(0),
+                        jwt_cache_size(0),
+                        rate_limited_count(0),
+                        slow_consumer_dropped_count(0),
+                        slow_consumer_conflated_count(0),
+                        slow_consumer_disconnect_count(0),
+                        slow_consumer_resume_count(0),
+                        output_bytes(0),
+                        output_budget_shed_count(0){};
 
   unsigned long server_start_unixtime;
   unsigned int worker_count;
   unsigned long long publish_count;
   unsigned int redis_connection_fail_count;
   unsigned long redis_publish_delay_ms;
+  unsigned int allowed_cpu_count;
+  unsigned int cpu_quota_millis;
+  unsigned int numa_node_count;
+  unsigned int pinned_worker_count;
 
   unsigned long current_connections_count;
   unsigned long long total_connect_count;
   unsigned long long total_disconnect_count;
   unsigned long eventloop_delay_ms;
+  unsigned long eventloop_delay_max_ms;
+  unsigned long current_subscription_count;
+  unsigned long long total_migrated_count;
+
+  unsigned long pool_blocks_in_use;
+  unsigned long pool_blocks_free;
+  unsigned long pool_bytes;
+
+  unsigned long long jwt_cache_hits;
+  unsigned long long jwt_cache_misses;
+  unsigned long jwt_cache_size;
+
+  unsigned long long rate_limited_count;
+  std::vector<std::pair<std::string, unsigned long long>> rate_limited_patterns; // Throttled publishes per rate limit pattern.
+
+  unsigned long long slow_consumer_dropped_count;
+  unsigned long long slow_consumer_conflated_count;
+  unsigned long long slow_consumer_disconnect_count;
+  unsigned long long slow_consumer_resume_count;
+  std::map<std::string, SlowConsumerTopicMetrics> slow_consumer_topics;
+
+  unsigned long output_bytes;
+  std::vector<unsigned long> worker_output_bytes; // Output waiting to be sent, per worker.
+  unsigned long long output_budget_shed_count;
 };
 
 } // namespace metrics
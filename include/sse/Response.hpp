@@ -13,6 +13,7 @@ class Response final {
     static void ok(ConnectionPtr conn);
     static void sendPing(ConnectionPtr conn);
     static void sendEvent(ConnectionPtr conn, const std::string& id, const std::string& message, const std::string& event = "");
+    static void sendEvent(Connection* conn, const std::string& id, const std::string& message, const std::string& event = "");
     static void error(ConnectionPtr conn, const std::string& message, unsigned int statusCode = 404);
 };
 
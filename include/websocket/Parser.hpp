@@ -39,7 +39,6 @@ private:
   std::string _data_payload_buf;
   std::string _control_payload_buf;
   ws_parser_t _ws_parser;
-  ws_parser_callbacks_t _ws_parser_callbacks;
   FrameType _data_frame_type;
   FrameType _control_frame_type;
   ParserCallback _callback;
@@ -13,9 +13,12 @@ namespace websocket {
 class Response final {
   public:
     static void sendData(ConnectionPtr conn, const std::string& data, FrameType frameType);
+    static void sendData(Connection* conn, const std::string& data, FrameType frameType);
+    static void sendData(Connection* conn, const char* data, std::size_t length, FrameType frameType);
+    static void sendPing(ConnectionPtr conn);
 
   private:
-    static void _sendFragment(ConnectionPtr conn, const std::string& fragment, uint8_t frameType, bool fin);
+    static void _sendFragment(Connection* conn, const char* fragment, std::size_t fragmentSize, uint8_t frameType, bool fin);
 };
 
 } // namespace websocket
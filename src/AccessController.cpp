@@ -4,10 +4,13 @@
 #include <string>
 #include <vector>
 #include <exception>
+#include <functional>
 #include <initializer_list>
 #include <memory>
+#include <utility>
 
 #include "AccessController.hpp"
+#include "Common.hpp"
 #include "Config.hpp"
 #include "TopicManager.hpp"
 #include "Logger.hpp"
@@ -21,24 +24,61 @@ namespace eventhub {
   if (!_token_loaded)           \
     return false;
 
-#define BYPASS_AUTH_IF_DISABLED(x)    \
-  if (config().get<bool>("disable_auth")) \
+#define BYPASS_AUTH_IF_DISABLED(x) \
+  if (_auth_disabled)              \
     return true;
 
+AccessController::AccessController(Config& cfg) :
+  EventhubBase(cfg), _token_loaded(false), _auth_disabled(cfg.get<bool>("disable_auth")), _decision_clock(0) {}
 
 // authenticate loads a a JWT token and extracts ACL's for publish and subscribe.
-bool AccessController::authenticate(const std::string& jwtToken, const std::string& secret) {
+// A token found in tokenCache is not verified again.
+bool AccessController::authenticate(const std::string& jwtToken, const std::string& secret, TokenCache* tokenCache) {
   BYPASS_AUTH_IF_DISABLED();
 
-  try {
-    _token = jwt::decode(jwtToken, jwt::params::algorithms({"hs256"}), jwt::params::secret(secret));
+  const bool useCache = tokenCache != nullptr && tokenCache->isEnabled();
+  TokenCache::Digest digest;
+  TokenPermissionsPtr permissions;
+
+  if (useCache) {
+    digest      = TokenCache::digest(jwtToken, secret);
+    permissions = tokenCache->get(digest);
+  }
+
+  if (!permissions) {
+    permissions = _verifyToken(jwtToken, secret);
+
+    if (!permissions) {
+      return false;
+    }
+
+    if (useCache) {
+      tokenCache->put(digest, permissions);
+    }
+  }
+
+  _permissions = std::move(permissions);
+
+  // Decisions made before the token was loaded no longer hold.
+  _decisions.clear();
+  _token_loaded = true;
 
-    auto& payload = _token.payload();
+  return true;
+}
+
+// Verify a token and compile its ACLs.
+// Returns nullptr if the token is invalid or grants nothing.
+TokenPermissionsPtr AccessController::_verifyToken(const std::string& jwtToken, const std::string& secret) {
+  auto permissions = std::make_shared<TokenPermissions>();
+
+  try {
+    auto token    = jwt::decode(jwtToken, jwt::params::algorithms({"hs256"}), jwt::params::secret(secret));
+    auto& payload = token.payload();
 
     if (payload.has_claim("write")) {
       for (auto filter : payload.get_claim_value<std::vector<std::string>>("write")) {
         if (TopicManager::isValidTopicOrFilter(filter)) {
-          _publish_acl.push_back(filter);
+          permissions->publishAcl.add(filter);
         }
       }
     }
@@ -46,37 +86,45 @@ bool AccessController::authenticate(const std::string& jwtToken, const std::stri
     if (payload.has_claim("read")) {
       for (auto filter : payload.get_claim_value<std::vector<std::string>>("read")) {
         if (TopicManager::isValidTopicOrFilter(filter)) {
-          _subscribe_acl.push_back(filter);
+          permissions->subscribeAcl.add(filter);
         }
       }
     }
 
-    if ((_subscribe_acl.size() + _publish_acl.size()) == 0) {
+    if ((permissions->subscribeAcl.size() + permissions->publishAcl.size()) == 0) {
       throw std::invalid_argument("No publish or subscribe ACL defined in JWT token.");
     }
 
     if (payload.has_claim("sub")) {
-      _subject = payload.get_claim_value<std::string>("sub");
+      permissions->subject = payload.get_claim_value<std::string>("sub");
+    }
+
+    if (payload.has_claim("exp")) {
+      permissions->expires = payload.get_claim_value<int64_t>("exp");
     }
 
     if (payload.has_claim("rlimit")) {
       auto payload_json = payload.create_json_obj();
       if (payload_json.is_object() && payload_json["rlimit"].is_array()) {
-        _rlimit.loadFromJSON(payload_json["rlimit"]);
+        permissions->rlimit.loadFromJSON(payload_json["rlimit"]);
       }
     }
   } catch (std::exception& e) {
     LOG->trace("Error in AccessController: ", e.what());
-    return false;
+    return nullptr;
   }
 
-  _token_loaded = true;
-
-  return true;
+  return permissions;
 }
 
 const std::string& AccessController::subject() {
-  return _subject;
+  static const std::string empty;
+  return _permissions ? _permissions->subject : empty;
+}
+
+const RateLimitConfig& AccessController::getRateLimitConfig() {
+  static const RateLimitConfig empty;
+  return _permissions ? _permissions->rlimit : empty;
 }
 
 bool AccessController::isAuthenticated() {
@@ -90,13 +138,12 @@ bool AccessController::allowPublish(const std::string& topic) {
   BYPASS_AUTH_IF_DISABLED();
   REQUIRE_TOKEN_LOADED();
 
-  for (auto& filter : _publish_acl) {
-    if (TopicManager::isFilterMatched(filter, topic)) {
-      return true;
-    }
+  auto& decision = _getDecision(topic);
+  if (decision.publish == Verdict::UNKNOWN) {
+    decision.publish = _permissions->publishAcl.matches(topic) ? Verdict::ALLOW : Verdict::DENY;
   }
 
-  return false;
+  return decision.publish == Verdict::ALLOW;
 }
 
 // allowPublish checks if the loaded token is allowed to subscribe to topic.
@@ -104,13 +151,12 @@ bool AccessController::allowSubscribe(const std::string& topic) {
   BYPASS_AUTH_IF_DISABLED();
   REQUIRE_TOKEN_LOADED();
 
-  for (auto& filter : _subscribe_acl) {
-    if (TopicManager::isFilterMatched(filter, topic)) {
-      return true;
-    }
+  auto& decision = _getDecision(topic);
+  if (decision.subscribe == Verdict::UNKNOWN) {
+    decision.subscribe = _permissions->subscribeAcl.matches(topic) ? Verdict::ALLOW : Verdict::DENY;
   }
 
-  return false;
+  return decision.subscribe == Verdict::ALLOW;
 }
 
 bool AccessController::allowCreateToken(const std::string& path) {
@@ -120,6 +166,39 @@ bool AccessController::allowCreateToken(const std::string& path) {
   return true;
 }
 
+// Get the remembered decisions for topic, replacing the least recently used
+// topic if it is not one of the last ACL_DECISION_CACHE_SIZE.
+AccessController::TopicDecision& AccessController::_getDecision(const std::string& topic) {
+  const auto hash       = std::hash<std::string>{}(topic);
+  TopicDecision* oldest = nullptr;
+
+  _decision_clock++;
+
+  for (auto& decision : _decisions) {
+    if (decision.hash == hash && decision.topic == topic) {
+      decision.lastUse = _decision_clock;
+      return decision;
+    }
+
+    if (oldest == nullptr || decision.lastUse < oldest->lastUse) {
+      oldest = &decision;
+    }
+  }
+
+  if (_decisions.size() < ACL_DECISION_CACHE_SIZE) {
+    _decisions.reserve(ACL_DECISION_CACHE_SIZE);
+    oldest = &_decisions.emplace_back();
+  }
+
+  oldest->topic     = topic;
+  oldest->hash      = hash;
+  oldest->lastUse   = _decision_clock;
+  oldest->publish   = Verdict::UNKNOWN;
+  oldest->subscribe = Verdict::UNKNOWN;
+
+  return *oldest;
+}
+
 
 bool RateLimitConfig::loadFromJSON(const nlohmann::json::array_t& config) {
   for (const auto& rlimit: config) {
@@ -132,6 +211,7 @@ bool RateLimitConfig::loadFromJSON(const nlohmann::json::array_t& config) {
       auto max = rlimit["max"].get<unsigned long>();
 
       _limitConfigs.push_back(rlimit_config_t{topic, interval, max});
+      _matcher.add(topic);
     } catch (...) {
       continue;
     }
@@ -142,38 +222,28 @@ bool RateLimitConfig::loadFromJSON(const nlohmann::json::array_t& config) {
 
 // Returns limits for given topic if there are any.
 // If no limits is defined we throw NoRateLimitForTopic exception.
-const rlimit_config_t RateLimitConfig::getRateLimitForTopic(const std::string& topic) {
-  rlimit_config_t rlimit;
-  bool found = false;
-  std::size_t matchedPatternLen = 0;
+const rlimit_config_t RateLimitConfig::getRateLimitForTopic(const std::string& topic) const {
+  const auto limits = findRateLimitForTopic(topic);
 
+  if (limits == nullptr)
+      throw(NoRateLimitForTopic{});
+
+  return *limits;
+}
+
+// Returns limits for given topic, or nullptr if there are none.
+const rlimit_config_t* RateLimitConfig::findRateLimitForTopic(const std::string& topic) const {
   // Exit early if no limits is present in token.
   if (_limitConfigs.empty())
-    throw(NoRateLimitForTopic{});
-
-  /*
-    Check if we have any limits defined for topic or matching pattern.
-  */
-  for (const auto& limit : _limitConfigs) {
-    // Exact match has highest precedence, use that if we have one.
-    if (limit.topic.compare(topic) == 0) {
-      rlimit = limit;
-      found = true;
-      break;
-    }
+    return nullptr;
 
-    // We check the length here to chose the closest matching pattern if there are more than one.
-    if (TopicManager::isFilterMatched(limit.topic, topic) && limit.topic.length() > matchedPatternLen) {
-        rlimit = limit;
-        found = true;
-        matchedPatternLen = limit.topic.length();
-    }
-  }
+  // An exact match has highest precedence, then the longest matching pattern.
+  const auto match = _matcher.findClosestMatch(topic);
 
-  if (!found)
-      throw(NoRateLimitForTopic{});
+  if (!match)
+    return nullptr;
 
-  return rlimit;
+  return &_limitConfigs[*match];
 }
 
 } // namespace eventhub
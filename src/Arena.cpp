@@ -0,0 +1,108 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+
+#include "Arena.hpp"
+
+namespace eventhub {
+namespace {
+thread_local Arena* currentArena = nullptr;
+
+constexpr std::size_t CHUNK_HEADER_SIZE = (sizeof(void*) * 2 + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+char* alignPointer(char* p, std::size_t alignment) {
+  const auto address = reinterpret_cast<uintptr_t>(p);
+  return p + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+}
+} // namespace
+
+Arena::Scope::Scope(Arena& arena) : _arena(arena), _previous(currentArena) {
+  currentArena = &_arena;
+}
+
+Arena::Scope::~Scope() {
+  currentArena = _previous;
+
+  // A nested scope on the same arena leaves the reset to the outer one.
+  if (_previous != &_arena) {
+    _arena.reset();
+  }
+}
+
+Arena::Arena(std::size_t chunkSize, std::size_t maxRetained) :
+  _chunk_size(chunkSize), _max_retained(maxRetained), _chunks(nullptr), _cursor(nullptr), _end(nullptr), _capacity(0), _chunk_count(0) {}
+
+Arena::~Arena() {
+  _freeChunks();
+}
+
+/**
+ * Get memory that stays valid until the next reset().
+ */
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+  char* p = _cursor != nullptr ? alignPointer(_cursor, alignment) : nullptr;
+
+  if (p == nullptr || p > _end || size > static_cast<std::size_t>(_end - p)) {
+    _addChunk(size + alignment);
+    p = alignPointer(_cursor, alignment);
+  }
+
+  _cursor = p + size;
+  return p;
+}
+
+/**
+ * Rewind the arena. Everything allocated from it is gone.
+ */
+void Arena::reset() {
+  if (_chunks == nullptr) {
+    return;
+  }
+
+  // Replace the chunks with one that holds what this request needed, up to
+  // the retained limit.
+  if (_chunks->next != nullptr || _capacity > _max_retained) {
+    const std::size_t capacity = std::min(_capacity, _max_retained);
+    _freeChunks();
+    _addChunk(capacity);
+  }
+
+  _cursor = reinterpret_cast<char*>(_chunks) + CHUNK_HEADER_SIZE;
+}
+
+Arena* Arena::current() {
+  return currentArena;
+}
+
+void Arena::_addChunk(std::size_t minSize) {
+  const std::size_t size = std::max(_chunk_size, minSize);
+  auto chunk             = static_cast<Chunk*>(malloc(CHUNK_HEADER_SIZE + size));
+
+  if (chunk == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  chunk->next = _chunks;
+  chunk->size = size;
+  _chunks     = chunk;
+  _cursor     = reinterpret_cast<char*>(chunk) + CHUNK_HEADER_SIZE;
+  _end        = _cursor + size;
+  _capacity += size;
+  _chunk_count++;
+}
+
+void Arena::_freeChunks() {
+  while (_chunks != nullptr) {
+    Chunk* next = _chunks->next;
+    free(_chunks);
+    _chunks = next;
+  }
+
+  _cursor      = nullptr;
+  _end         = nullptr;
+  _capacity    = 0;
+  _chunk_count = 0;
+}
+
+} // namespace eventhub
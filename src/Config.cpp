@@ -11,6 +11,65 @@
 namespace eventhub {
 Config::Config() {}
 
+ConfigMap defaultConfigMap() {
+  return {
+    { "listen_port",               ConfigValueType::INT,    "8080",      ConfigValueSettings::REQUIRED },
+    { "worker_threads",            ConfigValueType::INT,    "0",         ConfigValueSettings::REQUIRED },
+    { "jwt_secret",                ConfigValueType::STRING, "FooBarBaz", ConfigValueSettings::REQUIRED },
+    { "log_level",                 ConfigValueType::STRING, "info",      ConfigValueSettings::REQUIRED },
+    { "disable_auth",              ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
+    { "prometheus_metric_prefix",  ConfigValueType::STRING, "eventhub",  ConfigValueSettings::REQUIRED },
+    { "redis_host",                ConfigValueType::STRING, "localhost", ConfigValueSettings::REQUIRED },
+    { "redis_port",                ConfigValueType::INT,    "6379",      ConfigValueSettings::REQUIRED },
+    { "redis_password",            ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
+    { "redis_prefix",              ConfigValueType::STRING, "eventhub",  ConfigValueSettings::OPTIONAL },
+    { "redis_pool_size",           ConfigValueType::INT,    "5",         ConfigValueSettings::REQUIRED },
+    { "enable_cache",              ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
+    { "max_cache_length",          ConfigValueType::INT,    "1000",      ConfigValueSettings::REQUIRED },
+    { "max_cache_request_limit",   ConfigValueType::INT,    "100",       ConfigValueSettings::REQUIRED },
+    { "default_cache_ttl",         ConfigValueType::INT,    "60",        ConfigValueSettings::REQUIRED },
+    { "ping_interval",             ConfigValueType::INT,    "30",        ConfigValueSettings::REQUIRED },
+    { "handshake_timeout",         ConfigValueType::INT,    "5",         ConfigValueSettings::REQUIRED },
+    { "enable_sse",                ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
+    { "enable_ssl",                ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
+    { "ssl_listen_port",           ConfigValueType::INT,    "8443",      ConfigValueSettings::REQUIRED },
+    { "ssl_ca_certificate",        ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
+    { "ssl_certificate",           ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
+    { "ssl_private_key",           ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
+    { "ssl_cert_auto_reload",      ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
+    { "ssl_cert_check_interval",   ConfigValueType::INT,    "300",       ConfigValueSettings::OPTIONAL },
+    { "disable_unsecure_listener", ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
+    { "enable_kvstore",            ConfigValueType::BOOL,   "true",      ConfigValueSettings::REQUIRED },
+    { "publish_batch_size",        ConfigValueType::INT,    "64",        ConfigValueSettings::OPTIONAL },
+    { "publish_batch_latency_us",  ConfigValueType::INT,    "500",       ConfigValueSettings::OPTIONAL },
+    { "fanout_budget_us",          ConfigValueType::INT,    "1000",      ConfigValueSettings::OPTIONAL },
+    { "fanout_budget_subscribers", ConfigValueType::INT,    "0",         ConfigValueSettings::OPTIONAL },
+    { "reuseport_listeners",       ConfigValueType::BOOL,   "true",      ConfigValueSettings::OPTIONAL },
+    { "reuseport_cpu_steering",    ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
+    { "rebalance_interval",        ConfigValueType::INT,    "0",         ConfigValueSettings::OPTIONAL },
+    { "rebalance_threshold",       ConfigValueType::INT,    "25",        ConfigValueSettings::OPTIONAL },
+    { "rebalance_max_migrations",  ConfigValueType::INT,    "100",       ConfigValueSettings::OPTIONAL },
+    { "pin_workers",               ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
+    { "redis_thread_cpu",          ConfigValueType::INT,    "-1",        ConfigValueSettings::OPTIONAL },
+    { "epoll_edge_triggered",      ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
+    { "io_backend",                ConfigValueType::STRING, "epoll",     ConfigValueSettings::OPTIONAL },
+    { "busy_poll_us",              ConfigValueType::INT,    "0",         ConfigValueSettings::OPTIONAL },
+    { "socket_busy_poll_us",       ConfigValueType::INT,    "0",         ConfigValueSettings::OPTIONAL },
+    { "jwt_cache_size",            ConfigValueType::INT,    "10000",     ConfigValueSettings::OPTIONAL },
+    { "rate_limit_algorithm",      ConfigValueType::STRING, "fixed_window", ConfigValueSettings::OPTIONAL },
+    { "rate_limit_mode",           ConfigValueType::STRING, "redis",     ConfigValueSettings::OPTIONAL },
+    { "rate_limit_sync_interval_ms", ConfigValueType::INT,  "1000",      ConfigValueSettings::OPTIONAL },
+    { "slow_consumer_policy",      ConfigValueType::STRING, "disconnect", ConfigValueSettings::OPTIONAL },
+    { "slow_consumer_high_watermark", ConfigValueType::INT,  "1024000",   ConfigValueSettings::OPTIONAL },
+    { "output_budget_bytes",       ConfigValueType::INT,    "0",          ConfigValueSettings::OPTIONAL },
+    { "output_budget_worker_bytes", ConfigValueType::INT,   "0",          ConfigValueSettings::OPTIONAL },
+    { "socket_profile",            ConfigValueType::STRING, "default",   ConfigValueSettings::OPTIONAL },
+    { "ssl_socket_profile",        ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
+    { "tcp_notsent_lowat",         ConfigValueType::INT,    "16384",     ConfigValueSettings::OPTIONAL },
+    { "socket_sndbuf",             ConfigValueType::INT,    "262144",    ConfigValueSettings::OPTIONAL }
+  };
+}
+
 void Config::_loadFromStream(std::istream& data, const std::string& path) {
   std::fstream f;
   std::string line;
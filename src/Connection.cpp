@@ -6,6 +6,8 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <spdlog/logger.h>
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
@@ -18,17 +20,51 @@
 #include "Topic.hpp"
 #include "TopicManager.hpp"
 #include "http/Parser.hpp"
+#include "sse/Response.hpp"
 #include "websocket/Parser.hpp"
+#include "websocket/Response.hpp"
 #include "AccessController.hpp"
 #include "Logger.hpp"
+#include "jwt/json/json.hpp"
 
 namespace eventhub {
 
+/**
+ * Messages held back from a client that can't keep up. Whole messages are
+ * kept apart from the write buffer until it drains, so they can be dropped
+ * or conflated.
+ */
+struct Connection::SlowConsumerState {
+  struct QueuedMessage {
+    InternedTopic topic;
+    std::string rpcId; // Subscription the message was delivered to.
+    std::string data;
+  };
+
+  std::deque<QueuedMessage> backlog;
+  std::size_t backlogBytes      = 0;
+  QueuedMessage* current        = nullptr; // Message being written.
+  bool paused                   = false;
+  unsigned long long gapDropped = 0; // Messages dropped while paused.
+  std::vector<InternedTopic> gapTopics;
+};
+
 Connection::Connection(int fd, struct sockaddr_in* csin, Worker* worker, Config& cfg) :
+  Connection(fd, csin, worker, cfg, worker->getSocketProfile(false)) {}
+
+/**
+ * @param socketProfile Socket profile of the listener the client connected to.
+ */
+Connection::Connection(int fd, struct sockaddr_in* csin, Worker* worker, Config& cfg, SocketProfile socketProfile) :
   EventhubBase(cfg), _fd(fd), _worker(worker) {
 
   _is_shutdown             = false;
   _is_shutdown_after_flush = false;
+  _skip_publish_seq        = 0;
+  _edge_triggered          = cfg.get<bool>("epoll_edge_triggered");
+  _uring_send_in_flight    = false;
+  _uring_poll_out_armed    = false;
+  _output_bytes            = 0;
 
   memcpy(&_csin, csin, sizeof(struct sockaddr_in));
   int flag = 1;
@@ -48,21 +84,32 @@ Connection::Connection(int fd, struct sockaddr_in* csin, Worker* worker, Config&
   // Set TCP_NODELAY on socket.
   setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&flag), sizeof(int));
 
+  // Busy poll the device queue of this socket instead of waiting for interrupts.
+  // Raising it above net.core.busy_read needs CAP_NET_ADMIN.
+  const int busyPoll = cfg.get<int>("socket_busy_poll_us");
+  if (busyPoll > 0 && setsockopt(_fd, SOL_SOCKET, SO_BUSY_POLL, &busyPoll, sizeof(busyPoll)) == -1) {
+    LOG->trace("Could not set SO_BUSY_POLL on client {}: {}.", getIP(), strerror(errno));
+  }
+
+  _applySocketProfile(socketProfile);
+
   LOG->trace("Client {} connected.", getIP());
 
-  _http_parser = std::make_unique<http::Parser>();
-  _websocket_parser = std::make_unique<websocket::Parser>();
-  _access_controller = std::make_unique<AccessController>(cfg);
+  _access_controller = makePooled<AccessController>(worker->getConnectionPools().access_controller, cfg);
+
+  // Count the connection itself as the first sign of life.
+  touchLastPong();
 
   // Set initial state.
   setState(ConnectionState::HTTP);
-
-  _read_buffer.resize(NET_READ_BUFFER_SIZE);
 }
 
 Connection::~Connection() {
   LOG->trace("Client {} disconnected.", getIP());
 
+  _worker->cancelTimer(_handshake_timer);
+  _worker->accountOutputBytes(-static_cast<std::ptrdiff_t>(_output_bytes));
+
   close(_fd);
   unsubscribeAll();
 }
@@ -71,6 +118,20 @@ Connection::~Connection() {
  * Add EPOLLOUT to the list of monitored events for this client.
  */
 void Connection::_enableEpollOut() {
+  // Only TLS connections get here with io_uring, plain ones send through the ring.
+  if (_worker->usesIoUring()) {
+    if (!_uring_poll_out_armed) {
+      _uring_poll_out_armed = true;
+      _worker->pollWritable(getSharedPtr());
+    }
+
+    return;
+  }
+
+  if (_edge_triggered) {
+    return;
+  }
+
   if (_worker->getEpollFileDescriptor() != -1 && !(_epoll_event.events & EPOLLOUT)) {
     _epoll_event.events |= EPOLLOUT;
     epoll_ctl(_worker->getEpollFileDescriptor(), EPOLL_CTL_MOD, _fd, &_epoll_event);
@@ -81,6 +142,10 @@ void Connection::_enableEpollOut() {
  * Remove EPOLLOUT from the list of monitored events for this client.
  */
 void Connection::_disableEpollOut() {
+  if (_edge_triggered || _worker->usesIoUring()) {
+    return;
+  }
+
   if (_worker->getEpollFileDescriptor() != -1 && (_epoll_event.events & EPOLLOUT)) {
     _epoll_event.events &= ~EPOLLOUT;
     epoll_ctl(_worker->getEpollFileDescriptor(), EPOLL_CTL_MOD, _fd, &_epoll_event);
@@ -96,7 +161,8 @@ std::size_t Connection::_pruneWriteBuffer(std::size_t bytes) {
   }
 
   if (bytes >= _write_buffer.length()) {
-    _write_buffer.clear();
+    // Give the memory back, most connections are idle most of the time.
+    std::string().swap(_write_buffer);
     return 0;
   }
 
@@ -108,39 +174,72 @@ std::size_t Connection::_pruneWriteBuffer(std::size_t bytes) {
  * Read from client, parse and call the correct handler.
  */
 void Connection::read() {
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
+
   if (isShutdown()) {
     return;
   }
 
-  // Keep the backing storage intact so _read_buffer.data() never dangles; we
-  // previously cleared the vector here, which left ::read() writing through a
-  // null pointer on some STL implementations.
-  ssize_t bytesRead = ::read(_fd, _read_buffer.data(), _read_buffer.size());
+  auto& buffer = _worker->getReadBuffer();
 
-  if (bytesRead <= 0) {
-    if (errno != EAGAIN) {
+  // An edge-triggered socket is only reported again when new data arrives,
+  // so drain it completely.
+  do {
+    ssize_t bytesRead = ::read(_fd, buffer.data(), buffer.size());
+
+    if (bytesRead == 0) {
       shutdown();
+      return;
+    }
+
+    if (bytesRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        shutdown();
+      }
+
+      return;
     }
 
+    _parseRequest(buffer.data(), bytesRead);
+  } while (_edge_triggered && !isShutdown());
+}
+
+/**
+ * Handle data the worker io_uring has received for us.
+ */
+void Connection::onReceive(char* data, std::size_t len) {
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
+
+  if (isShutdown()) {
     return;
   }
 
-  _parseRequest(bytesRead);
+  _parseRequest(data, len);
 }
 
 /**
- * Parse the request present in our read buffer and call the correct handler.
+ * Parse received data and call the correct handler.
  */
-void Connection::_parseRequest(std::size_t bytesRead) {
+void Connection::_parseRequest(char* data, std::size_t len) {
   // Redirect request to either HTTP handler or websocket handler
   // based on which state the client is in.
   switch (getState()) {
     case ConnectionState::HTTP:
-      _http_parser->parse(_read_buffer.data(), bytesRead);
+      _getHTTPParser()->parse(data, len);
+
+      // Done with the handshake. Not dropped in setState(), which runs
+      // from within the parser callback.
+      if (getState() != ConnectionState::HTTP) {
+        _http_parser.reset();
+      }
       break;
 
     case ConnectionState::WEBSOCKET:
-      _websocket_parser->parse(_read_buffer.data(), bytesRead);
+      _getWebsocketParser()->parse(data, len);
       break;
 
     default:
@@ -153,24 +252,280 @@ void Connection::_parseRequest(std::size_t bytesRead) {
  * Add data to send buffer and enable EPOLLOUT on the socket.
  */
 void Connection::write(const std::string& data) {
-  std::lock_guard<std::mutex> lock(_write_lock);
+  write(data.c_str(), data.length());
+}
 
-  if (isShutdown()) {
+/**
+ * Send data to the client. When nothing is waiting in the write buffer the
+ * data goes straight to the socket and only what it doesn't take is copied
+ * into the buffer.
+ */
+void Connection::write(const char* data, std::size_t length) {
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
+
+  if (isShutdown() || length == 0) {
     return;
   }
 
-  if ((_write_buffer.length() + data.length()) > NET_WRITE_BUFFER_MAX) {
+  OutputAccountingScope accounting{this};
+
+  if (_slow_consumer && _slow_consumer->current != nullptr) {
+    _slow_consumer->current->data.append(data, length);
+    _slow_consumer->backlogBytes += length;
+    return;
+  }
+
+  if ((_write_buffer.length() + length) > NET_WRITE_BUFFER_MAX) {
     _write_buffer.clear();
     shutdown();
     LOG->error("Client {} exceeded max write buffer size of {}.", getIP(), NET_WRITE_BUFFER_MAX);
     return;
   }
 
-  _write_buffer.append(data);
+  // TLS writes always go through the write buffer. A SSL_write() that has
+  // to be retried must be given the same data again.
+  if (_write_buffer.empty() && !isSSL() && !_uring_send_in_flight && !_worker->usesIoUring()) {
+    const std::size_t written = _writeDirect(data, length);
 
-  if (!_write_buffer.empty()) {
-    flushSendBuffer();
+    if (written == length || isShutdown()) {
+      return;
+    }
+
+    // The socket is full, wait for it to become writable instead of trying
+    // again right away.
+    _write_buffer.append(data + written, length - written);
+    _enableEpollOut();
+    return;
   }
+
+  _write_buffer.append(data, length);
+  flushSendBuffer();
+}
+
+/**
+ * Start writing a published message. A client whose write buffer has
+ * reached slow_consumer_high_watermark is lagging, and its messages are
+ * handled by the slow consumer policy of the worker until it catches up.
+ * @param topic Topic the message was published to.
+ * @param rpcId ID of the subscription the message is delivered to. Messages
+ *              are only conflated with earlier ones of the same subscription.
+ * @returns false if the message should not be written.
+ */
+bool Connection::beginMessage(const InternedTopic& topic, const std::string& rpcId) {
+  // Fan-out to lagging clients is throttled while the output budget is exceeded.
+  const auto highWatermark = _worker->isOverOutputBudget() ? _worker->getSlowConsumerHighWatermark() / OUTPUT_BUDGET_WATERMARK_DIVISOR
+                                                           : _worker->getSlowConsumerHighWatermark();
+
+  if (isShutdown() || (_write_buffer.length() < highWatermark && !_hasBacklog())) {
+    return !isShutdown();
+  }
+
+  switch (_worker->getSlowConsumerPolicy()) {
+    case SlowConsumerPolicy::DISCONNECT:
+      LOG->debug("Client {} is too slow, {} bytes waiting to be sent. Disconnecting.", getIP(), _write_buffer.length());
+      _worker->countSlowConsumer(SlowConsumerAction::DISCONNECTED, topic);
+      shutdown();
+      return false;
+
+    case SlowConsumerPolicy::PAUSE: {
+      if (!_slow_consumer) {
+        _slow_consumer = std::make_unique<SlowConsumerState>();
+      }
+
+      auto& gapTopics = _slow_consumer->gapTopics;
+      if (gapTopics.size() < SLOW_CONSUMER_GAP_MAX_TOPICS && std::find(gapTopics.begin(), gapTopics.end(), topic) == gapTopics.end()) {
+        gapTopics.push_back(topic);
+      }
+
+      _slow_consumer->paused = true;
+      _slow_consumer->gapDropped++;
+      _worker->countSlowConsumer(SlowConsumerAction::DROPPED, topic);
+      return false;
+    }
+
+    case SlowConsumerPolicy::CONFLATE:
+      if (_slow_consumer) {
+        for (auto& queued : _slow_consumer->backlog) {
+          if (queued.topic == topic && queued.rpcId == rpcId) {
+            _slow_consumer->backlogBytes -= queued.data.length();
+            queued.data.clear();
+            _slow_consumer->current = &queued;
+            _worker->countSlowConsumer(SlowConsumerAction::CONFLATED, topic);
+            return true;
+          }
+        }
+      }
+      break;
+
+    case SlowConsumerPolicy::DROP_OLDEST:
+      break;
+  }
+
+  if (!_slow_consumer) {
+    _slow_consumer = std::make_unique<SlowConsumerState>();
+  }
+
+  _slow_consumer->backlog.push_back({topic, rpcId, std::string()});
+  _slow_consumer->current = &_slow_consumer->backlog.back();
+
+  return true;
+}
+
+/**
+ * Done writing the message started with beginMessage(). Queued messages
+ * are dropped, oldest first, to keep the queue within the high watermark.
+ */
+void Connection::endMessage() {
+  if (!_slow_consumer || _slow_consumer->current == nullptr) {
+    return;
+  }
+
+  OutputAccountingScope accounting{this};
+  auto& sc   = *_slow_consumer;
+  sc.current = nullptr;
+
+  while (sc.backlogBytes > _worker->getSlowConsumerHighWatermark() && sc.backlog.size() > 1) {
+    _worker->countSlowConsumer(SlowConsumerAction::DROPPED, sc.backlog.front().topic);
+    sc.backlogBytes -= sc.backlog.front().data.length();
+    sc.backlog.pop_front();
+  }
+}
+
+/**
+ * Drop everything waiting to be sent to the client and disconnect it, to
+ * bring the output of the worker back within budget.
+ * @returns Bytes released.
+ */
+std::size_t Connection::shedOutput() {
+  const auto bytes = _output_bytes;
+
+  LOG->debug("Client {} has {} bytes waiting to be sent, disconnecting to stay within the output budget.", getIP(), bytes);
+
+  std::string().swap(_write_buffer);
+  _slow_consumer.reset();
+  _accountOutput();
+  shutdown();
+
+  return bytes;
+}
+
+/**
+ * Report changes in what is waiting to be sent to the worker.
+ */
+void Connection::_accountOutput() {
+  const std::size_t bytes = _write_buffer.length() + (_slow_consumer ? _slow_consumer->backlogBytes : 0);
+
+  if (bytes == _output_bytes) {
+    return;
+  }
+
+  if (_output_bytes == 0) {
+    _output_since = std::chrono::steady_clock::now();
+  }
+
+  _worker->accountOutputBytes(static_cast<std::ptrdiff_t>(bytes) - static_cast<std::ptrdiff_t>(_output_bytes));
+  _output_bytes = bytes;
+}
+
+/**
+ * Check if there are messages held back from the client.
+ */
+bool Connection::_hasBacklog() const {
+  return _slow_consumer && (!_slow_consumer->backlog.empty() || _slow_consumer->paused);
+}
+
+/**
+ * Move held back messages to the write buffer once it has drained below
+ * half the high watermark. A paused client is first told how many messages
+ * it missed, so it can fetch them from the cache.
+ */
+void Connection::_refillFromBacklog() {
+  const auto highWatermark = _worker->getSlowConsumerHighWatermark();
+
+  if (!_slow_consumer || _write_buffer.length() >= highWatermark / 2) {
+    return;
+  }
+
+  auto& sc = *_slow_consumer;
+
+  if (sc.paused) {
+    nlohmann::json params;
+    params["dropped"] = sc.gapDropped;
+    params["topics"]  = nlohmann::json::array();
+
+    for (const auto& topic : sc.gapTopics) {
+      params["topics"].push_back(topic.name());
+    }
+
+    // Written through the backlog so it goes out ahead of anything queued.
+    sc.backlog.push_front({InternedTopic(), std::string()});
+    sc.current = &sc.backlog.front();
+
+    if (_state == ConnectionState::WEBSOCKET) {
+      websocket::Response::sendData(this, nlohmann::json{{"jsonrpc", "2.0"}, {"method", "gap"}, {"params", params}}.dump(), websocket::FrameType::TEXT_FRAME);
+    } else if (_state == ConnectionState::SSE) {
+      write("event: gap\ndata: " + params.dump() + "\n\n");
+    }
+
+    sc.current    = nullptr;
+    sc.paused     = false;
+    sc.gapDropped = 0;
+    sc.gapTopics.clear();
+    _worker->countSlowConsumer(SlowConsumerAction::RESUMED, InternedTopic());
+  }
+
+  while (!sc.backlog.empty() && _write_buffer.length() < highWatermark) {
+    // Leave what would not fit for the next refill, instead of overflowing
+    // the write buffer and getting the client disconnected.
+    if (!_write_buffer.empty() && _write_buffer.length() + sc.backlog.front().data.length() > NET_WRITE_BUFFER_MAX) {
+      break;
+    }
+
+    _write_buffer.append(sc.backlog.front().data);
+    sc.backlogBytes -= sc.backlog.front().data.length();
+    sc.backlog.pop_front();
+  }
+
+  if (sc.backlog.empty()) {
+    _slow_consumer.reset();
+  }
+}
+
+/**
+ * Write to the socket without going through the write buffer.
+ * @returns Bytes written, the connection is shut down on errors.
+ */
+std::size_t Connection::_writeDirect(const char* data, std::size_t length) {
+  ssize_t ret               = 0;
+  const std::size_t written = _writeSocket(data, length, ret);
+
+  if (ret <= 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    LOG->trace("Client {} write error: {}.", getIP(), strerror(errno));
+    shutdown();
+  }
+
+  return written;
+}
+
+/**
+ * Write as much of data as the socket takes.
+ * @param ret Result of the last write() call.
+ * @returns Bytes written.
+ */
+std::size_t Connection::_writeSocket(const char* data, std::size_t length, ssize_t& ret) {
+  std::size_t written = 0;
+
+  // An edge-triggered socket is only reported writable again after a write
+  // has hit EAGAIN, so keep writing until then.
+  do {
+    ret = ::write(_fd, data + written, length - written);
+
+    if (ret > 0) {
+      written += ret;
+    }
+  } while (_edge_triggered && ret > 0 && written < length);
+
+  return written;
 }
 
 /**
@@ -178,27 +533,35 @@ void Connection::write(const std::string& data) {
  * This function is only called when we have an EPOLLOUT event.
  **/
 ssize_t Connection::flushSendBuffer() {
+  OutputAccountingScope accounting{this};
+  _refillFromBacklog();
+
   if (_write_buffer.empty() || isShutdown()) {
     _disableEpollOut();
     return 0;
   }
 
-  ssize_t ret = ::write(_fd, _write_buffer.c_str(), _write_buffer.length());
+  if (_worker->usesIoUring()) {
+    return _submitSend();
+  }
 
-  if (ret <= 0) {
-    if (errno != EAGAIN && errno != EWOULDBLOCK) {
-      LOG->trace("Client {} write error: {}.", getIP(), strerror(errno));
-      shutdown();
-    } else {
-      _enableEpollOut();
-    }
-  } else if ((std::size_t)ret < _write_buffer.length()) {
-    LOG->trace("Client {} could not write() entire buffer, wrote {} of {} bytes.", getIP(), ret, _write_buffer.length());
-    _pruneWriteBuffer(ret);
+  ssize_t ret               = 0;
+  const std::size_t written = _writeSocket(_write_buffer.c_str(), _write_buffer.length(), ret);
+
+  if (ret <= 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    LOG->trace("Client {} write error: {}.", getIP(), strerror(errno));
+    shutdown();
+  } else if (written < _write_buffer.length()) {
+    LOG->trace("Client {} could not write() entire buffer, wrote {} of {} bytes.", getIP(), written, _write_buffer.length());
+    _pruneWriteBuffer(written);
     _enableEpollOut();
   } else {
     _disableEpollOut();
-    _write_buffer.clear();
+    std::string().swap(_write_buffer);
+
+    if (_hasBacklog()) {
+      return flushSendBuffer();
+    }
   }
 
   if (_write_buffer.empty() && _is_shutdown_after_flush) {
@@ -208,6 +571,59 @@ ssize_t Connection::flushSendBuffer() {
   return ret;
 }
 
+/**
+ * Hand the write buffer to the io_uring of our worker. Only one send is in
+ * flight at a time, data written meanwhile goes out when it completes.
+ */
+ssize_t Connection::_submitSend() {
+  if (_uring_send_in_flight) {
+    return 0;
+  }
+
+  auto buffer = std::make_shared<std::string>();
+  buffer->swap(_write_buffer);
+  _uring_send_in_flight = true;
+
+  if (!_worker->submitSend(getSharedPtr(), buffer, 0)) {
+    LOG->trace("Client {} could not queue send: {}.", getIP(), strerror(errno));
+    _uring_send_in_flight = false;
+    shutdown();
+    return -1;
+  }
+
+  return buffer->length();
+}
+
+/**
+ * Called by the worker when a send submitted with _submitSend() is done.
+ */
+void Connection::onSendComplete(bool success) {
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
+  OutputAccountingScope accounting{this};
+  _uring_send_in_flight = false;
+
+  if (!success) {
+    LOG->trace("Client {} send failed.", getIP());
+    shutdown();
+    return;
+  }
+
+  if (!_write_buffer.empty() || _hasBacklog()) {
+    flushSendBuffer();
+  } else if (_is_shutdown_after_flush) {
+    shutdown();
+  }
+}
+
+/**
+ * Called by the worker when the socket of a TLS connection polled with
+ * _enableEpollOut() is writable.
+ */
+void Connection::onWritable() {
+  _uring_poll_out_armed = false;
+  flushSendBuffer();
+}
+
 /**
  * Shut down the connection.
  */
@@ -223,7 +639,7 @@ void Connection::shutdown() {
  * written to the client.
  */
 void Connection::shutdownAfterFlush() {
-  if (_write_buffer.empty()) {
+  if (_write_buffer.empty() && !_uring_send_in_flight && !_hasBacklog()) {
     shutdown();
     return;
   }
@@ -231,6 +647,60 @@ void Connection::shutdownAfterFlush() {
   _is_shutdown_after_flush = true;
 }
 
+bool Connection::parseSlowConsumerPolicy(const std::string& name, SlowConsumerPolicy& policy) {
+  if (name == "disconnect") {
+    policy = SlowConsumerPolicy::DISCONNECT;
+  } else if (name == "drop_oldest") {
+    policy = SlowConsumerPolicy::DROP_OLDEST;
+  } else if (name == "conflate") {
+    policy = SlowConsumerPolicy::CONFLATE;
+  } else if (name == "pause") {
+    policy = SlowConsumerPolicy::PAUSE;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+bool Connection::parseSocketProfile(const std::string& name, SocketProfile& profile) {
+  if (name == "default") {
+    profile = SocketProfile::DEFAULT;
+  } else if (name == "latency") {
+    profile = SocketProfile::LATENCY;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * The latency profile caps what the kernel holds for the client. Once
+ * tcp_notsent_lowat bytes are waiting to go out, writes come back short and
+ * the rest stays in our write buffer until EPOLLOUT, so the slow consumer
+ * policy drops or conflates fresh messages instead of queueing them behind
+ * stale ones in the kernel.
+ */
+void Connection::_applySocketProfile(SocketProfile profile) {
+  if (profile != SocketProfile::LATENCY) {
+    return;
+  }
+
+#ifdef TCP_NOTSENT_LOWAT
+  const int notSentLowat = config().get<int>("tcp_notsent_lowat");
+  if (notSentLowat > 0 && setsockopt(_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &notSentLowat, sizeof(notSentLowat)) == -1) {
+    LOG->trace("Could not set TCP_NOTSENT_LOWAT on client {}: {}.", getIP(), strerror(errno));
+  }
+#endif
+
+  // Fixing the size turns off send buffer autotuning for the socket.
+  const int sendBuffer = config().get<int>("socket_sndbuf");
+  if (sendBuffer > 0 && setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer)) == -1) {
+    LOG->trace("Could not set SO_SNDBUF on client {}: {}.", getIP(), strerror(errno));
+  }
+}
+
 const std::string Connection::getIP() {
   char ip[32];
   inet_ntop(AF_INET, &_csin.sin_addr, reinterpret_cast<char*>(&ip), 32);
@@ -239,6 +709,12 @@ const std::string Connection::getIP() {
 }
 
 int Connection::addToEpoll(uint32_t epollEvents) {
+  // Edge-triggered sockets are registered once for both directions and
+  // never modified afterwards.
+  if (_edge_triggered) {
+    epollEvents |= EPOLLOUT | EPOLLET;
+  }
+
   _epoll_event.events   = epollEvents;
   _epoll_event.data.fd  = _fd;
   _epoll_event.data.ptr = static_cast<void*>(this);
@@ -257,8 +733,9 @@ int Connection::removeFromEpoll() {
 }
 
 ConnectionState Connection::setState(ConnectionState newState) {
-  if (newState == ConnectionState::WEBSOCKET && _http_parser.get()) {
-    _http_parser.reset();
+  // The handshake timeout no longer applies once the handshake is done.
+  if (newState != ConnectionState::HTTP) {
+    _worker->cancelTimer(_handshake_timer);
   }
 
   _state = newState;
@@ -266,34 +743,64 @@ ConnectionState Connection::setState(ConnectionState newState) {
 }
 
 void Connection::subscribe(const std::string& topicPattern, const jsonrpcpp::Id subscriptionRequestId) {
-  std::lock_guard<std::mutex> lock(_subscription_list_lock);
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
   auto tm = _worker->getTopicManager();
+  InternedTopic topic(topicPattern);
 
-  if (_subscribedTopics.count(topicPattern)) {
+  if (_subscribedTopics.count(topic.id())) {
     return;
   }
 
-  auto topicSubscription = tm->subscribeConnection(getSharedPtr(), topicPattern, subscriptionRequestId);
-  _subscribedTopics.insert(std::make_pair(topicPattern, TopicSubscription{topicSubscription.first, topicSubscription.second, subscriptionRequestId}));
+  // The topic holds on to the interned name, which keeps the ID valid as a key.
+  auto topicSubscription = tm->subscribeConnection(getSharedPtr(), topic, subscriptionRequestId);
+  _subscribedTopics.insert(std::make_pair(topic.id(), TopicSubscription{topicSubscription.first, topicSubscription.second, subscriptionRequestId}));
 }
 
 ConnectionState Connection::getState() {
   return _state;
 }
 
+/**
+ * Replace the default websocket callback, which hands frames to the worker.
+ */
 void Connection::onWebsocketRequest(websocket::ParserCallback callback) {
-  _websocket_parser->setCallback(callback);
+  _getWebsocketParser()->setCallback(callback);
 }
 
+/**
+ * Replace the default HTTP callback, which hands requests to the worker.
+ */
 void Connection::onHTTPRequest(http::ParserCallback callback) {
-  _http_parser->setCallback(callback);
+  _getHTTPParser()->setCallback(callback);
+}
+
+http::Parser* Connection::_getHTTPParser() {
+  if (!_http_parser) {
+    _http_parser = makePooled<http::Parser>(_worker->getConnectionPools().http_parser);
+    _http_parser->setCallback([this](http::Parser* req, http::RequestState reqState) {
+      _worker->handleHTTPRequest(getSharedPtr(), req, reqState);
+    });
+  }
+
+  return _http_parser.get();
+}
+
+websocket::Parser* Connection::_getWebsocketParser() {
+  if (!_websocket_parser) {
+    _websocket_parser = makePooled<websocket::Parser>(_worker->getConnectionPools().websocket_parser);
+    _websocket_parser->setCallback([this](websocket::ParserStatus status, websocket::FrameType frameType, const std::string& data) {
+      _worker->handleWebsocketRequest(getSharedPtr(), status, frameType, data);
+    });
+  }
+
+  return _websocket_parser.get();
 }
 
 AccessController* Connection::getAccessController() {
   return _access_controller.get();
 }
 
-void Connection::assignConnectionListIterator(std::list<ConnectionPtr>::iterator connectionIterator) {
+void Connection::assignConnectionListIterator(ConnectionListIterator connectionIterator) {
   _connection_list_iterator = connectionIterator;
 }
 
@@ -306,40 +813,27 @@ ConnectionPtr Connection::getSharedPtr() {
 }
 
 bool Connection::unsubscribe(const std::string& topicPattern) {
-  std::lock_guard<std::mutex> lock(_subscription_list_lock);
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
   auto tm = _worker->getTopicManager();
 
-  if (_subscribedTopics.count(topicPattern) == 0) {
+  auto it = _subscribedTopics.find(InternedTopic(topicPattern).id());
+  if (it == _subscribedTopics.end()) {
     return false;
   }
 
-  auto it            = _subscribedTopics.find(topicPattern);
-  auto& subscription = it->second;
-
-  subscription.topic->deleteSubscriberByIterator(subscription.topicListIterator);
-
-  if (subscription.topic->getSubscriberCount() == 0) {
-    tm->deleteTopic(topicPattern);
-  }
-
+  tm->unsubscribeConnection(it->second);
   _subscribedTopics.erase(it);
 
   return true;
 }
 
 std::size_t Connection::unsubscribeAll() {
-  std::lock_guard<std::mutex> lock(_subscription_list_lock);
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
   auto tm    = _worker->getTopicManager();
   auto count = _subscribedTopics.size();
 
   for (auto it = _subscribedTopics.begin(); it != _subscribedTopics.end();) {
-    auto& subscription = it->second;
-    subscription.topic->deleteSubscriberByIterator(subscription.topicListIterator);
-
-    if (subscription.topic->getSubscriberCount() == 0) {
-      tm->deleteTopic(it->first);
-    }
-
+    tm->unsubscribeConnection(it->second);
     it = _subscribedTopics.erase(it);
   }
 
@@ -347,14 +841,33 @@ std::size_t Connection::unsubscribeAll() {
 }
 
 std::vector<std::string> Connection::listSubscriptions() {
-  std::lock_guard<std::mutex> lock(_subscription_list_lock);
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
   std::vector<std::string> subscriptionList;
 
   for (auto& topic : _subscribedTopics) {
-    subscriptionList.push_back(topic.first);
+    subscriptionList.push_back(topic.second.topic->getName().name());
   }
 
   return subscriptionList;
 }
 
+/**
+ * Check if the connection can be moved to another worker.
+ * Only established websocket and SSE connections without unsent data are moved.
+ */
+bool Connection::isMigratable() {
+  ASSERT_OWNER_THREAD(_worker->getThreadOwner());
+
+  if (isShutdown() || _is_shutdown_after_flush || !_write_buffer.empty() || _hasBacklog()) {
+    return false;
+  }
+
+  // Requests in flight on the io_uring of a worker are tied to that worker.
+  if (_worker->usesIoUring()) {
+    return false;
+  }
+
+  return _state == ConnectionState::WEBSOCKET || _state == ConnectionState::SSE;
+}
+
 } // namespace eventhub
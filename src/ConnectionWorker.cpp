@@ -8,8 +8,10 @@
 #include "http/Parser.hpp"
 #include "websocket/Types.hpp"
 #ifdef __linux__
+#include <poll.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <sys/timerfd.h>
 #else
 #error "eventhub worker requires Linux (epoll/eventfd/timerfd)"
@@ -17,20 +19,25 @@
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <exception>
 #include <memory>
-#include <mutex>
 #include <string>
 #include <atomic>
 #include <type_traits>
+#include <vector>
 
 #include "Common.hpp"
 #include "Config.hpp"
+#include "CpuTopology.hpp"
 #include "Connection.hpp"
 #include "EventLoop.hpp"
 #include "HandlerContext.hpp"
 #include "SSLConnection.hpp"
 #include "Server.hpp"
+#include "Topic.hpp"
 #include "TopicManager.hpp"
 #include "Util.hpp"
 #include "http/Handler.hpp"
@@ -38,9 +45,64 @@
 #include "websocket/Handler.hpp"
 #include "websocket/Response.hpp"
 
+// Per-epoll NAPI busy poll parameters, Linux 6.9 and newer. Older headers lack them.
+#ifndef EPIOCSPARAMS
+struct epoll_params {
+  uint32_t busy_poll_usecs;
+  uint16_t busy_poll_budget;
+  uint8_t prefer_busy_poll;
+  uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
 namespace eventhub {
 
-Worker::Worker(Server* srv, unsigned int workerId) : EventhubBase(srv->config()), _workerId(workerId) {
+ConnectionPools::ConnectionPools() {
+  _all = {
+    connection        = new SlabPool("connection"),
+    ssl_connection    = new SlabPool("ssl_connection"),
+    list_node         = new SlabPool("connection_list_node"),
+    http_parser       = new SlabPool("http_parser"),
+    websocket_parser  = new SlabPool("websocket_parser"),
+    access_controller = new SlabPool("access_controller"),
+  };
+}
+
+ConnectionPools::~ConnectionPools() {
+  for (auto pool : _all) {
+    pool->orphan();
+  }
+}
+
+void ConnectionPools::bind() {
+  for (auto pool : _all) {
+    pool->getThreadOwner().bind();
+  }
+}
+
+void ConnectionPools::release() {
+  for (auto pool : _all) {
+    pool->getThreadOwner().release();
+  }
+}
+
+SlabPoolStats ConnectionPools::getStats() const {
+  SlabPoolStats total;
+
+  for (auto pool : _all) {
+    const auto stats = pool->getStats();
+    total.blocks_in_use += stats.blocks_in_use;
+    total.blocks_free += stats.blocks_free;
+    total.bytes += stats.bytes;
+  }
+
+  return total;
+}
+
+Worker::Worker(Server* srv, unsigned int workerId, int cpu) :
+  EventhubBase(srv->config()), _workerId(workerId), _cpu(cpu), _connection_list(PoolAllocator<ConnectionPtr>(_pools.list_node)),
+  _rpc_arena(RPC_ARENA_CHUNK_SIZE, RPC_ARENA_MAX_RETAINED) {
   _server   = srv;
   _epoll_fd = epoll_create1(0);
   _event_fd = -1;
@@ -49,18 +111,59 @@ Worker::Worker(Server* srv, unsigned int workerId) : EventhubBase(srv->config())
   _ev = std::make_unique<EventLoop>();
   _topic_manager = std::make_unique<TopicManager>();
 
+  _ping_cursor       = _connection_list.end();
+  _ping_sweep_credit = 0;
+  _last_publish_seq  = 0;
+  _uring_ops         = nullptr;
+  _uring_stopping    = false;
+  _busy_poll_window  = std::chrono::microseconds(std::max(0, config().get<int>("busy_poll_us")));
+  _spinning          = false;
+
+  // Server::start() refuses unknown policies.
+  if (!Connection::parseSlowConsumerPolicy(config().get<std::string>("slow_consumer_policy"), _slow_consumer_policy)) {
+    _slow_consumer_policy = SlowConsumerPolicy::DISCONNECT;
+  }
+
+  const auto highWatermark      = static_cast<std::size_t>(std::max(1, config().get<int>("slow_consumer_high_watermark")));
+  _slow_consumer_high_watermark = std::min(highWatermark, NET_WRITE_BUFFER_MAX - SLOW_CONSUMER_WATERMARK_HEADROOM);
+  _slow_consumer_topics_changed = false;
+
+  _output_budget_bytes        = static_cast<std::size_t>(std::max(0, config().get<int>("output_budget_bytes")));
+  _output_budget_worker_bytes = static_cast<std::size_t>(std::max(0, config().get<int>("output_budget_worker_bytes")));
+  _over_output_budget         = false;
+
+  // Server::start() refuses unknown profiles. The SSL listener uses socket_profile unless it has its own.
+  const auto& sslSocketProfile = config().get<std::string>("ssl_socket_profile");
+  if (!Connection::parseSocketProfile(config().get<std::string>("socket_profile"), _socket_profile)) {
+    _socket_profile = SocketProfile::DEFAULT;
+  }
+
+  if (sslSocketProfile.empty() || !Connection::parseSocketProfile(sslSocketProfile, _ssl_socket_profile)) {
+    _ssl_socket_profile = _socket_profile;
+  }
+
+  _initListenSockets();
   _initEventFd();
   _initTimerFd();
+
+  if (config().get<std::string>("io_backend") == "io_uring") {
+    _initIoUring();
+  }
 }
 
 Worker::~Worker() {
   if (_epoll_fd != -1) {
     close(_epoll_fd);
   }
+  _closeListenSockets();
   _closeEventFd();
   _closeTimerFd();
 
-  std::lock_guard<std::mutex> lock(_connection_list_mutex);
+  // Close the ring before releasing the buffers of requests still in flight.
+  _ring.reset();
+  while (_uring_ops != nullptr) {
+    _freeUringOp(_uring_ops);
+  }
 
   for (auto it = _connection_list.begin(); it != _connection_list.end();) {
     it = _connection_list.erase(it);
@@ -69,9 +172,58 @@ Worker::~Worker() {
   LOG->debug("Connection worker {} shutting down.", getWorkerId());
 }
 
-void Worker::addTimer(int64_t delay, std::function<void(TimerCtx* ctx)> callback, bool repeat) {
-  _ev->addTimer(delay, callback, repeat);
-  _armTimerFd();
+TimerHandle Worker::addTimer(int64_t delay, std::function<void(TimerCtx* ctx)> callback, bool repeat) {
+  auto handle = _ev->addTimer(delay, callback, repeat);
+
+  // The io_uring loop computes its wait timeout from the timers on every iteration.
+  if (!_ring) {
+    _armTimerFd();
+  }
+
+  return handle;
+}
+
+/**
+ * With reuseport_listeners each worker gets its own SO_REUSEPORT listening
+ * sockets and the kernel spreads incoming connections between them, so a
+ * connection is accepted, registered and served by the same worker.
+ * Otherwise all workers share the listening sockets of the server.
+ */
+void Worker::_initListenSockets() {
+  _owns_listen_sockets = config().get<bool>("reuseport_listeners");
+
+  if (!_owns_listen_sockets) {
+    _listen_socket     = _server->getServerSocket();
+    _listen_socket_ssl = _server->getSSLServerSocket();
+    return;
+  }
+
+  _listen_socket     = -1;
+  _listen_socket_ssl = -1;
+
+  if (!config().get<bool>("disable_unsecure_listener")) {
+    _listen_socket = Server::openListenSocket(config().get<int>("listen_port"), true);
+  }
+
+  if (_server->isSSL()) {
+    _listen_socket_ssl = Server::openListenSocket(config().get<int>("ssl_listen_port"), true);
+  }
+}
+
+void Worker::_closeListenSockets() {
+  if (!_owns_listen_sockets) {
+    return;
+  }
+
+  if (_listen_socket != -1) {
+    close(_listen_socket);
+    _listen_socket = -1;
+  }
+
+  if (_listen_socket_ssl != -1) {
+    close(_listen_socket_ssl);
+    _listen_socket_ssl = -1;
+  }
 }
 
 void Worker::_initEventFd() {
@@ -109,6 +261,14 @@ void Worker::_signalWork() {
     return;
   }
 
+  // A spinning worker polls its job queue, spare both sides the system call.
+  // The fence pairs with the one in _spinForWork(), so either we see the
+  // worker spinning or it sees the job we just queued.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_spinning.load(std::memory_order_relaxed)) {
+    return;
+  }
+
   uint64_t inc = 1;
   ssize_t ret = ::write(_event_fd, &inc, sizeof(inc));
   if (ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
@@ -197,7 +357,7 @@ void Worker::_acceptConnection(bool ssl) {
   // The listening socket is non-blocking. Drain the accept backlog in a loop:
   // - We stop when accept() returns EAGAIN/EWOULDBLOCK (nothing left to accept).
   // - This avoids extra epoll wakeups and reduces latency under connection bursts.
-  const int listenFd = ssl ? _server->getSSLServerSocket() : _server->getServerSocket();
+  const int listenFd = ssl ? _listen_socket_ssl : _listen_socket;
 
   for (;;) {
     struct sockaddr_in csin;
@@ -234,52 +394,54 @@ void Worker::_acceptConnection(bool ssl) {
       break;
     }
 
-    _server->getWorker()->_addConnection(clientFd, &csin, ssl);
+    _placeConnection(clientFd, csin, ssl);
   }
 }
 
+/**
+ * Register an accepted connection with this or the least loaded worker.
+ * Connections accepted on our own SO_REUSEPORT socket stay on this worker.
+ */
+void Worker::_placeConnection(int fd, struct sockaddr_in csin, bool ssl) {
+  auto target = _owns_listen_sockets ? this : _server->getWorker();
+
+  if (target == this) {
+    _addConnection(fd, &csin, ssl);
+    return;
+  }
+
+  // Another worker's connections may only be touched from its own thread.
+  target->_ev->addJob([target, fd, csin, ssl]() mutable {
+    target->_addConnection(fd, &csin, ssl);
+  });
+  target->_signalWork();
+}
+
 /**
  * Add a new connection to this worker.
  * @param fd Filedescriptor of connection.
  * @param csin sockaddr_in for the connection.
  */
 ConnectionPtr Worker::_addConnection(int fd, struct sockaddr_in* csin, bool ssl) {
-  std::lock_guard<std::mutex> lock(_connection_list_mutex);
+  ASSERT_OWNER_THREAD(_thread_owner);
   ConnectionListIterator connectionIterator;
 
   if (ssl) {
-    connectionIterator = _connection_list.insert(_connection_list.end(), std::make_shared<SSLConnection>(fd, csin, this, config(), _server->getSSLContext()));
+    auto conn          = std::allocate_shared<SSLConnection>(PoolAllocator<SSLConnection>(_pools.ssl_connection), fd, csin, this, config(), _server->getSSLContext());
+    connectionIterator = _connection_list.insert(_connection_list.end(), conn);
   } else {
-    connectionIterator = _connection_list.insert(_connection_list.end(), std::make_shared<Connection>(fd, csin, this, config()));
+    auto conn          = std::allocate_shared<Connection>(PoolAllocator<Connection>(_pools.connection), fd, csin, this, config());
+    connectionIterator = _connection_list.insert(_connection_list.end(), conn);
   }
 
   auto client = connectionIterator->get()->getSharedPtr();
   std::weak_ptr<Connection> wptrClient(client);
 
-  // Set up HTTP request callback.
-  client->onHTTPRequest([this, wptrClient](http::Parser* req, http::RequestState reqState) {
-    auto c = wptrClient.lock();
-    if (!c)
-      return;
-    http::Handler::HandleRequest(HandlerContext(_config, _server, this, c), req, reqState);
-  });
-
-  // Set up websocket request callback.
-  client->onWebsocketRequest([this, wptrClient](websocket::ParserStatus status,
-                                                    websocket::FrameType frameType,
-                                                    const std::string& data) {
-    auto c = wptrClient.lock();
-    if (!c)
-      return;
-    websocket::Handler::HandleRequest(HandlerContext(_config, _server, this, c),
-                                      status, frameType, data);
-  });
-
   client->assignConnectionListIterator(connectionIterator);
-  int ret = client->addToEpoll((EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+  int ret = _ring ? _watchConnection(client, ssl) : client->addToEpoll((EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR));
 
   if (ret == -1) {
-    LOG->warn("Could not add client to epoll: {}.", strerror(errno));
+    LOG->warn("Could not add client to {}: {}.", _ring ? "io_uring" : "epoll", strerror(errno));
     _connection_list.erase(connectionIterator);
     return nullptr;
   }
@@ -287,34 +449,14 @@ ConnectionPtr Worker::_addConnection(int fd, struct sockaddr_in* csin, bool ssl)
   LOG->trace("Client {} accepted in worker {}", client->getIP(), getWorkerId());
 
   // Disconnect client if successful websocket handshake hasn't occurred in 10 seconds.
-  addTimer(config().get<int>("handshake_timeout") * 1000, [wptrClient, this](TimerCtx* ctx) {
+  client->setHandshakeTimer(addTimer(config().get<int>("handshake_timeout") * 1000, [wptrClient, this](TimerCtx* ctx) {
     auto c = wptrClient.lock();
 
     if (c && c->getState() != ConnectionState::WEBSOCKET && c->getState() != ConnectionState::SSE) {
       LOG->debug("Client {} failed to handshake in {} seconds. Removing.", c->getIP(), config().get<int>("handshake_timeout"));
       c->shutdown();
     }
-  });
-
-  // Send a websocket PING frame to the client every Config.getPingInterval() second.
-  addTimer(
-      config().get<int>("ping_interval") * 1000, [wptrClient](TimerCtx* ctx) {
-        auto c = wptrClient.lock();
-
-        if (!c || c->isShutdown()) {
-          ctx->repeat = false;
-          return;
-        }
-
-        if (c->getState() == ConnectionState::WEBSOCKET) {
-          websocket::Response::sendData(c, "", websocket::FrameType::PING_FRAME);
-        } else if (c->getState() == ConnectionState::SSE) {
-          sse::Response::sendPing(c);
-        }
-
-        // TODO: Disconnect client if lastPong was Config.getPingInterval() * 1000 * 3 ago.
-      },
-      true);
+  }));
 
   _metrics.current_connections_count++;
   _metrics.total_connect_count++;
@@ -327,32 +469,530 @@ ConnectionPtr Worker::_addConnection(int fd, struct sockaddr_in* csin, bool ssl)
  * @param conn Connection to remove.
  */
 void Worker::_removeConnection(ConnectionPtr conn) {
-  std::lock_guard<std::mutex> lock(_connection_list_mutex);
+  ASSERT_OWNER_THREAD(_thread_owner);
 
-  conn->removeFromEpoll();
-  _connection_list.erase(conn->getConnectionListIterator());
+  _unlinkConnection(conn);
+  _metrics.total_disconnect_count++;
+}
 
+/**
+ * Stop serving a connection from this worker without closing it.
+ * @param conn Connection to unlink.
+ */
+void Worker::_unlinkConnection(ConnectionPtr conn) {
+  if (!_ring) {
+    conn->removeFromEpoll();
+  }
+
+  if (_ping_cursor == conn->getConnectionListIterator()) {
+    _ping_cursor++;
+  }
+
+  _connection_list.erase(conn->getConnectionListIterator());
   _metrics.current_connections_count--;
-  _metrics.total_disconnect_count++;
 }
 
-void Worker::publish(const std::string& topicName, const std::string& data) {
-  _ev->addJob([this, topicName, data]() {
-    _topic_manager->publish(topicName, data);
+/**
+ * Load estimate used for connection placement and rebalancing.
+ * Each subscription costs fan-out work, and a lagging event loop is
+ * weighted so that it dominates the score.
+ */
+uint64_t Worker::getLoad() {
+  return _metrics.current_connections_count.load() +
+         _topic_manager->getSubscriptionCount() +
+         _metrics.eventloop_delay_ms.load() * LOAD_EVENTLOOP_DELAY_WEIGHT;
+}
+
+/**
+ * Count what the slow consumer policy did to a message.
+ * @param topic Topic the message was published to.
+ */
+void Worker::countSlowConsumer(SlowConsumerAction action, const InternedTopic& topic) {
+  switch (action) {
+    case SlowConsumerAction::DISCONNECTED:
+      _metrics.slow_consumer_disconnect_count++;
+      return;
+
+    case SlowConsumerAction::RESUMED:
+      _metrics.slow_consumer_resume_count++;
+      return;
+
+    case SlowConsumerAction::DROPPED:
+      _metrics.slow_consumer_dropped_count++;
+      break;
+
+    case SlowConsumerAction::CONFLATED:
+      _metrics.slow_consumer_conflated_count++;
+      break;
+  }
+
+  if (topic.empty()) {
+    return;
+  }
+
+  auto it = _slow_consumer_topics.find(topic.id());
+
+  if (it == _slow_consumer_topics.end()) {
+    if (_slow_consumer_topics.size() >= SLOW_CONSUMER_METRIC_MAX_TOPICS) {
+      return;
+    }
+
+    it = _slow_consumer_topics.emplace(topic.id(), SlowConsumerTopicCount{topic, {}}).first;
+  }
+
+  if (action == SlowConsumerAction::DROPPED) {
+    it->second.counts.dropped++;
+  } else {
+    it->second.counts.conflated++;
+  }
+
+  _slow_consumer_topics_changed = true;
+}
+
+/**
+ * Messages dropped and conflated per topic, as of the last
+ * publishSlowConsumerTopicMetrics(). May be called from any thread.
+ */
+std::unordered_map<std::string, metrics::SlowConsumerTopicMetrics> Worker::getSlowConsumerTopicMetrics() {
+  std::lock_guard<std::mutex> lock(_slow_consumer_lock);
+  return _slow_consumer_snapshot;
+}
+
+/**
+ * Copy the per topic slow consumer counters to where other threads can read
+ * them. Run by a timer on the worker, so counting needs no lock.
+ */
+void Worker::publishSlowConsumerTopicMetrics() {
+  ASSERT_OWNER_THREAD(_thread_owner);
+
+  if (!_slow_consumer_topics_changed) {
+    return;
+  }
+
+  std::unordered_map<std::string, metrics::SlowConsumerTopicMetrics> snapshot;
+  snapshot.reserve(_slow_consumer_topics.size());
+
+  for (const auto& entry : _slow_consumer_topics) {
+    snapshot.emplace(entry.second.topic.name(), entry.second.counts);
+  }
+
+  std::lock_guard<std::mutex> lock(_slow_consumer_lock);
+  _slow_consumer_snapshot.swap(snapshot);
+  _slow_consumer_topics_changed = false;
+}
+
+/**
+ * Bytes a worker holds over the output budgets. Every worker sheds its share
+ * of the excess over the process budget, in proportion to what it holds.
+ * @param workerBytes Output waiting to be sent on the worker.
+ * @param processBytes Output waiting to be sent on all workers.
+ * @param workerBudget output_budget_worker_bytes, 0 if there is none.
+ * @param processBudget output_budget_bytes, 0 if there is none.
+ */
+std::size_t Worker::getOutputBudgetExcess(std::size_t workerBytes, std::size_t processBytes, std::size_t workerBudget, std::size_t processBudget) {
+  std::size_t excess = 0;
+
+  if (workerBudget > 0 && workerBytes > workerBudget) {
+    excess = workerBytes - workerBudget;
+  }
+
+  if (processBudget > 0 && processBytes > processBudget && workerBytes > 0) {
+    const double share = static_cast<double>(workerBytes) / processBytes;
+    excess             = std::max(excess, static_cast<std::size_t>(std::ceil((processBytes - processBudget) * share)));
+  }
+
+  return excess;
+}
+
+/**
+ * Disconnect the connections with the most output waiting to be sent, the
+ * oldest backlogs first, until the worker is back within its own budget and
+ * its share of the excess over the process budget. Fan-out to lagging
+ * connections is throttled until the next check finds the worker within budget.
+ * Run by a timer on the worker.
+ */
+void Worker::_enforceOutputBudget() {
+  ASSERT_OWNER_THREAD(_thread_owner);
+
+  const std::size_t workerBytes  = _metrics.output_bytes.load(std::memory_order_relaxed);
+  const std::size_t processBytes = _output_budget_bytes > 0 ? _server->getOutputBytes() : 0;
+  const std::size_t excess       = getOutputBudgetExcess(workerBytes, processBytes, _output_budget_worker_bytes, _output_budget_bytes);
+
+  _over_output_budget = excess > 0;
+  if (!_over_output_budget) {
+    return;
+  }
+
+  std::vector<ConnectionPtr> backlogged;
+  for (auto& conn : _connection_list) {
+    if (conn->getOutputBytes() > 0) {
+      backlogged.push_back(conn);
+    }
+  }
+
+  std::sort(backlogged.begin(), backlogged.end(), [](const ConnectionPtr& a, const ConnectionPtr& b) {
+    if (a->getOutputBytes() != b->getOutputBytes()) {
+      return a->getOutputBytes() > b->getOutputBytes();
+    }
+
+    return a->getOutputSince() < b->getOutputSince();
+  });
+
+  std::size_t shed = 0;
+  for (auto& conn : backlogged) {
+    if (shed >= excess) {
+      break;
+    }
+
+    shed += conn->shedOutput();
+    _metrics.output_budget_shed_count++;
+  }
+
+  LOG->warn("Worker {} is {} bytes over the output budget, disconnected clients holding {} bytes.", getWorkerId(), excess, shed);
+}
+
+/**
+ * Move up to count established connections from this worker to target.
+ * May be called from any thread.
+ * @param target Worker to move connections to.
+ * @param count Maximum number of connections to move.
+ */
+void Worker::migrateConnections(Worker* target, std::size_t count) {
+  _ev->addJob([this, target, count]() {
+    _migrateConnections(target, count);
   });
   _signalWork();
 }
 
 /**
- * Process epoll events and timers.
+ * Detach connections and hand them to target.
+ *
+ * A connection must receive every published message exactly once. Messages
+ * may still be queued for fan-out here, so each subscription is handed over
+ * with the sequence number of the last message it received. The target uses
+ * that to replay or skip messages.
  */
-void Worker::_workerMain() {
-  struct epoll_event eventConnectionList[MAXEVENTS];
-  struct epoll_event serverSocketEvent;
-  struct epoll_event serverSocketEventSSL;
+void Worker::_migrateConnections(Worker* target, std::size_t count) {
+  ASSERT_OWNER_THREAD(_thread_owner);
+
+  if (target == this) {
+    return;
+  }
+
+  const auto pending   = _topic_manager->getPendingFanoutSeqs();
+  std::size_t migrated = 0;
+
+  for (auto it = _connection_list.begin(); it != _connection_list.end() && migrated < count;) {
+    auto conn = *it;
+    it++;
+
+    if (!conn->isMigratable()) {
+      continue;
+    }
+
+    std::vector<MigratedSubscription> subscriptions;
+
+    // Messages up to the skip sequence number were replayed to the connection when it came here.
+    for (const auto& entry : conn->getSubscriptions()) {
+      const auto& subscription = entry.second;
+      const auto deliveredSeq  = std::max(_topic_manager->getDeliveredSeq(subscription, pending, _last_publish_seq), conn->getSkipPublishSeq());
+      subscriptions.push_back({subscription.topic->getName().name(), subscription.rpcSubscriptionRequestId, deliveredSeq});
+    }
+
+    conn->unsubscribeAll();
+    _unlinkConnection(conn);
+
+    LOG->trace("Migrating client {} from worker {} to worker {}.", conn->getIP(), getWorkerId(), target->getWorkerId());
+    target->_adoptConnection(conn, std::move(subscriptions));
+
+    _metrics.total_migrated_count++;
+    migrated++;
+  }
+
+  if (migrated > 0) {
+    LOG->debug("Migrated {} connections from worker {} to worker {}.", migrated, getWorkerId(), target->getWorkerId());
+  }
+}
+
+/**
+ * Take over a connection detached by another worker.
+ * @param conn Connection.
+ * @param subscriptions Subscriptions to restore.
+ */
+void Worker::_adoptConnection(ConnectionPtr conn, std::vector<MigratedSubscription> subscriptions) {
+  _ev->addJob([this, conn, subscriptions = std::move(subscriptions)]() mutable {
+    ASSERT_OWNER_THREAD(_thread_owner);
+
+    // The old worker has messages we haven't been handed yet. They are
+    // already on their way to us, retry once they are in.
+    for (const auto& subscription : subscriptions) {
+      if (subscription.deliveredSeq > _last_publish_seq) {
+        _adoptConnection(conn, std::move(subscriptions));
+        return;
+      }
+    }
+
+    conn->setWorker(this);
+    auto connectionIterator = _connection_list.insert(_connection_list.end(), conn);
+    conn->assignConnectionListIterator(connectionIterator);
+
+    // The workers may run different backends, register the way this one polls.
+    const int ret = _ring ? _watchConnection(conn, conn->isSSL()) : conn->addToEpoll((EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+
+    if (ret == -1) {
+      LOG->warn("Could not add migrated client to {}: {}.", _ring ? "io_uring" : "epoll", strerror(errno));
+      _connection_list.erase(connectionIterator);
+      _metrics.total_disconnect_count++;
+      return;
+    }
+
+    _metrics.current_connections_count++;
+
+    for (const auto& subscription : subscriptions) {
+      conn->subscribe(subscription.topic, subscription.rpcId);
+    }
+
+    // Replay what the connection has missed, including what we have queued
+    // but not delivered yet, and let the fan-out skip it. Waiting for the
+    // fan-out queue to drain instead could leave the connection unpolled for
+    // as long as publishes keep coming.
+    conn->setSkipPublishSeq(_last_publish_seq);
+    _replayMessages(conn, subscriptions);
+  });
+  _signalWork();
+}
+
+/**
+ * Send the messages each subscription has missed that this worker still
+ * remembers to a single connection.
+ */
+void Worker::_replayMessages(ConnectionPtr conn, const std::vector<MigratedSubscription>& subscriptions) {
+  uint64_t seq = _last_publish_seq;
+
+  for (const auto& subscription : subscriptions) {
+    seq = std::min(seq, subscription.deliveredSeq);
+  }
+
+  if (seq == _last_publish_seq) {
+    return;
+  }
+
+  if (_recent_batches.empty() || _recent_batches.front()->front().seq > seq + 1) {
+    LOG->warn("Client {} migrated to worker {} may have missed messages.", conn->getIP(), getWorkerId());
+  }
+
+  for (const auto& batch : _recent_batches) {
+    for (const auto& msg : *batch) {
+      if (msg.seq <= seq) {
+        continue;
+      }
+
+      // Parse once, no matter how many subscriptions match.
+      nlohmann::json message;
+      bool parsed = false;
+
+      for (const auto& subscription : subscriptions) {
+        if (msg.seq <= subscription.deliveredSeq || !TopicManager::isFilterMatched(subscription.topic, msg.topic.name())) {
+          continue;
+        }
+
+        try {
+          if (!parsed) {
+            message = nlohmann::json::parse(msg.data);
+            parsed  = true;
+          }
+
+          Topic::deliver(conn, subscription.rpcId, message, msg.topic);
+        } catch (std::exception& e) {
+          LOG->debug("Invalid publish to {}: {}.", msg.topic.name(), e.what());
+          break;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Handle a HTTP request parsed by one of our connections.
+ */
+void Worker::handleHTTPRequest(ConnectionPtr conn, http::Parser* req, http::RequestState reqState) {
+  http::Handler::HandleRequest(HandlerContext(_config, _server, this, conn), req, reqState);
+}
+
+/**
+ * Handle a websocket frame parsed by one of our connections.
+ */
+void Worker::handleWebsocketRequest(ConnectionPtr conn, websocket::ParserStatus status, websocket::FrameType frameType, const std::string& data) {
+  websocket::Handler::HandleRequest(HandlerContext(_config, _server, this, conn), status, frameType, data);
+}
+
+/**
+ * Visit the next slice of the connection list, sending websocket/SSE pings and
+ * hanging up websocket clients that have stopped answering them.
+ * The slice size is chosen so that a full pass over the list takes one
+ * ping_interval, which spreads the pings evenly instead of clustering them
+ * around the time the clients connected.
+ */
+void Worker::_pingSweep() {
+  ASSERT_OWNER_THREAD(_thread_owner);
+
+  const uint64_t pingIntervalMs = config().get<int>("ping_interval") * 1000;
+  if (pingIntervalMs == 0 || _connection_list.empty()) {
+    _ping_sweep_credit = 0;
+    return;
+  }
+
+  // Carry the remainder over so small lists are still pinged once per interval.
+  _ping_sweep_credit += _connection_list.size() * PING_SWEEP_INTERVAL_MS;
+  std::size_t sliceSize = _ping_sweep_credit / pingIntervalMs;
+  _ping_sweep_credit %= pingIntervalMs;
+
+  sliceSize = std::min(sliceSize, _connection_list.size());
+
+  const auto now         = std::chrono::steady_clock::now();
+  const auto pongTimeout = std::chrono::milliseconds(pingIntervalMs * PING_MAX_MISSED_PONGS);
+
+  for (std::size_t i = 0; i < sliceSize; i++) {
+    if (_ping_cursor == _connection_list.end()) {
+      _ping_cursor = _connection_list.begin();
+    }
+
+    auto c = *_ping_cursor;
+    _ping_cursor++;
 
+    if (c->isShutdown()) {
+      continue;
+    }
+
+    if (c->getState() == ConnectionState::WEBSOCKET) {
+      if (now - c->getLastPong() > pongTimeout) {
+        LOG->debug("Client {} has not answered ping in {} seconds. Removing.", c->getIP(), pingIntervalMs * PING_MAX_MISSED_PONGS / 1000);
+        c->shutdown();
+        continue;
+      }
+
+      websocket::Response::sendPing(c);
+    } else if (c->getState() == ConnectionState::SSE) {
+      sse::Response::sendPing(c);
+    }
+  }
+}
+
+void Worker::publish(const InternedTopic& topic, const std::string& data) {
+  _ev->addJob([this, topic, data]() {
+    _topic_manager->publish(topic, data);
+  });
+  _signalWork();
+}
+
+/**
+ * Deliver a batch of messages with a single job and a single wakeup.
+ * @param batch Messages to publish, shared between all workers.
+ */
+void Worker::publishBatch(PublishBatchPtr batch) {
+  _ev->addJob([this, batch]() {
+    for (const auto& msg : *batch) {
+      _topic_manager->publish(msg.topic, msg.data, msg.seq);
+    }
+
+    if (!batch->empty()) {
+      _last_publish_seq = batch->back().seq;
+
+      // Remember recent batches so connections migrated to us can catch up.
+      _recent_batches.push_back(batch);
+      if (_recent_batches.size() > MIGRATION_REPLAY_BATCHES) {
+        _recent_batches.pop_front();
+      }
+    }
+  });
+  _signalWork();
+}
+
+/**
+ * Let the kernel busy poll the network device when we wait on the epoll
+ * instance, instead of waiting for the interrupt.
+ */
+void Worker::_initEpollBusyPoll() {
+  const int socketBusyPoll = config().get<int>("socket_busy_poll_us");
+  if (socketBusyPoll <= 0) {
+    return;
+  }
+
+  struct epoll_params params;
+  memset(&params, 0, sizeof(params));
+  params.busy_poll_usecs  = socketBusyPoll;
+  params.busy_poll_budget = EPOLL_BUSY_POLL_BUDGET;
+
+  if (ioctl(_epoll_fd, EPIOCSPARAMS, &params) == -1) {
+    LOG->debug("Worker {} could not enable epoll busy polling: {}.", getWorkerId(), strerror(errno));
+  }
+}
+
+/**
+ * Spin for up to busy_poll_us calling poll() until it reports socket
+ * events or a job is queued for us. Jobs queued while we spin don't signal
+ * the eventfd, we pick them up from the queue directly.
+ * @param poll Non-blocking check for socket events, true if there are any.
+ * @return true if there is work to do, false if the window passed without any.
+ */
+bool Worker::_spinForWork(const std::function<bool()>& poll) {
+  const auto deadline = std::chrono::steady_clock::now() + _busy_poll_window;
+  bool hasWork        = false;
+
+  _spinning.store(true, std::memory_order_relaxed);
+
+  do {
+    if (_ev->hasPendingJobs() || poll()) {
+      hasWork = true;
+      break;
+    }
+  } while (!stopRequested() && std::chrono::steady_clock::now() < deadline);
+
+  _spinning.store(false, std::memory_order_relaxed);
+
+  // Producers that saw us spinning didn't signal, so look at the queue once
+  // more before blocking. Pairs with the fence in _signalWork().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  return hasWork || _ev->hasPendingJobs();
+}
+
+/**
+ * Buffer connections read through instead of holding their own. Allocated
+ * on first use, so a running worker has it on the NUMA node it is pinned to.
+ */
+std::vector<char>& Worker::getReadBuffer() {
+  if (_read_buffer.empty()) {
+    _read_buffer.resize(NET_READ_BUFFER_SIZE);
+  }
+
+  return _read_buffer;
+}
+
+/**
+ * Process socket events and timers.
+ */
+void Worker::_workerMain() {
   LOG->debug("Worker {} started.", getWorkerId());
 
+  // From here on our connections and topics belong to this thread.
+  _thread_owner.bind();
+  _topic_manager->getThreadOwner().bind();
+  _pools.bind();
+
+  // Pin before the read buffer, slabs and arena chunks are allocated, which
+  // happens on first use by this thread, so they are placed on the NUMA node
+  // of its CPU. The event loop and io_uring are set up by the constructor on
+  // the thread that created the worker.
+  if (_cpu >= 0) {
+    if (CpuTopology::pinCurrentThread(_cpu)) {
+      _metrics.pinned = true;
+      LOG->debug("Worker {} pinned to CPU {} (NUMA node {}).", getWorkerId(), _cpu, CpuTopology::getNumaNode(_cpu));
+    } else {
+      LOG->warn("Could not pin worker {} to CPU {}.", getWorkerId(), _cpu);
+    }
+  }
+
   // Set initial eventloop delay sample start time.
   _ev_delay_sample_start = Util::getTimeSinceEpoch();
 
@@ -367,6 +1007,50 @@ void Worker::_workerMain() {
       },
       true);
 
+  // Make the per topic slow consumer counters visible to /metrics.
+  addTimer(
+      SLOW_CONSUMER_METRIC_PUBLISH_INTERVAL_MS, [&](TimerCtx* ctx) {
+        publishSlowConsumerTopicMetrics();
+      },
+      true);
+
+  // Ping a slice of the connections every <PING_SWEEP_INTERVAL_MS> so that every
+  // connection is visited once per ping_interval.
+  addTimer(
+      PING_SWEEP_INTERVAL_MS, [&](TimerCtx* ctx) {
+        _pingSweep();
+      },
+      true);
+
+  // Keep the output waiting to be sent within budget.
+  if (_output_budget_bytes > 0 || _output_budget_worker_bytes > 0) {
+    addTimer(
+        OUTPUT_BUDGET_CHECK_INTERVAL_MS, [&](TimerCtx* ctx) {
+          _enforceOutputBudget();
+        },
+        true);
+  }
+
+  if (_ring) {
+    _runIoUring();
+  } else {
+    _runEpoll();
+  }
+
+  // Hand the state back to whoever tears the worker down.
+  _pools.release();
+  _topic_manager->getThreadOwner().release();
+  _thread_owner.release();
+}
+
+/**
+ * Event loop driven by epoll_wait(), with one read() or write() per socket event.
+ */
+void Worker::_runEpoll() {
+  struct epoll_event eventConnectionList[MAXEVENTS];
+  struct epoll_event serverSocketEvent;
+  struct epoll_event serverSocketEventSSL;
+
   if (_epoll_fd == -1) {
     LOG->critical("epoll_create1() failed in worker {}: {}.", getWorkerId(), strerror(errno));
     exit(1);
@@ -393,30 +1077,48 @@ void Worker::_workerMain() {
     }
   }
 
-  // Add server listening socket to epoll.
-  serverSocketEvent.events  = EPOLLIN | EPOLLEXCLUSIVE;
-  serverSocketEvent.data.fd = _server->getServerSocket();
+  // Add server listening sockets to epoll. Shared sockets use EPOLLEXCLUSIVE
+  // so that only one worker is woken up per incoming connection.
+  const uint32_t listenEvents = _owns_listen_sockets ? EPOLLIN : (EPOLLIN | EPOLLEXCLUSIVE);
 
-  if (!config().get<bool>("disable_unsecure_listener")) {
-    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _server->getServerSocket(), &serverSocketEvent) == -1) {
+  if (_listen_socket != -1) {
+    serverSocketEvent.events  = listenEvents;
+    serverSocketEvent.data.fd = _listen_socket;
+
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _listen_socket, &serverSocketEvent) == -1) {
       LOG->critical("Failed to add serversocket to epoll in AcceptWorker {}: {}", getWorkerId(), strerror(errno));
       exit(1);
     }
   }
 
-  // Add server listening socket to epoll.
-  if (_server->isSSL()) {
-    serverSocketEventSSL.events  = EPOLLIN | EPOLLEXCLUSIVE;
-    serverSocketEventSSL.data.fd = _server->getSSLServerSocket();
+  if (_listen_socket_ssl != -1) {
+    serverSocketEventSSL.events  = listenEvents;
+    serverSocketEventSSL.data.fd = _listen_socket_ssl;
 
-    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _server->getSSLServerSocket(), &serverSocketEventSSL) == -1) {
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _listen_socket_ssl, &serverSocketEventSSL) == -1) {
       LOG->critical("Failed to add SSL serversocket to epoll in AcceptWorker {}: {}", getWorkerId(), strerror(errno));
       exit(1);
     }
   }
 
+  const auto fanoutBudgetSubscribers = static_cast<std::size_t>(std::max(0, config().get<int>("fanout_budget_subscribers")));
+  const auto fanoutBudgetTime        = std::chrono::microseconds(std::max(0, config().get<int>("fanout_budget_us")));
+
+  _initEpollBusyPoll();
+
   while (!stopRequested()) {
-    int n = epoll_wait(_epoll_fd, eventConnectionList, MAXEVENTS, -1);
+    int n = 0;
+
+    // Don't block if a fan-out is waiting to be resumed, and in busy poll
+    // mode only block once spinning found nothing to do.
+    if (_topic_manager->hasPendingFanout()) {
+      n = epoll_wait(_epoll_fd, eventConnectionList, MAXEVENTS, 0);
+    } else if (_busy_poll_window.count() == 0 || !_spinForWork([&]() {
+                 n = epoll_wait(_epoll_fd, eventConnectionList, MAXEVENTS, 0);
+                 return n > 0;
+               })) {
+      n = epoll_wait(_epoll_fd, eventConnectionList, MAXEVENTS, -1);
+    }
 
     for (int i = 0; i < n; i++) {
       if (_event_fd != -1 && eventConnectionList[i].data.fd == _event_fd) {
@@ -428,9 +1130,10 @@ void Worker::_workerMain() {
         continue;
       }
       // Handle new connections.
-      if (eventConnectionList[i].data.fd == _server->getServerSocket() || eventConnectionList[i].data.fd == _server->getSSLServerSocket()) {
+      if ((_listen_socket != -1 && eventConnectionList[i].data.fd == _listen_socket) ||
+          (_listen_socket_ssl != -1 && eventConnectionList[i].data.fd == _listen_socket_ssl)) {
         if (eventConnectionList[i].events & EPOLLIN) {
-          bool isSSL = eventConnectionList[i].data.fd == _server->getSSLServerSocket();
+          bool isSSL = eventConnectionList[i].data.fd == _listen_socket_ssl;
           _acceptConnection(isSSL);
         }
 
@@ -454,11 +1157,11 @@ void Worker::_workerMain() {
       // Flush send buffer if socket is ready for write.
       if (eventConnectionList[i].events & EPOLLOUT) {
         client->flushSendBuffer();
-        continue;
       }
 
-      // Read data from client if data is available.
-      if (eventConnectionList[i].events & EPOLLIN) {
+      // Read data from client if data is available. Edge-triggered sockets
+      // report both directions in one event, so don't skip the read.
+      if ((eventConnectionList[i].events & EPOLLIN) && !client->isShutdown()) {
         client->read();
       }
     }
@@ -466,6 +1169,411 @@ void Worker::_workerMain() {
     // Process timers and jobs.
     _ev->process();
     _armTimerFd();
+
+    // Deliver published messages, yielding back to the loop once the budget is spent.
+    FanoutBudget fanoutBudget(fanoutBudgetSubscribers, fanoutBudgetTime);
+    _topic_manager->processFanout(fanoutBudget);
+  }
+}
+
+/**
+ * A request in flight on the io_uring of this worker. The address of the
+ * request is its user_data, and it keeps the connection it belongs to alive
+ * until the kernel is done with it.
+ */
+struct Worker::UringOp {
+  UringOpType type;
+  int fd;
+  ConnectionPtr conn;
+  std::shared_ptr<const std::string> buffer;
+  std::size_t offset;
+  UringOp* prev;
+  UringOp* next;
+};
+
+/**
+ * Set up the io_uring of this worker. Leaves _ring empty, and the worker
+ * on epoll, if the kernel can't provide what we need.
+ */
+void Worker::_initIoUring() {
+  auto ring = std::make_unique<IoUring>();
+
+  if (!ring->init(URING_ENTRIES, URING_ENTRIES * URING_CQ_FACTOR) ||
+      !ring->setupBufferRing(0, URING_RECV_BUFFER_COUNT, URING_RECV_BUFFER_SIZE)) {
+    LOG->debug("Worker {} can not use io_uring: {}.", getWorkerId(), ring->getError());
+    return;
+  }
+
+  _ring = std::move(ring);
+}
+
+Worker::UringOp* Worker::_newUringOp(UringOpType type, int fd, ConnectionPtr conn) {
+  auto op = new UringOp{type, fd, std::move(conn), nullptr, 0, nullptr, _uring_ops};
+
+  if (_uring_ops != nullptr) {
+    _uring_ops->prev = op;
+  }
+
+  _uring_ops = op;
+  return op;
+}
+
+void Worker::_freeUringOp(UringOp* op) {
+  if (op->prev != nullptr) {
+    op->prev->next = op->next;
+  } else {
+    _uring_ops = op->next;
+  }
+
+  if (op->next != nullptr) {
+    op->next->prev = op->prev;
+  }
+
+  delete op;
+}
+
+/**
+ * Queue a request on the ring. It is submitted with the next io_uring_enter()
+ * of the event loop, together with everything else queued in the same iteration.
+ */
+bool Worker::_submitUringOp(UringOp* op) {
+  auto sqe = _ring->getSqe();
+
+  if (sqe == nullptr) {
+    errno = EBUSY;
+    return false;
+  }
+
+  sqe->fd        = op->fd;
+  sqe->user_data = reinterpret_cast<uint64_t>(op);
+
+  switch (op->type) {
+    case UringOpType::WAKEUP:
+      sqe->opcode        = IORING_OP_POLL_ADD;
+      sqe->poll32_events = POLLIN;
+      sqe->len           = IORING_POLL_ADD_MULTI;
+      break;
+
+    case UringOpType::ACCEPT:
+    case UringOpType::ACCEPT_SSL:
+      sqe->opcode       = IORING_OP_ACCEPT;
+      sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+      sqe->accept_flags = SOCK_NONBLOCK;
+      break;
+
+    case UringOpType::RECV:
+      sqe->opcode    = IORING_OP_RECV;
+      sqe->ioprio    = IORING_RECV_MULTISHOT;
+      sqe->flags     = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = _ring->getBufferGroup();
+      break;
+
+    case UringOpType::SEND: {
+      const std::size_t length = op->buffer->length() - op->offset;
+
+      // Pinning the pages only pays off for larger sends.
+      sqe->opcode    = length >= URING_SEND_ZC_THRESHOLD ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+      sqe->addr      = reinterpret_cast<uint64_t>(op->buffer->data() + op->offset);
+      sqe->len       = length;
+      sqe->msg_flags = MSG_NOSIGNAL;
+      break;
+    }
+
+    case UringOpType::POLL_IN:
+      sqe->opcode        = IORING_OP_POLL_ADD;
+      sqe->poll32_events = POLLIN | POLLRDHUP;
+      break;
+
+    case UringOpType::POLL_OUT:
+      sqe->opcode        = IORING_OP_POLL_ADD;
+      sqe->poll32_events = POLLOUT;
+      break;
+  }
+
+  return true;
+}
+
+/**
+ * Start serving a new connection from the ring. Plain connections are read
+ * with a multishot receive into provided buffers. TLS connections are
+ * driven by OpenSSL on the socket itself, so for them we only poll for
+ * readiness and call read() like the epoll loop does.
+ */
+int Worker::_watchConnection(ConnectionPtr conn, bool ssl) {
+  auto op = _newUringOp(ssl ? UringOpType::POLL_IN : UringOpType::RECV, conn->getFileDescriptor(), conn);
+
+  if (!_submitUringOp(op)) {
+    _freeUringOp(op);
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * Send buffer from offset on the ring. The buffer is kept alive until the
+ * kernel is done with it.
+ */
+bool Worker::submitSend(ConnectionPtr conn, std::shared_ptr<const std::string> buffer, std::size_t offset) {
+  auto op    = _newUringOp(UringOpType::SEND, conn->getFileDescriptor(), conn);
+  op->buffer = std::move(buffer);
+  op->offset = offset;
+
+  if (!_submitUringOp(op)) {
+    _freeUringOp(op);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Call onWritable() on a TLS connection once its socket becomes writable.
+ */
+void Worker::pollWritable(ConnectionPtr conn) {
+  auto op = _newUringOp(UringOpType::POLL_OUT, conn->getFileDescriptor(), conn);
+
+  if (!_submitUringOp(op)) {
+    _freeUringOp(op);
+    conn->shutdown();
+  }
+}
+
+/**
+ * Register a connection accepted on the ring.
+ */
+void Worker::_acceptedConnection(int fd, bool ssl) {
+  struct sockaddr_in csin;
+  socklen_t clen = sizeof(csin);
+  memset(reinterpret_cast<char*>(&csin), '\0', sizeof(csin));
+
+  // Multishot accept can't return the peer address.
+  getpeername(fd, reinterpret_cast<struct sockaddr*>(&csin), &clen);
+
+  _placeConnection(fd, csin, ssl);
+}
+
+void Worker::_handleUringCompletion(const struct io_uring_cqe* cqe) {
+  auto op         = reinterpret_cast<UringOp*>(cqe->user_data);
+  const bool more = cqe->flags & IORING_CQE_F_MORE;
+  bool rearm      = false;
+
+  // Cancellation requests have no op.
+  if (op == nullptr) {
+    return;
+  }
+
+  switch (op->type) {
+    case UringOpType::WAKEUP:
+      _drainEventFd();
+      rearm = !more;
+      break;
+
+    case UringOpType::ACCEPT:
+    case UringOpType::ACCEPT_SSL:
+      if (cqe->res >= 0) {
+        _acceptedConnection(cqe->res, op->type == UringOpType::ACCEPT_SSL);
+      } else if (cqe->res != -ECANCELED) {
+        LOG->error("Could not accept new connection: {}.", strerror(-cqe->res));
+      }
+
+      rearm = !more;
+      break;
+
+    case UringOpType::RECV:
+      rearm = _handleUringRecv(op, cqe);
+      break;
+
+    case UringOpType::SEND:
+      _handleUringSend(op, cqe);
+      break;
+
+    case UringOpType::POLL_IN:
+      rearm = _handleUringPoll(op, cqe);
+      break;
+
+    case UringOpType::POLL_OUT:
+      op->conn->onWritable();
+      break;
+  }
+
+  if (rearm && !_uring_stopping) {
+    if (_submitUringOp(op)) {
+      return;
+    }
+
+    LOG->error("Worker {} could not resubmit io_uring request: {}.", getWorkerId(), strerror(errno));
+
+    if (op->conn) {
+      op->conn->shutdown();
+      _removeConnection(op->conn);
+    }
+  }
+
+  if (!more) {
+    _freeUringOp(op);
+  }
+}
+
+/**
+ * Feed received data to the connection.
+ * @return true if the receive ended and should be submitted again.
+ */
+bool Worker::_handleUringRecv(UringOp* op, const struct io_uring_cqe* cqe) {
+  auto conn = op->conn;
+
+  if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+    const uint16_t bufferId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    conn->onReceive(_ring->getBuffer(bufferId), cqe->res);
+    _ring->recycleBuffer(bufferId);
+  }
+
+  if (cqe->flags & IORING_CQE_F_MORE) {
+    return false;
+  }
+
+  // Running out of provided buffers only stops the receive. Anything else
+  // means the connection is closed or shut down.
+  if (!conn->isShutdown() && !_uring_stopping && (cqe->res > 0 || cqe->res == -ENOBUFS)) {
+    return true;
+  }
+
+  conn->shutdown();
+  _removeConnection(conn);
+  return false;
+}
+
+/**
+ * Read from a TLS connection that became readable.
+ * @return true if the connection should be polled again.
+ */
+bool Worker::_handleUringPoll(UringOp* op, const struct io_uring_cqe* cqe) {
+  auto conn = op->conn;
+
+  if (cqe->res < 0 || (cqe->res & (POLLERR | POLLHUP | POLLRDHUP))) {
+    conn->shutdown();
+  }
+
+  if (!conn->isShutdown() && (cqe->res & POLLIN)) {
+    conn->read();
+  }
+
+  if (conn->isShutdown()) {
+    _removeConnection(conn);
+    return false;
+  }
+
+  return true;
+}
+
+void Worker::_handleUringSend(UringOp* op, const struct io_uring_cqe* cqe) {
+  // Zero-copy sends report once more when the kernel lets go of the buffer.
+  if (cqe->flags & IORING_CQE_F_NOTIF) {
+    return;
+  }
+
+  if (cqe->res < 0) {
+    op->conn->onSendComplete(false);
+    return;
+  }
+
+  const std::size_t sent = op->offset + cqe->res;
+
+  // Short send, continue with the rest of the buffer.
+  if (sent < op->buffer->length()) {
+    if (!submitSend(op->conn, op->buffer, sent)) {
+      op->conn->onSendComplete(false);
+    }
+
+    return;
+  }
+
+  op->conn->onSendComplete(true);
+}
+
+/**
+ * Event loop driven by io_uring. Accepts, receives and sends of all
+ * connections are batched into a single io_uring_enter() per iteration,
+ * which also waits for the next timer.
+ */
+void Worker::_runIoUring() {
+  _submitUringOp(_newUringOp(UringOpType::WAKEUP, _event_fd, nullptr));
+
+  if (_listen_socket != -1) {
+    _submitUringOp(_newUringOp(UringOpType::ACCEPT, _listen_socket, nullptr));
+  }
+
+  if (_listen_socket_ssl != -1) {
+    _submitUringOp(_newUringOp(UringOpType::ACCEPT_SSL, _listen_socket_ssl, nullptr));
+  }
+
+  const auto fanoutBudgetSubscribers = static_cast<std::size_t>(std::max(0, config().get<int>("fanout_budget_subscribers")));
+  const auto fanoutBudgetTime        = std::chrono::microseconds(std::max(0, config().get<int>("fanout_budget_us")));
+
+  while (!stopRequested()) {
+    auto timeout = std::chrono::milliseconds(-1);
+
+    // Don't block if a fan-out is waiting to be resumed.
+    if (_topic_manager->hasPendingFanout()) {
+      timeout = std::chrono::milliseconds(0);
+    } else if (_ev->getNextTimerFireTime() != std::chrono::milliseconds::zero()) {
+      const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch());
+      timeout = std::max(std::chrono::milliseconds(0), _ev->getNextTimerFireTime() - now);
+    }
+
+    // Busy poll the completion queue, but no longer than until the next timer.
+    if (timeout.count() != 0 && _busy_poll_window.count() > 0) {
+      const auto spinStart = std::chrono::steady_clock::now();
+
+      if (_spinForWork([&]() {
+            _ring->submit();
+            return _ring->hasCqe() || (timeout.count() > 0 && std::chrono::steady_clock::now() - spinStart >= timeout);
+          })) {
+        timeout = std::chrono::milliseconds(0);
+      } else if (timeout.count() > 0) {
+        timeout = std::max(std::chrono::milliseconds(0), timeout - std::chrono::duration_cast<std::chrono::milliseconds>(_busy_poll_window));
+      }
+    }
+
+    if (_ring->submitAndWait(timeout) == -1) {
+      LOG->error("io_uring_enter() failed in worker {}: {}.", getWorkerId(), strerror(errno));
+    }
+
+    _ring->forEachCqe([this](const struct io_uring_cqe* cqe) {
+      _handleUringCompletion(cqe);
+    });
+
+    // Process timers and jobs.
+    _ev->process();
+
+    // Deliver published messages, yielding back to the loop once the budget is spent.
+    FanoutBudget fanoutBudget(fanoutBudgetSubscribers, fanoutBudgetTime);
+    _topic_manager->processFanout(fanoutBudget);
+  }
+
+  _stopIoUring();
+}
+
+/**
+ * Cancel everything in flight and wait for the kernel to let go of our
+ * buffers before the ring is torn down.
+ */
+void Worker::_stopIoUring() {
+  _uring_stopping = true;
+
+  auto sqe = _ring->getSqe();
+  if (sqe != nullptr) {
+    sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data    = 0;
+  }
+
+  for (int i = 0; i < 10 && _uring_ops != nullptr; i++) {
+    _ring->submitAndWait(std::chrono::milliseconds(100));
+    _ring->forEachCqe([this](const struct io_uring_cqe* cqe) {
+      _handleUringCompletion(cqe);
+    });
   }
 }
 } // namespace eventhub
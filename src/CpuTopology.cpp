@@ -0,0 +1,196 @@
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuTopology.hpp"
+
+namespace eventhub {
+namespace {
+std::string readFile(const std::string& path) {
+  std::ifstream f(path);
+  if (!f.is_open()) {
+    return "";
+  }
+
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+/**
+ * Path of our own cgroup v2 group relative to the cgroup root, or "" if not found.
+ */
+std::string getCgroupV2Path() {
+  std::ifstream f("/proc/self/cgroup");
+  std::string line;
+
+  while (std::getline(f, line)) {
+    if (line.compare(0, 3, "0::") == 0) {
+      return line.substr(3);
+    }
+  }
+
+  return "";
+}
+} // namespace
+
+/**
+ * CPUs in the affinity mask of the process.
+ */
+std::vector<int> CpuTopology::getAllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+
+  if (cpus.empty()) {
+    for (unsigned int cpu = 0; cpu < std::max(1U, std::thread::hardware_concurrency()); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus;
+}
+
+/**
+ * Parse the content of a cgroup v2 cpu.max file ("<quota> <period>" or "max <period>").
+ * @returns CPU quota in thousandths of a CPU, 0 if there is no quota.
+ */
+unsigned int CpuTopology::parseCgroupV2CpuMax(const std::string& cpuMax) {
+  std::istringstream ss(cpuMax);
+  std::string quota, period;
+
+  if (!(ss >> quota >> period) || quota == "max") {
+    return 0;
+  }
+
+  return parseCgroupV1CpuQuota(quota, period);
+}
+
+/**
+ * Parse the content of cgroup v1 cpu.cfs_quota_us and cpu.cfs_period_us.
+ * @returns CPU quota in thousandths of a CPU, 0 if there is no quota.
+ */
+unsigned int CpuTopology::parseCgroupV1CpuQuota(const std::string& quota, const std::string& period) {
+  try {
+    const auto q = std::stoll(quota);
+    const auto p = std::stoll(period);
+
+    if (q <= 0 || p <= 0) {
+      return 0;
+    }
+
+    return static_cast<unsigned int>((q * 1000) / p);
+  } catch (...) {
+    return 0;
+  }
+}
+
+/**
+ * CPU quota of our cgroup in thousandths of a CPU, 0 if there is no quota.
+ * Looks at cgroup v2 first and falls back to the v1 cpu controller.
+ */
+unsigned int CpuTopology::getCpuQuotaMillis() {
+  const auto cgroupPath = getCgroupV2Path();
+
+  for (const auto& dir : {"/sys/fs/cgroup" + cgroupPath, std::string("/sys/fs/cgroup")}) {
+    const auto cpuMax = readFile(dir + "/cpu.max");
+    if (!cpuMax.empty()) {
+      return parseCgroupV2CpuMax(cpuMax);
+    }
+  }
+
+  for (const auto& dir : {"/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct"}) {
+    const auto quota = readFile(std::string(dir) + "/cpu.cfs_quota_us");
+    if (!quota.empty()) {
+      return parseCgroupV1CpuQuota(quota, readFile(std::string(dir) + "/cpu.cfs_period_us"));
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Number of workers to use when worker_threads = 0: the number of CPUs we
+ * may run on, capped by the cgroup CPU quota rounded up.
+ */
+unsigned int CpuTopology::getDefaultWorkerCount() {
+  unsigned int count = getAllowedCpus().size();
+  const auto quota   = getCpuQuotaMillis();
+
+  if (quota > 0) {
+    count = std::min(count, (quota + 999) / 1000);
+  }
+
+  return std::max(1U, count);
+}
+
+/**
+ * NUMA node of a CPU, 0 if unknown.
+ */
+int CpuTopology::getNumaNode(int cpu) {
+  const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+  DIR* dir        = opendir(path.c_str());
+  int node        = 0;
+
+  if (dir == nullptr) {
+    return node;
+  }
+
+  while (auto entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4])) {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+
+  closedir(dir);
+  return node;
+}
+
+/**
+ * Number of NUMA nodes spanned by the CPUs we may run on.
+ */
+unsigned int CpuTopology::getNumaNodeCount() {
+  std::vector<int> nodes;
+
+  for (auto cpu : getAllowedCpus()) {
+    const auto node = getNumaNode(cpu);
+    if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+      nodes.push_back(node);
+    }
+  }
+
+  return nodes.size();
+}
+
+/**
+ * Pin the calling thread to a single CPU.
+ * Memory the thread touches afterwards is allocated on the NUMA node of that
+ * CPU by the kernel's first-touch policy.
+ */
+bool CpuTopology::pinCurrentThread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+} // namespace eventhub
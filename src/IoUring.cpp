@@ -0,0 +1,314 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/time_types.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "IoUring.hpp"
+
+namespace eventhub {
+
+IoUring::IoUring()
+    : _ring_fd(-1),
+      _features(0),
+      _ring_ptr(nullptr),
+      _ring_size(0),
+      _sqes(nullptr),
+      _sqes_size(0),
+      _sq_head(nullptr),
+      _sq_tail(nullptr),
+      _sq_mask(nullptr),
+      _sq_entries(nullptr),
+      _sq_array(nullptr),
+      _sqe_tail(0),
+      _sqe_submitted(0),
+      _cq_head(nullptr),
+      _cq_tail(nullptr),
+      _cq_mask(nullptr),
+      _cqes(nullptr),
+      _buf_ring(nullptr),
+      _buf_ring_size(0),
+      _buffers(nullptr),
+      _buffer_count(0),
+      _buffer_size(0),
+      _buffer_group(0) {}
+
+IoUring::~IoUring() {
+  _close();
+}
+
+/**
+ * Set up the ring.
+ * Requires the features of Linux 6.0 or newer: multishot receive and
+ * zero-copy send. On failure getError() tells why.
+ * @param entries Submission queue size.
+ * @param cqEntries Completion queue size.
+ */
+bool IoUring::init(unsigned int entries, unsigned int cqEntries) {
+  struct io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+  params.flags      = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+  params.cq_entries = cqEntries;
+
+  _ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+
+  if (_ring_fd == -1) {
+    _error = std::string("io_uring_setup: ") + strerror(errno);
+    return false;
+  }
+
+  _features = params.features;
+
+  const uint32_t requiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+  if ((_features & requiredFeatures) != requiredFeatures) {
+    _error = "kernel lacks required io_uring features";
+    _close();
+    return false;
+  }
+
+  const std::size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  const std::size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  _ring_size               = std::max(sqSize, cqSize);
+
+  _ring_ptr = mmap(nullptr, _ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+  if (_ring_ptr == MAP_FAILED) {
+    _ring_ptr = nullptr;
+    _error    = std::string("mmap of io_uring failed: ") + strerror(errno);
+    _close();
+    return false;
+  }
+
+  _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    _error = std::string("mmap of io_uring submission entries failed: ") + strerror(errno);
+    _close();
+    return false;
+  }
+
+  _sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+  char* base  = static_cast<char*>(_ring_ptr);
+  _sq_head    = reinterpret_cast<unsigned int*>(base + params.sq_off.head);
+  _sq_tail    = reinterpret_cast<unsigned int*>(base + params.sq_off.tail);
+  _sq_mask    = reinterpret_cast<unsigned int*>(base + params.sq_off.ring_mask);
+  _sq_entries = reinterpret_cast<unsigned int*>(base + params.sq_off.ring_entries);
+  _sq_array   = reinterpret_cast<unsigned int*>(base + params.sq_off.array);
+  _cq_head    = reinterpret_cast<unsigned int*>(base + params.cq_off.head);
+  _cq_tail    = reinterpret_cast<unsigned int*>(base + params.cq_off.tail);
+  _cq_mask    = reinterpret_cast<unsigned int*>(base + params.cq_off.ring_mask);
+  _cqes       = reinterpret_cast<struct io_uring_cqe*>(base + params.cq_off.cqes);
+
+  _sqe_tail      = *_sq_tail;
+  _sqe_submitted = _sqe_tail;
+
+  if (!_probeOps()) {
+    _close();
+    return false;
+  }
+
+  return true;
+}
+
+bool IoUring::_probeOps() {
+  const std::size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+  std::unique_ptr<struct io_uring_probe, decltype(&free)> probe(static_cast<struct io_uring_probe*>(calloc(1, probeSize)), free);
+
+  if (syscall(__NR_io_uring_register, _ring_fd, IORING_REGISTER_PROBE, probe.get(), 256) == -1) {
+    _error = std::string("io_uring opcode probe failed: ") + strerror(errno);
+    return false;
+  }
+
+  for (unsigned int i = 0; i < probe->ops_len; i++) {
+    if (probe->ops[i].flags & IO_URING_OP_SUPPORTED) {
+      _supported_ops.set(probe->ops[i].op);
+    }
+  }
+
+  // SEND_ZC arrived together with multishot receive, so it also tells us
+  // whether the kernel has that.
+  for (auto opcode : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_SEND_ZC, IORING_OP_POLL_ADD}) {
+    if (!isOpSupported(opcode)) {
+      _error = "kernel lacks io_uring opcode " + std::to_string(opcode);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Register a ring of count receive buffers of size bytes each, which the
+ * kernel picks from for requests with IOSQE_BUFFER_SELECT and group groupId.
+ * count must be a power of two.
+ */
+bool IoUring::setupBufferRing(uint16_t groupId, unsigned int count, unsigned int size) {
+  _buf_ring_size = count * sizeof(struct io_uring_buf);
+
+  void* bufRing = mmap(nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (bufRing == MAP_FAILED) {
+    _error = std::string("mmap of buffer ring failed: ") + strerror(errno);
+    return false;
+  }
+
+  _buf_ring = static_cast<struct io_uring_buf_ring*>(bufRing);
+
+  void* buffers = mmap(nullptr, std::size_t(count) * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffers == MAP_FAILED) {
+    _error = std::string("mmap of receive buffers failed: ") + strerror(errno);
+    return false;
+  }
+
+  _buffers      = static_cast<char*>(buffers);
+  _buffer_count = count;
+  _buffer_size  = size;
+  _buffer_group = groupId;
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr    = reinterpret_cast<uint64_t>(_buf_ring);
+  reg.ring_entries = count;
+  reg.bgid         = groupId;
+
+  if (syscall(__NR_io_uring_register, _ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+    _error = std::string("registering buffer ring failed: ") + strerror(errno);
+    return false;
+  }
+
+  for (unsigned int i = 0; i < count; i++) {
+    _addBuffer(i, i);
+  }
+
+  __atomic_store_n(&_buf_ring->tail, static_cast<uint16_t>(count), __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/**
+ * Give a receive buffer back to the kernel once its data is consumed.
+ */
+void IoUring::recycleBuffer(uint16_t bufferId) {
+  _addBuffer(bufferId, 0);
+  __atomic_store_n(&_buf_ring->tail, static_cast<uint16_t>(_buf_ring->tail + 1), __ATOMIC_RELEASE);
+}
+
+void IoUring::_addBuffer(uint16_t bufferId, unsigned int offset) {
+  // The ring is an array of io_uring_buf with the tail overlaid on the first
+  // entry. Don't use io_uring_buf_ring::bufs, the flexible array helper of
+  // the kernel headers places it at the wrong offset when compiled as C++.
+  auto bufs = reinterpret_cast<struct io_uring_buf*>(_buf_ring);
+  auto buf  = &bufs[(_buf_ring->tail + offset) & (_buffer_count - 1)];
+  buf->addr = reinterpret_cast<uint64_t>(getBuffer(bufferId));
+  buf->len  = _buffer_size;
+  buf->bid  = bufferId;
+}
+
+/**
+ * Get a zeroed submission entry, or nullptr if the submission queue is
+ * full even after submitting what is queued.
+ */
+struct io_uring_sqe* IoUring::getSqe() {
+  if (_sqe_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= *_sq_entries) {
+    submit();
+
+    if (_sqe_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= *_sq_entries) {
+      return nullptr;
+    }
+  }
+
+  const unsigned int index = _sqe_tail & *_sq_mask;
+  auto sqe                 = &_sqes[index];
+
+  memset(sqe, 0, sizeof(*sqe));
+  _sq_array[index] = index;
+  _sqe_tail++;
+
+  return sqe;
+}
+
+/**
+ * Submit queued entries without waiting for completions.
+ */
+int IoUring::submit() {
+  const unsigned int toSubmit = _sqe_tail - _sqe_submitted;
+
+  __atomic_store_n(_sq_tail, _sqe_tail, __ATOMIC_RELEASE);
+  _sqe_submitted = _sqe_tail;
+
+  return _enter(toSubmit, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+}
+
+/**
+ * Submit queued entries and wait until at least one completion is ready.
+ * @param timeout Maximum time to wait, negative to wait forever and zero
+ *                to only submit.
+ */
+int IoUring::submitAndWait(std::chrono::milliseconds timeout) {
+  if (timeout.count() == 0) {
+    return submit();
+  }
+
+  const unsigned int toSubmit = _sqe_tail - _sqe_submitted;
+
+  __atomic_store_n(_sq_tail, _sqe_tail, __ATOMIC_RELEASE);
+  _sqe_submitted = _sqe_tail;
+
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+
+  if (timeout.count() > 0) {
+    ts.tv_sec  = timeout.count() / 1000;
+    ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+    arg.ts     = reinterpret_cast<uint64_t>(&ts);
+  }
+
+  return _enter(toSubmit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+int IoUring::_enter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags, void* arg, std::size_t argSize) {
+  int ret = syscall(__NR_io_uring_enter, _ring_fd, toSubmit, minComplete, flags, arg, argSize);
+
+  // Timeouts, signals and a full completion queue just mean we should
+  // reap completions.
+  if (ret == -1 && (errno == ETIME || errno == EINTR || errno == EBUSY || errno == EAGAIN)) {
+    return 0;
+  }
+
+  return ret;
+}
+
+void IoUring::_close() {
+  if (_ring_fd != -1) {
+    close(_ring_fd);
+    _ring_fd = -1;
+  }
+
+  if (_ring_ptr != nullptr) {
+    munmap(_ring_ptr, _ring_size);
+    _ring_ptr = nullptr;
+  }
+
+  if (_sqes != nullptr) {
+    munmap(_sqes, _sqes_size);
+    _sqes = nullptr;
+  }
+
+  if (_buf_ring != nullptr) {
+    munmap(_buf_ring, _buf_ring_size);
+    _buf_ring = nullptr;
+  }
+
+  if (_buffers != nullptr) {
+    munmap(_buffers, std::size_t(_buffer_count) * _buffer_size);
+    _buffers = nullptr;
+  }
+}
+
+} // namespace eventhub
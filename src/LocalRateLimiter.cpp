@@ -0,0 +1,203 @@
+#include <spdlog/logger.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LocalRateLimiter.hpp"
+#include "Logger.hpp"
+
+namespace eventhub {
+
+/**
+ * @param syncInterval How often sync() is called.
+ */
+LocalRateLimiter::LocalRateLimiter(std::chrono::milliseconds syncInterval) :
+  _sync_interval(syncInterval) {}
+
+/**
+ * Count a publish against a rate limit and tell if it is allowed.
+ * Publishes that are refused are not counted.
+ * @param topic Rate limit pattern.
+ */
+RateLimitResult LocalRateLimiter::check(const std::string& topic, const std::string& subject, unsigned long interval, unsigned long max, Clock::time_point now) {
+  if (max == 0 || interval == 0) {
+    return {false, 0};
+  }
+
+  auto& shard = _getShard(subject);
+  std::lock_guard<std::mutex> lock(shard.lock);
+
+  auto& buckets = shard.subjects[subject];
+  auto it       = buckets.find(topic);
+
+  if (it == buckets.end()) {
+    it = buckets.emplace(topic, Bucket{static_cast<double>(max), interval, max, now}).first;
+  }
+
+  auto& bucket = it->second;
+
+  // The limit changed, i.e the user got a new token.
+  if (bucket.interval != interval || bucket.max != max) {
+    bucket.interval = interval;
+    bucket.max      = max;
+    bucket.tokens   = std::min(bucket.tokens, static_cast<double>(max));
+  }
+
+  _refill(bucket, now);
+
+  const bool limited = bucket.tokens < 1;
+  if (!limited) {
+    bucket.tokens -= 1;
+    bucket.pending++;
+  }
+
+  return {limited, std::max(0LL, static_cast<long long>(std::ceil(max - bucket.tokens)))};
+}
+
+/**
+ * Exchange what this node and the other nodes have consumed through Redis.
+ */
+void LocalRateLimiter::sync(Redis& redis) {
+  const auto usage = collectUsage();
+  if (usage.empty()) {
+    return;
+  }
+
+  std::vector<long long> totals;
+  try {
+    totals = redis.syncRateLimitUsage(usage);
+  } catch (std::exception& e) {
+    LOG->error("Failed to sync rate limits with Redis: {}", e.what());
+    restoreUsage(usage);
+    return;
+  }
+
+  applyTotals(usage, totals);
+}
+
+/**
+ * Take the publishes counted since the last sync out of the buckets.
+ * Buckets that are full and haven't been used for an interval are dropped.
+ */
+std::vector<RateLimitUsage> LocalRateLimiter::collectUsage(Clock::time_point now) {
+  const auto syncSeconds = std::chrono::duration_cast<std::chrono::seconds>(_sync_interval).count() + 1;
+  std::vector<RateLimitUsage> usage;
+
+  for (auto& shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    for (auto subjectIt = shard.subjects.begin(); subjectIt != shard.subjects.end();) {
+      auto& buckets = subjectIt->second;
+
+      for (auto it = buckets.begin(); it != buckets.end();) {
+        auto& bucket      = it->second;
+        const auto idle   = std::chrono::duration<double>(now - bucket.refilledAt).count();
+        const bool unused = idle >= bucket.interval && bucket.tokens + idle * bucket.max / bucket.interval >= bucket.max;
+
+        if (bucket.pending == 0 && unused) {
+          it = buckets.erase(it);
+          continue;
+        }
+
+        const auto ttl = std::max<unsigned long>(bucket.interval, syncSeconds) * 2;
+        usage.push_back({it->first, subjectIt->first, bucket.pending, ttl});
+        bucket.pending = 0;
+        ++it;
+      }
+
+      if (buckets.empty()) {
+        subjectIt = shard.subjects.erase(subjectIt);
+      } else {
+        ++subjectIt;
+      }
+    }
+  }
+
+  return usage;
+}
+
+/**
+ * Take what other nodes consumed since the last sync out of the buckets.
+ * @param usage What collectUsage() returned.
+ * @param totals Total consumed by all nodes, for each entry in usage.
+ */
+void LocalRateLimiter::applyTotals(const std::vector<RateLimitUsage>& usage, const std::vector<long long>& totals) {
+  for (std::size_t i = 0; i < usage.size() && i < totals.size(); i++) {
+    auto& shard = _getShard(usage[i].subject);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    auto bucket = _findBucket(shard, usage[i].subject, usage[i].topic);
+    if (bucket == nullptr) {
+      continue;
+    }
+
+    // The total starts over when it expires in Redis. The first sync of a
+    // bucket only learns where the total is.
+    const long long before = totals[i] - static_cast<long long>(usage[i].consumed);
+    long long others       = 0;
+
+    if (bucket->synced >= 0) {
+      others = before >= bucket->synced ? before - bucket->synced : before;
+    }
+
+    bucket->synced = totals[i];
+    bucket->tokens = std::max(bucket->tokens - others, -static_cast<double>(bucket->max));
+  }
+}
+
+/**
+ * Put back usage that could not be synced, so it is sent with the next sync.
+ */
+void LocalRateLimiter::restoreUsage(const std::vector<RateLimitUsage>& usage) {
+  for (const auto& u : usage) {
+    auto& shard = _getShard(u.subject);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    auto bucket = _findBucket(shard, u.subject, u.topic);
+    if (bucket != nullptr) {
+      bucket->pending += u.consumed;
+    }
+  }
+}
+
+/**
+ * Number of buckets.
+ */
+std::size_t LocalRateLimiter::size() {
+  std::size_t count = 0;
+
+  for (auto& shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    for (const auto& subject : shard.subjects) {
+      count += subject.second.size();
+    }
+  }
+
+  return count;
+}
+
+LocalRateLimiter::Bucket* LocalRateLimiter::_findBucket(Shard& shard, const std::string& subject, const std::string& topic) {
+  auto subjectIt = shard.subjects.find(subject);
+  if (subjectIt == shard.subjects.end()) {
+    return nullptr;
+  }
+
+  auto it = subjectIt->second.find(topic);
+  return it == subjectIt->second.end() ? nullptr : &it->second;
+}
+
+void LocalRateLimiter::_refill(Bucket& bucket, Clock::time_point now) {
+  const auto elapsed = std::chrono::duration<double>(now - bucket.refilledAt).count();
+
+  if (elapsed > 0) {
+    bucket.tokens     = std::min(static_cast<double>(bucket.max), bucket.tokens + elapsed * bucket.max / bucket.interval);
+    bucket.refilledAt = now;
+  }
+}
+
+} // namespace eventhub
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "PublishBatcher.hpp"
+
+namespace eventhub {
+
+PublishBatcher::PublishBatcher(std::size_t maxBatchSize, std::chrono::microseconds maxLatency, PublishBatchCallback callback) :
+  _max_batch_size(maxBatchSize), _max_latency(maxLatency), _callback(callback), _stop_requested(false), _next_seq(1) {
+  _batch = std::make_unique<PublishBatch>();
+}
+
+PublishBatcher::~PublishBatcher() {
+  stop();
+}
+
+/**
+ * Start the flusher thread responsible for handing off partial batches
+ * once they have waited for maxLatency.
+ */
+void PublishBatcher::start() {
+  if (!_isBatchingEnabled() || _flusher.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_batch_lock);
+    _stop_requested = false;
+  }
+
+  _flusher = std::thread(&PublishBatcher::_flusherMain, this);
+}
+
+/**
+ * Stop the flusher thread and hand off whatever is left in the current batch.
+ */
+void PublishBatcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_batch_lock);
+    _stop_requested = true;
+  }
+
+  _batch_cv.notify_all();
+
+  if (_flusher.joinable()) {
+    _flusher.join();
+  }
+
+  flush();
+}
+
+/**
+ * Add a message to the current batch.
+ * Hands off the batch directly if it is full or batching is disabled.
+ * @param topic Topic the message was published to.
+ * @param data Message payload.
+ */
+void PublishBatcher::add(const InternedTopic& topic, const std::string& data) {
+  bool isFirst = false;
+  bool isFull  = false;
+
+  {
+    std::lock_guard<std::mutex> lock(_batch_lock);
+    _batch->push_back(PublishMessage{topic, data, _next_seq++});
+
+    if (_batch->size() == 1) {
+      _batch_started = std::chrono::steady_clock::now();
+      isFirst        = true;
+    }
+
+    isFull = !_isBatchingEnabled() || _batch->size() >= _max_batch_size;
+  }
+
+  if (isFull) {
+    flush();
+  } else if (isFirst) {
+    _batch_cv.notify_one();
+  }
+}
+
+/**
+ * Hand off the current batch to the callback if it is non-empty.
+ */
+void PublishBatcher::flush() {
+  std::lock_guard<std::mutex> flushLock(_flush_lock);
+  std::unique_ptr<PublishBatch> batch;
+
+  {
+    std::lock_guard<std::mutex> lock(_batch_lock);
+    if (_batch->empty()) {
+      return;
+    }
+
+    batch  = std::move(_batch);
+    _batch = std::make_unique<PublishBatch>();
+  }
+
+  _callback(PublishBatchPtr(std::move(batch)));
+}
+
+bool PublishBatcher::_isBatchingEnabled() const {
+  return _max_batch_size > 1 && _max_latency.count() > 0;
+}
+
+void PublishBatcher::_flusherMain() {
+  std::unique_lock<std::mutex> lock(_batch_lock);
+
+  while (!_stop_requested) {
+    if (_batch->empty()) {
+      _batch_cv.wait(lock, [this]() { return _stop_requested || !_batch->empty(); });
+      continue;
+    }
+
+    // The producer may flush and refill the batch while we wait, so
+    // recalculate the deadline from the current batch every time we wake up.
+    const auto deadline = _batch_started + _max_latency;
+    if (std::chrono::steady_clock::now() < deadline) {
+      _batch_cv.wait_until(lock, deadline);
+      continue;
+    }
+
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+
+} // namespace eventhub
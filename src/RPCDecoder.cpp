@@ -0,0 +1,577 @@
+#include <strings.h>
+#include <climits>
+#include <string>
+#include <string_view>
+
+#include "RPCDecoder.hpp"
+#include "Common.hpp"
+
+namespace eventhub {
+namespace {
+// Nesting allowed in parameters we skip over.
+constexpr unsigned int MAX_SKIP_DEPTH = 32;
+
+/**
+ * Reads JSON values off a buffer. Every read returns false on input it
+ * doesn't accept, which makes the decoder give up on the request.
+ */
+class Reader {
+public:
+  explicit Reader(const std::string& data) : _p(data.data()), _end(data.data() + data.length()) {}
+
+  bool consume(char c) {
+    _skipWhitespace();
+
+    if (_p < _end && *_p == c) {
+      _p++;
+      return true;
+    }
+
+    return false;
+  }
+
+  bool peek(char c) {
+    _skipWhitespace();
+    return _p < _end && *_p == c;
+  }
+
+  bool atEnd() {
+    _skipWhitespace();
+    return _p == _end;
+  }
+
+  /**
+   * Read an object key and the colon after it. Keys with escapes are left
+   * to jsonrpcpp, none of the ones we know of need them.
+   */
+  bool readKey(std::string_view& key) {
+    if (!consume('"')) {
+      return false;
+    }
+
+    const char* start = _p;
+    while (_p < _end && *_p != '"') {
+      if (*_p == '\\' || static_cast<unsigned char>(*_p) < 0x20) {
+        return false;
+      }
+
+      _p++;
+    }
+
+    if (_p == _end) {
+      return false;
+    }
+
+    key = std::string_view(start, _p - start);
+    _p++;
+
+    return consume(':');
+  }
+
+  /**
+   * Read a string, unescaped. Rejects what nlohmann::json would reject:
+   * control characters, bad escapes and invalid UTF-8.
+   */
+  bool readString(std::string& out) {
+    if (!consume('"')) {
+      return false;
+    }
+
+    out.clear();
+
+    while (_p < _end) {
+      const char* start = _p;
+      while (_p < _end && *_p != '"' && *_p != '\\' && static_cast<unsigned char>(*_p) >= 0x20 && static_cast<unsigned char>(*_p) < 0x80) {
+        _p++;
+      }
+
+      out.append(start, _p - start);
+
+      if (_p == _end) {
+        return false;
+      }
+
+      const auto c = static_cast<unsigned char>(*_p);
+
+      if (c == '"') {
+        _p++;
+        return true;
+      } else if (c == '\\') {
+        if (!_readEscape(out)) {
+          return false;
+        }
+      } else if (c < 0x20 || !_readUTF8(out)) {
+        return false;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Read an integer. Fractions and exponents are left to jsonrpcpp.
+   */
+  bool readInteger(long long& value) {
+    _skipWhitespace();
+
+    const bool negative = _p < _end && *_p == '-';
+    if (negative) {
+      _p++;
+    }
+
+    if (_p == _end || !_isDigit(*_p) || (*_p == '0' && _p + 1 < _end && _isDigit(_p[1]))) {
+      return false;
+    }
+
+    unsigned long long v = 0;
+    while (_p < _end && _isDigit(*_p)) {
+      const unsigned int digit = *_p - '0';
+      if (v > (ULLONG_MAX - digit) / 10) {
+        return false;
+      }
+
+      v = v * 10 + digit;
+      _p++;
+    }
+
+    if (_p < _end && (*_p == '.' || *_p == 'e' || *_p == 'E')) {
+      return false;
+    }
+
+    if (negative) {
+      if (v > static_cast<unsigned long long>(LLONG_MAX) + 1) {
+        return false;
+      }
+
+      value = static_cast<long long>(0 - v);
+    } else {
+      if (v > static_cast<unsigned long long>(LLONG_MAX)) {
+        return false;
+      }
+
+      value = static_cast<long long>(v);
+    }
+
+    return true;
+  }
+
+  /**
+   * Read a request ID the way jsonrpcpp::Id takes it.
+   */
+  bool readId(jsonrpcpp::Id& id) {
+    if (peek('"')) {
+      std::string stringId;
+      if (!readString(stringId)) {
+        return false;
+      }
+
+      id = jsonrpcpp::Id(stringId);
+      return true;
+    }
+
+    if (_readLiteral("null")) {
+      id = jsonrpcpp::Id();
+      return true;
+    }
+
+    long long intId;
+    if (!readInteger(intId) || intId < INT_MIN || intId > INT_MAX) {
+      return false;
+    }
+
+    id = jsonrpcpp::Id(static_cast<int>(intId));
+    return true;
+  }
+
+  /**
+   * Skip over a value we have no use for.
+   */
+  bool skipValue(unsigned int depth = 0) {
+    if (depth > MAX_SKIP_DEPTH) {
+      return false;
+    }
+
+    if (peek('"')) {
+      std::string str;
+      return readString(str);
+    }
+
+    if (consume('{')) {
+      if (consume('}')) {
+        return true;
+      }
+
+      do {
+        std::string key;
+        if (!readString(key) || !consume(':') || !skipValue(depth + 1)) {
+          return false;
+        }
+      } while (consume(','));
+
+      return consume('}');
+    }
+
+    if (consume('[')) {
+      if (consume(']')) {
+        return true;
+      }
+
+      do {
+        if (!skipValue(depth + 1)) {
+          return false;
+        }
+      } while (consume(','));
+
+      return consume(']');
+    }
+
+    if (_readLiteral("true") || _readLiteral("false") || _readLiteral("null")) {
+      return true;
+    }
+
+    return _skipNumber();
+  }
+
+private:
+  const char* _p;
+  const char* _end;
+
+  static bool _isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  void _skipWhitespace() {
+    while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r')) {
+      _p++;
+    }
+  }
+
+  bool _readLiteral(std::string_view literal) {
+    _skipWhitespace();
+
+    if (static_cast<std::size_t>(_end - _p) < literal.length() || std::string_view(_p, literal.length()) != literal) {
+      return false;
+    }
+
+    _p += literal.length();
+    return true;
+  }
+
+  bool _skipNumber() {
+    if (_p < _end && *_p == '-') {
+      _p++;
+    }
+
+    if (_p == _end || !_isDigit(*_p)) {
+      return false;
+    }
+
+    if (*_p == '0') {
+      _p++;
+    } else {
+      while (_p < _end && _isDigit(*_p)) {
+        _p++;
+      }
+    }
+
+    if (_p < _end && *_p == '.') {
+      _p++;
+      if (_p == _end || !_isDigit(*_p)) {
+        return false;
+      }
+
+      while (_p < _end && _isDigit(*_p)) {
+        _p++;
+      }
+    }
+
+    if (_p < _end && (*_p == 'e' || *_p == 'E')) {
+      _p++;
+      if (_p < _end && (*_p == '+' || *_p == '-')) {
+        _p++;
+      }
+
+      if (_p == _end || !_isDigit(*_p)) {
+        return false;
+      }
+
+      while (_p < _end && _isDigit(*_p)) {
+        _p++;
+      }
+    }
+
+    return true;
+  }
+
+  bool _readHex4(unsigned int& codepoint) {
+    if (_end - _p < 4) {
+      return false;
+    }
+
+    codepoint = 0;
+    for (int i = 0; i < 4; i++) {
+      const char c = *_p++;
+      codepoint <<= 4;
+
+      if (c >= '0' && c <= '9') {
+        codepoint |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        codepoint |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        codepoint |= c - 'A' + 10;
+      } else {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool _readEscape(std::string& out) {
+    // Skip the backslash.
+    if (++_p == _end) {
+      return false;
+    }
+
+    switch (*_p++) {
+      case '"': out += '"'; return true;
+      case '\\': out += '\\'; return true;
+      case '/': out += '/'; return true;
+      case 'b': out += '\b'; return true;
+      case 'f': out += '\f'; return true;
+      case 'n': out += '\n'; return true;
+      case 'r': out += '\r'; return true;
+      case 't': out += '\t'; return true;
+      case 'u': break;
+      default: return false;
+    }
+
+    unsigned int codepoint;
+    if (!_readHex4(codepoint)) {
+      return false;
+    }
+
+    if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+      return false;
+    }
+
+    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+      unsigned int low;
+      if (_end - _p < 2 || _p[0] != '\\' || _p[1] != 'u') {
+        return false;
+      }
+
+      _p += 2;
+      if (!_readHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+        return false;
+      }
+
+      codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    if (codepoint < 0x80) {
+      out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+      out += static_cast<char>(0xC0 | (codepoint >> 6));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+      out += static_cast<char>(0xE0 | (codepoint >> 12));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (codepoint >> 18));
+      out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+
+    return true;
+  }
+
+  /**
+   * Copy one UTF-8 encoded character, following the well-formed byte
+   * sequences of RFC 3629.
+   */
+  bool _readUTF8(std::string& out) {
+    const auto first = static_cast<unsigned char>(*_p);
+    unsigned char low = 0x80, high = 0xBF;
+    int length;
+
+    if (first >= 0xC2 && first <= 0xDF) {
+      length = 2;
+    } else if (first >= 0xE0 && first <= 0xEF) {
+      length = 3;
+      low    = first == 0xE0 ? 0xA0 : 0x80;
+      high   = first == 0xED ? 0x9F : 0xBF;
+    } else if (first >= 0xF0 && first <= 0xF4) {
+      length = 4;
+      low    = first == 0xF0 ? 0x90 : 0x80;
+      high   = first == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      return false;
+    }
+
+    if (_end - _p < length) {
+      return false;
+    }
+
+    for (int i = 1; i < length; i++) {
+      const auto c = static_cast<unsigned char>(_p[i]);
+      if (c < low || c > high) {
+        return false;
+      }
+
+      low  = 0x80;
+      high = 0xBF;
+    }
+
+    out.append(_p, length);
+    _p += length;
+
+    return true;
+  }
+};
+
+bool decodeParams(Reader& reader, RPCRequest& request) {
+  // Positional parameters are left to jsonrpcpp.
+  if (!reader.consume('{')) {
+    return false;
+  }
+
+  if (reader.consume('}')) {
+    return true;
+  }
+
+  std::string_view key;
+  long long value;
+
+  do {
+    if (!reader.readKey(key)) {
+      return false;
+    }
+
+    if (key == "topic") {
+      if (!reader.readString(request.topic)) {
+        return false;
+      }
+    } else if (key == "message") {
+      if (!reader.readString(request.message)) {
+        return false;
+      }
+    } else if (key == "sinceEventId") {
+      if (!reader.readString(request.sinceEventId)) {
+        return false;
+      }
+    } else if (key == "since") {
+      if (!reader.readInteger(request.since)) {
+        return false;
+      }
+    } else if (key == "limit") {
+      if (!reader.readInteger(value)) {
+        return false;
+      }
+
+      request.limit = value;
+    } else if (key == "timestamp") {
+      if (!reader.readInteger(request.timestamp)) {
+        return false;
+      }
+    } else if (key == "ttl") {
+      if (!reader.readInteger(value)) {
+        return false;
+      }
+
+      request.ttl = static_cast<unsigned long>(value);
+    } else if (!reader.skipValue()) {
+      return false;
+    }
+  } while (reader.consume(','));
+
+  return reader.consume('}');
+}
+} // namespace
+
+void RPCRequest::clear() {
+  method    = RPCRequestMethod::OTHER;
+  id        = jsonrpcpp::Id();
+  since     = 0;
+  timestamp = 0;
+  ttl       = 0;
+  limit.reset();
+  topic.clear();
+  sinceEventId.clear();
+
+  // Keep the buffer for the next message, unless it was a large one.
+  if (message.capacity() > RPC_REQUEST_MESSAGE_KEEP_SIZE) {
+    std::string().swap(message);
+  } else {
+    message.clear();
+  }
+}
+
+/**
+ * Decode a publish or subscribe request.
+ * @param data Websocket frame payload.
+ * @param request Cleared and filled in, its buffers are reused.
+ * @returns false if the request has to go through jsonrpcpp instead.
+ */
+bool RPCDecoder::decode(const std::string& data, RPCRequest& request) {
+  Reader reader(data);
+  std::string_view key;
+  std::string value;
+  bool hasId      = false;
+  bool hasVersion = false;
+  bool hasParams  = false;
+
+  request.clear();
+
+  if (!reader.consume('{') || reader.consume('}')) {
+    return false;
+  }
+
+  do {
+    if (!reader.readKey(key)) {
+      return false;
+    }
+
+    if (key == "jsonrpc") {
+      if (!reader.readString(value) || value != "2.0") {
+        return false;
+      }
+
+      hasVersion = true;
+    } else if (key == "id") {
+      if (!reader.readId(request.id)) {
+        return false;
+      }
+
+      hasId = true;
+    } else if (key == "method") {
+      if (!reader.readString(value)) {
+        return false;
+      }
+
+      if (strcasecmp(value.c_str(), "publish") == 0) {
+        request.method = RPCRequestMethod::PUBLISH;
+      } else if (strcasecmp(value.c_str(), "subscribe") == 0) {
+        request.method = RPCRequestMethod::SUBSCRIBE;
+      } else {
+        return false;
+      }
+    } else if (key == "params") {
+      if (hasParams || !decodeParams(reader, request)) {
+        return false;
+      }
+
+      hasParams = true;
+    } else {
+      return false;
+    }
+  } while (reader.consume(','));
+
+  if (!reader.consume('}') || !reader.atEnd()) {
+    return false;
+  }
+
+  return hasId && hasVersion && request.method != RPCRequestMethod::OTHER;
+}
+
+} // namespace eventhub
@@ -1,5 +1,7 @@
 #include <fmt/format.h>
 #include <spdlog/logger.h>
+#include <strings.h>
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <cstdint>
@@ -9,6 +11,7 @@
 #include <cmath>
 
 #include "RPCHandler.hpp"
+#include "Arena.hpp"
 #include "Config.hpp"
 #include "Connection.hpp"
 #include "HandlerContext.hpp"
@@ -43,11 +46,8 @@ RPCMethod RPCHandler::getHandler(const std::string& methodName) {
       {"ping", _handlePing},
       {"disconnect", _handleDisconnect}};
 
-  std::string methodNameLC = methodName;
-  Util::strToLower(methodNameLC);
-
-  for (auto handler : handlers) {
-    if (methodNameLC == handler.first) {
+  for (const auto& handler : handlers) {
+    if (strcasecmp(methodName.c_str(), handler.first.c_str()) == 0) {
       return handler.second;
     }
   }
@@ -55,16 +55,148 @@ RPCMethod RPCHandler::getHandler(const std::string& methodName) {
   throw std::bad_function_call();
 }
 
+/**
+ * Handle a request decoded by RPCDecoder.
+ * @param ctx Client issuing request.
+ * @param req Decoded request.
+ */
+void RPCHandler::handleRequest(HandlerContext& ctx, const RPCRequest& req) {
+  switch (req.method) {
+    case RPCRequestMethod::PUBLISH:
+      _publish(ctx, req);
+      break;
+
+    case RPCRequestMethod::SUBSCRIBE:
+      _subscribe(ctx, req);
+      break;
+
+    case RPCRequestMethod::OTHER:
+      break;
+  }
+}
+
 void RPCHandler::_sendInvalidParamsError(HandlerContext& ctx, jsonrpcpp::request_ptr req, const std::string& message) {
+  _sendInvalidParamsError(ctx, req->id(), message);
+}
+
+void RPCHandler::_sendInvalidParamsError(HandlerContext& ctx, const jsonrpcpp::Id& id, const std::string& message) {
   websocket::Response::sendData(ctx.connection(),
-                                jsonrpcpp::Response(jsonrpcpp::InvalidParamsException(message, req->id())).to_json().dump(),
+                                jsonrpcpp::Response(jsonrpcpp::InvalidParamsException(message, id)).to_json().dump(),
                                 websocket::FrameType::TEXT_FRAME);
 }
 
 void RPCHandler::_sendSuccessResponse(HandlerContext& ctx, jsonrpcpp::request_ptr req, const nlohmann::json& result) {
-  websocket::Response::sendData(ctx.connection(),
-                                jsonrpcpp::Response(*req, result).to_json().dump(),
-                                websocket::FrameType::TEXT_FRAME);
+  _sendResult(ctx, req->id(), result.dump());
+}
+
+/**
+ * Send a result made of strings without building a nlohmann::json for it.
+ */
+void RPCHandler::_sendStringResult(HandlerContext& ctx, const jsonrpcpp::Id& id, RPCStringResult result) {
+  ArenaString resultStr;
+  resultStr += '{';
+
+  for (const auto& field : result) {
+    if (resultStr.length() > 1) {
+      resultStr += ',';
+    }
+
+    Util::appendJsonString(resultStr, field.first);
+    resultStr += ':';
+    Util::appendJsonString(resultStr, field.second);
+  }
+
+  resultStr += '}';
+  _sendResult(ctx, id, std::string_view(resultStr.data(), resultStr.length()));
+}
+
+/**
+ * Send a response with an already serialized result. Renders the same JSON
+ * as jsonrpcpp::Response(*req, result).to_json().dump().
+ */
+void RPCHandler::_sendResult(HandlerContext& ctx, const jsonrpcpp::Id& id, std::string_view result) {
+  ArenaString response;
+
+  response.reserve(result.length() + 64);
+  response.append("{\"id\":");
+
+  switch (id.type()) {
+    case jsonrpcpp::Id::value_t::string:
+      Util::appendJsonString(response, id.string_id());
+      break;
+
+    case jsonrpcpp::Id::value_t::integer: {
+      const fmt::format_int intId(id.int_id());
+      response.append(intId.data(), intId.size());
+      break;
+    }
+
+    case jsonrpcpp::Id::value_t::null:
+      response.append("null");
+      break;
+  }
+
+  response.append(",\"jsonrpc\":\"2.0\",\"result\":");
+  response.append(result);
+  response += '}';
+
+  websocket::Response::sendData(ctx.connection().get(), response.data(), response.length(), websocket::FrameType::TEXT_FRAME);
+}
+
+/**
+ * Get a string parameter without copying it.
+ * @returns Empty string if the parameter is missing or not a string.
+ */
+const std::string& RPCHandler::_getStringParam(jsonrpcpp::request_ptr req, const std::string& key) {
+  static const std::string empty;
+  const auto& params = req->params().param_map;
+
+  auto it = params.find(key);
+  if (it == params.end() || !it->second.is_string()) {
+    return empty;
+  }
+
+  return it->second.get_ref<const std::string&>();
+}
+
+/**
+ * Get a numeric parameter.
+ * @returns defaultValue if the parameter is missing or not a number.
+ */
+template <class T>
+T RPCHandler::_getNumberParam(jsonrpcpp::request_ptr req, const std::string& key, T defaultValue) {
+  const auto& params = req->params().param_map;
+
+  auto it = params.find(key);
+  if (it == params.end() || !it->second.is_number()) {
+    return defaultValue;
+  }
+
+  return it->second.get<T>();
+}
+
+/**
+ * Copy the parameters of a publish or subscribe request parsed by jsonrpcpp.
+ */
+RPCRequest RPCHandler::_toRPCRequest(jsonrpcpp::request_ptr req, RPCRequestMethod method) {
+  RPCRequest request;
+
+  request.method       = method;
+  request.id           = req->id();
+  request.topic        = _getStringParam(req, "topic");
+  request.message      = _getStringParam(req, "message");
+  request.sinceEventId = _getStringParam(req, "sinceEventId");
+  request.since        = _getNumberParam<long long>(req, "since", 0);
+  request.timestamp    = _getNumberParam<long long>(req, "timestamp", 0);
+  request.ttl          = _getNumberParam<unsigned long>(req, "ttl", 0);
+
+  const auto& params = req->params().param_map;
+  auto limit         = params.find("limit");
+  if (limit != params.end() && limit->second.is_number()) {
+    request.limit = limit->second.get<long long>();
+  }
+
+  return request;
 }
 
 /**
@@ -86,40 +218,22 @@ unsigned long long RPCHandler::_calculateRelativeSince(long long since) {
 /**
  * Helper function for sending cached events to client if requested.
  */
-void RPCHandler::_sendCacheToClient(HandlerContext &ctx, jsonrpcpp::request_ptr req, const std::string& topic) {
+void RPCHandler::_sendCacheToClient(HandlerContext &ctx, const RPCRequest& req) {
   // Return early if cache is not enabled.
   if (!ctx.config().get<bool>("enable_cache")) {
     return;
   }
 
-  std::string sinceEventId;
-  unsigned long long since, limit;
-  auto params = req->params();
-
-  try {
-    sinceEventId = params.get("sinceEventId").get<std::string>();
-  } catch (...) {}
-
-  try {
-    since = params.get("since").get<long long>();
-    since = _calculateRelativeSince(since);
-  } catch (...) {
-    since = 0;
-  }
+  const auto& topic              = req.topic;
+  const auto& sinceEventId       = req.sinceEventId;
+  const unsigned long long since = _calculateRelativeSince(req.since);
 
   if (sinceEventId.empty() && since == 0) {
     return;
   }
 
-  try {
-    limit = params.get("limit").get<long long>();
-  } catch (...) {
-    limit = ctx.config().get<int>("max_cache_request_limit");
-  }
-
-  if (limit > (unsigned long long)ctx.config().get<int>("max_cache_request_limit")) {
-    limit = ctx.config().get<int>("max_cache_request_limit");
-  }
+  const unsigned long long maxLimit = ctx.config().get<int>("max_cache_request_limit");
+  const unsigned long long limit    = std::min<unsigned long long>(req.limit.value_or(maxLimit), maxLimit);
 
   try {
     nlohmann::json result;
@@ -130,7 +244,7 @@ void RPCHandler::_sendCacheToClient(HandlerContext &ctx, jsonrpcpp::request_ptr
       redis.getCacheSince(topic, since, limit, TopicManager::isValidTopicFilter(topic), result);
 
     for (auto& cacheItem : result) {
-      _sendSuccessResponse(ctx, req, cacheItem);
+      _sendResult(ctx, req.id, cacheItem.dump());
     }
   } catch (std::exception& e) {
     LOG->error("Error while looking up cache: {}.", e.what());
@@ -144,41 +258,37 @@ void RPCHandler::_sendCacheToClient(HandlerContext &ctx, jsonrpcpp::request_ptr
  * @param req RPC request.
  */
 void RPCHandler::_handleSubscribe(HandlerContext& ctx, jsonrpcpp::request_ptr req) {
-  auto accessController = ctx.connection()->getAccessController();
-  auto params           = req->params();
-  std::string topicName;
-  std::stringstream msg;
+  _subscribe(ctx, _toRPCRequest(req, RPCRequestMethod::SUBSCRIBE));
+}
 
-  try {
-    topicName    = params.get("topic").get<std::string>();
-  } catch (...) {}
+/**
+ * Subscribe client to given topic pattern.
+ * @param ctx Client issuing request.
+ * @param req Subscribe request.
+ */
+void RPCHandler::_subscribe(HandlerContext& ctx, const RPCRequest& req) {
+  auto accessController = ctx.connection()->getAccessController();
+  const auto& topicName = req.topic;
 
   if (topicName.empty()) {
-    return _sendInvalidParamsError(ctx, req, "You must specify 'topic' to subscribe to.");
+    return _sendInvalidParamsError(ctx, req.id, "You must specify 'topic' to subscribe to.");
   }
 
   if (!TopicManager::isValidTopicOrFilter(topicName)) {
-    msg << "Invalid topic in request: " << topicName;
-    return _sendInvalidParamsError(ctx, req, msg.str());
+    return _sendInvalidParamsError(ctx, req.id, fmt::format("Invalid topic in request: {}", topicName));
   }
 
   if (!accessController->allowSubscribe(topicName)) {
-    msg << "You are not allowed to subscribe to topic: " << topicName;
-    return _sendInvalidParamsError(ctx, req, msg.str());
+    return _sendInvalidParamsError(ctx, req.id, fmt::format("You are not allowed to subscribe to topic: {}", topicName));
   }
 
-  ctx.connection()->subscribe(topicName, req->id());
+  ctx.connection()->subscribe(topicName, req.id);
   LOG->debug("{} - SUBSCRIBE {}", ctx.connection()->getIP(), topicName);
 
-  nlohmann::json result;
-  result["action"] = "subscribe";
-  result["topic"]  = topicName;
-  result["status"] = "ok";
-
-  _sendSuccessResponse(ctx, req, result);
+  _sendStringResult(ctx, req.id, {{"action", "subscribe"}, {"status", "ok"}, {"topic", topicName}});
 
   // Send cached events if requested.
-  _sendCacheToClient(ctx, req, topicName);
+  _sendCacheToClient(ctx, req);
 }
 
 /**
@@ -232,90 +342,63 @@ void RPCHandler::_handleUnsubscribeAll(HandlerContext& ctx, jsonrpcpp::request_p
  * @param req RPC request.
  */
 void RPCHandler::_handlePublish(HandlerContext& ctx, jsonrpcpp::request_ptr req) {
-  std::string topicName;
-  std::string message;
-  std::stringstream msg;
-  long long timestamp;
-  std::size_t ttl;
+  _publish(ctx, _toRPCRequest(req, RPCRequestMethod::PUBLISH));
+}
 
+/**
+ * Publish message to topic.
+ * @param ctx Client issuing request.
+ * @param req Publish request.
+ */
+void RPCHandler::_publish(HandlerContext& ctx, const RPCRequest& req) {
   auto accessController = ctx.connection()->getAccessController();
-  auto params           = req->params();
-
-  try {
-    topicName = params.get("topic").get<std::string>();
-    message   = params.get("message").get<std::string>();
-  } catch (...) {}
+  const auto& topicName = req.topic;
+  const auto& message   = req.message;
 
   if (topicName.empty() || message.empty()) {
-    msg << "You need to specify topic and message to publish to.";
-    return _sendInvalidParamsError(ctx, req, msg.str());
+    return _sendInvalidParamsError(ctx, req.id, "You need to specify topic and message to publish to.");
   }
 
   if (!accessController->allowPublish(topicName)) {
-    msg << "Insufficient access to topic: " << topicName;
-    return _sendInvalidParamsError(ctx, req, msg.str());
+    return _sendInvalidParamsError(ctx, req.id, fmt::format("Insufficient access to topic: {}", topicName));
   }
 
   if (!TopicManager::isValidTopic(topicName)) {
-    msg << topicName << " is not a valid topic.";
-    return _sendInvalidParamsError(ctx, req, msg.str());
+    return _sendInvalidParamsError(ctx, req.id, fmt::format("{} is not a valid topic.", topicName));
   }
 
-  try {
-    timestamp = params.get("timestamp").get<long long>();
-  } catch (...) {
-    timestamp = 0;
-  }
-
-  try {
-    ttl = params.get("ttl").get<unsigned long>();
-  } catch (...) {
-    ttl = 0;
-  }
+  const auto timestamp = req.timestamp;
+  const auto ttl       = req.ttl;
 
   try {
     auto& redis = ctx.server()->getRedis();
     const auto& subject = accessController->subject();
 
-    if (!subject.empty()) {
-      try {
-        const auto limits = accessController->getRateLimitConfig().getRateLimitForTopic(topicName);
-
-        if (redis.isRateLimited(limits.topic, subject, limits.max)) {
-          LOG->trace("PUBLISH {}: User {} is currently ratelimited. Interval: {} Max: {} Matched ratelimit pattern: {}", topicName, subject, limits.interval, limits.max, limits.topic);
-          nlohmann::json result;
-          result["action"] = "publish";
-          result["topic"]  = topicName;
-          result["status"] = "ERR_RATE_LIMIT_EXCEEDED";
-
-          return _sendSuccessResponse(ctx, req, result);
-        } else {
-          redis.incrementLimitCount(limits.topic, subject, limits.interval);
-        }
-      } catch (NoRateLimitForTopic) {}
+    const auto limits = subject.empty() ? nullptr : accessController->getRateLimitConfig().findRateLimitForTopic(topicName);
+
+    if (limits != nullptr) {
+      const auto rateLimit = ctx.server()->checkRateLimit(limits->topic, subject, limits->interval, limits->max);
+
+      if (rateLimit.limited) {
+        ctx.server()->countRateLimited(limits->topic);
+        LOG->trace("PUBLISH {}: User {} is currently ratelimited. Count: {} Interval: {} Max: {} Matched ratelimit pattern: {}", topicName, subject, rateLimit.count, limits->interval, limits->max, limits->topic);
+        return _sendStringResult(ctx, req.id, {{"action", "publish"}, {"status", "ERR_RATE_LIMIT_EXCEEDED"}, {"topic", topicName}});
+      }
     }
 
     auto id     = redis.cacheMessage(topicName, message, accessController->subject(), timestamp, ttl);
 
     if (id.length() == 0) {
-      msg << "Failed to cache message in Redis, discarding.";
-      return _sendInvalidParamsError(ctx, req, msg.str());
+      return _sendInvalidParamsError(ctx, req.id, "Failed to cache message in Redis, discarding.");
     }
 
     redis.publishMessage(topicName, id, message, accessController->subject());
     LOG->debug("{} - PUBLISH {}", ctx.connection()->getIP(), topicName);
 
-    nlohmann::json result;
-    result["action"] = "publish";
-    result["topic"]  = topicName;
-    result["id"]     = id;
-    result["status"] = "ok";
-
-    _sendSuccessResponse(ctx, req, result);
+    _sendStringResult(ctx, req.id, {{"action", "publish"}, {"id", id}, {"status", "ok"}, {"topic", topicName}});
   } catch (std::exception& e) {
     LOG->error("Error while publishing message: {}.", e.what());
-    msg << "Error while publishing message: " << e.what();
-    _sendInvalidParamsError(ctx, req, msg.str());
+    _sendInvalidParamsError(ctx, req.id, fmt::format("Error while publishing message: {}", e.what()));
   }
 }
 
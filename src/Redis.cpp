@@ -1,17 +1,21 @@
 #include <fmt/format.h>
+#include <openssl/evp.h>
 #include <spdlog/logger.h>
 #include <stdint.h>
+#include <string.h>
 #include <sw/redis++/command_options.h>
 #include <sw/redis++/connection.h>
 #include <sw/redis++/connection_pool.h>
 #include <sw/redis++/redis.h>
 #include <sw/redis++/utils.h>
 #include <sw/redis++/redis.hpp>
+#include <algorithm>
 #include <chrono>
 #include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <unordered_map>
@@ -20,6 +24,7 @@
 #include <iterator>
 #include <tuple>
 #include "Redis.hpp"
+#include "Common.hpp"
 #include "Config.hpp"
 #include "TopicManager.hpp"
 #include "Util.hpp"
@@ -27,6 +32,101 @@
 #include "Logger.hpp"
 
 namespace eventhub {
+namespace {
+/*
+  Rate limit scripts. KEYS[1] is the counter of the user and pattern,
+  ARGV[1] the max publishes and ARGV[2] the interval in seconds. They return
+  {limited, count}.
+*/
+
+// Counter that resets interval seconds after the first publish.
+constexpr const char* FIXED_WINDOW_SCRIPT = R"lua(
+local count = tonumber(redis.call('GET', KEYS[1]) or '0')
+if count >= tonumber(ARGV[1]) then
+  return {1, count}
+end
+count = redis.call('INCR', KEYS[1])
+if count == 1 then
+  redis.call('EXPIRE', KEYS[1], ARGV[2])
+end
+return {0, count}
+)lua";
+
+// Counts of the current and previous window, the previous one weighted by
+// how much of it still overlaps the last interval.
+constexpr const char* SLIDING_WINDOW_SCRIPT = R"lua(
+if redis.replicate_commands then redis.replicate_commands() end
+local max = tonumber(ARGV[1])
+local interval = tonumber(ARGV[2]) * 1000
+local time = redis.call('TIME')
+local now = tonumber(time[1]) * 1000 + math.floor(tonumber(time[2]) / 1000)
+local window = math.floor(now / interval)
+local state = redis.call('HMGET', KEYS[1], 'window', 'current', 'previous')
+local stored = tonumber(state[1])
+local current = tonumber(state[2]) or 0
+local previous = tonumber(state[3]) or 0
+if stored ~= window then
+  if stored == window - 1 then previous = current else previous = 0 end
+  current = 0
+end
+local weight = 1 - (now - window * interval) / interval
+local count = math.floor(previous * weight) + current
+if count >= max then
+  return {1, count}
+end
+redis.call('HMSET', KEYS[1], 'window', window, 'current', current + 1, 'previous', previous)
+redis.call('PEXPIRE', KEYS[1], interval * 2)
+return {0, count + 1}
+)lua";
+
+// Generic cell rate algorithm: publishes are spaced interval / max apart,
+// with bursts of up to max.
+constexpr const char* GCRA_SCRIPT = R"lua(
+if redis.replicate_commands then redis.replicate_commands() end
+local max = tonumber(ARGV[1])
+local interval = tonumber(ARGV[2]) * 1000
+local emission = interval / max
+local time = redis.call('TIME')
+local now = tonumber(time[1]) * 1000 + tonumber(time[2]) / 1000
+local tat = tonumber(redis.call('GET', KEYS[1]) or '0')
+if tat < now then tat = now end
+local count = math.ceil((tat - now) / emission - 1e-9)
+if tat + emission - interval > now then
+  return {1, count}
+end
+tat = tat + emission
+redis.call('SET', KEYS[1], string.format('%.3f', tat), 'PX', math.ceil(tat - now))
+return {0, count + 1}
+)lua";
+
+// Add what a node has counted to the totals of its limits. KEYS are the
+// totals, ARGV holds the count and TTL of each. Returns the new totals.
+constexpr const char* RATE_LIMIT_SYNC_SCRIPT = R"lua(
+local totals = {}
+for i = 1, #KEYS do
+  totals[i] = redis.call('INCRBY', KEYS[i], ARGV[i * 2 - 1])
+  redis.call('EXPIRE', KEYS[i], ARGV[i * 2])
+end
+return totals
+)lua";
+
+std::string sha1Hex(const char* data) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digestLen = 0;
+
+  if (EVP_Digest(data, strlen(data), digest, &digestLen, EVP_sha1(), nullptr) != 1) {
+    throw std::runtime_error("Failed to calculate script SHA1");
+  }
+
+  std::string hex;
+  for (unsigned int i = 0; i < digestLen; i++) {
+    hex += fmt::format("{:02x}", digest[i]);
+  }
+
+  return hex;
+}
+} // namespace
+
 Redis::Redis(Config &cfg) : EventhubBase(cfg) {
   sw::redis::ConnectionOptions connOpts;
   sw::redis::ConnectionPoolOptions poolOpts;
@@ -49,31 +149,78 @@ Redis::Redis(Config &cfg) : EventhubBase(cfg) {
 
   _redisInstance   = std::make_unique<sw::redis::Redis>(connOpts, poolOpts);
   _redisSubscriber = nullptr;
+
+  // Server::start() refuses unknown algorithms.
+  if (!parseRateLimitAlgorithm(config().get<std::string>("rate_limit_algorithm"), _rate_limit_algorithm)) {
+    _rate_limit_algorithm = RateLimitAlgorithm::FIXED_WINDOW;
+  }
+
+  switch (_rate_limit_algorithm) {
+    case RateLimitAlgorithm::FIXED_WINDOW: _rate_limit_script.source = FIXED_WINDOW_SCRIPT; break;
+    case RateLimitAlgorithm::SLIDING_WINDOW: _rate_limit_script.source = SLIDING_WINDOW_SCRIPT; break;
+    case RateLimitAlgorithm::GCRA: _rate_limit_script.source = GCRA_SCRIPT; break;
+  }
+
+  _rate_limit_script.sha = sha1Hex(_rate_limit_script.source);
+
+  _rate_limit_sync_script.source = RATE_LIMIT_SYNC_SCRIPT;
+  _rate_limit_sync_script.sha    = sha1Hex(RATE_LIMIT_SYNC_SCRIPT);
 }
 
+// Key made of the prefix and parts, built in the arena of the calling worker
+// when there is one. Same as REDIS_PREFIX(parts...).
+template <class... Parts>
+ArenaString Redis::_key(const Parts&... parts) const {
+  ArenaString key;
+
+  if (!_prefix.empty()) {
+    key.append(_prefix);
+    key += ':';
+  }
+
+  (key.append(parts), ...);
+  return key;
+}
+
+namespace {
+sw::redis::StringView toStringView(const ArenaString& str) {
+  return sw::redis::StringView(str.data(), str.length());
+}
+} // namespace
+
 // Publish a message.
 void Redis::publishMessage(const std::string& topic, const std::string& id, const std::string& payload, const std::string& origin) {
-  std::lock_guard<std::mutex> lock(_publish_mtx);
-  nlohmann::json j;
+  // Same as dumping {topic, id, message, origin} with nlohmann::json, keys in order.
+  ArenaString jsonData;
+  jsonData.reserve(topic.length() + id.length() + payload.length() + origin.length() + 48);
 
-  j["topic"]   = topic;
-  j["id"]      = id;
-  j["message"] = payload;
+  jsonData.append("{\"id\":");
+  Util::appendJsonString(jsonData, id);
+  jsonData.append(",\"message\":");
+  Util::appendJsonString(jsonData, payload);
 
   if (!origin.empty()) {
-    j["origin"]  = origin;
+    jsonData.append(",\"origin\":");
+    Util::appendJsonString(jsonData, origin);
   }
 
-  auto jsonData = j.dump();
-  _redisInstance->publish(REDIS_PREFIX(topic), jsonData);
+  jsonData.append(",\"topic\":");
+  Util::appendJsonString(jsonData, topic);
+  jsonData += '}';
+
+  const auto channel = _key(topic);
+
+  std::lock_guard<std::mutex> lock(_publish_mtx);
+  _redisInstance->publish(toStringView(channel), toStringView(jsonData));
 }
 
 // Returns a unique ID in the format <timeSinceEpoch>-<sequenceNo>.
 const std::string Redis::_getNextCacheId(long long timestamp) {
-  const auto idKey = REDIS_PREFIX(fmt::format("id:{}", timestamp));
+  const fmt::format_int timestampStr(timestamp);
+  const auto idKey = _key("id:", std::string_view(timestampStr.data(), timestampStr.size()));
 
-  auto id = _redisInstance->incr(idKey);
-  _redisInstance->expire(idKey, 1);
+  auto id = _redisInstance->incr(toStringView(idKey));
+  _redisInstance->expire(toStringView(idKey), 1);
   id--; // Start at 0.
 
   return fmt::format("{}-{}", timestamp, id);
@@ -99,8 +246,8 @@ const std::string Redis::cacheMessage(const std::string& topic, const std::strin
   auto expireAt = Util::getTimeSinceEpoch() + (ttl * 1000);
   auto zKey     = CacheItemMeta{cacheId, expireAt, origin}.toStr();
 
-  _redisInstance->hset(REDIS_CACHE_DATA_PATH(topic), cacheId, payload);
-  _redisInstance->zadd(REDIS_CACHE_SCORE_PATH(topic), zKey, timestamp);
+  _redisInstance->hset(toStringView(_key(topic, ":cache")), cacheId, payload);
+  _redisInstance->zadd(toStringView(_key(topic, ":scores")), zKey, timestamp);
 
   _incrTopicPubCount(topic);
 
@@ -376,7 +523,7 @@ void Redis::consume() {
 // _incrTopicPubCount increase the counter of published messages to topicName
 // in our Redis stats HSET.
 void Redis::_incrTopicPubCount(const std::string& topicName) {
-  _redisInstance->hincrby(REDIS_PREFIX("pub_count"), topicName, 1);
+  _redisInstance->hincrby(toStringView(_key("pub_count")), topicName, 1);
 }
 
 // _getTopicsSeen Look up in our pubcount HSET in redis and return
@@ -397,42 +544,115 @@ std::vector<std::string> Redis::_getTopicsSeen(const std::string& topicPattern)
 }
 
 /*
-  Check if a user is ratelimited.
+  Count a publish against a rate limit and tell if it is allowed, in one
+  atomic round-trip to Redis. Publishes that are refused are not counted.
 */
-bool Redis::isRateLimited(const std::string& topic, const std::string& subject, unsigned long max) {
-  if (max == 0)
-    return false;
+RateLimitResult Redis::checkRateLimit(const std::string& topic, const std::string& subject, unsigned long interval, unsigned long max) {
+  if (max == 0 || interval == 0) {
+    return {false, 0};
+  }
 
-  const auto key = REDIS_RATE_LIMIT_PATH(_prefix, subject, topic);
-  auto count = _redisInstance->get(key);
-  if (count) {
-    auto c = std::stoull(count.value(), nullptr, 10);
-    if (c >= max) {
-      return true;
-    }
+  const char* suffix = "";
+  switch (_rate_limit_algorithm) {
+    case RateLimitAlgorithm::FIXED_WINDOW: break;
+    case RateLimitAlgorithm::SLIDING_WINDOW: suffix = ":sw"; break;
+    case RateLimitAlgorithm::GCRA: suffix = ":gcra"; break;
   }
 
-  return false;
+  const auto key         = _key(_prefix, ":rlimit:", topic, ":", subject, suffix);
+  const auto maxStr      = fmt::format_int(max);
+  const auto intervalStr = fmt::format_int(interval);
+
+  const auto reply = _evalScript(_rate_limit_script, toStringView(key),
+                                 {sw::redis::StringView(maxStr.data(), maxStr.size()),
+                                  sw::redis::StringView(intervalStr.data(), intervalStr.size())});
+
+  if (reply.size() != 2) {
+    throw std::runtime_error("Unexpected reply from rate limit script");
+  }
+
+  return {reply[0] != 0, reply[1]};
+}
+
+bool Redis::parseRateLimitAlgorithm(const std::string& name, RateLimitAlgorithm& algorithm) {
+  if (name == "fixed_window") {
+    algorithm = RateLimitAlgorithm::FIXED_WINDOW;
+  } else if (name == "sliding_window") {
+    algorithm = RateLimitAlgorithm::SLIDING_WINDOW;
+  } else if (name == "gcra") {
+    algorithm = RateLimitAlgorithm::GCRA;
+  } else {
+    return false;
+  }
+
+  return true;
 }
 
 /*
-  Increment publish count for user.
+  Add the publishes this node has counted against rate limits to their
+  totals across all nodes, in batches.
+  Returns the new total of each limit, in the same order.
 */
-void Redis::incrementLimitCount(const std::string& topic, const std::string& subject, unsigned long interval) {
-  if (interval == 0)
-    return;
+std::vector<long long> Redis::syncRateLimitUsage(const std::vector<RateLimitUsage>& usage) {
+  std::vector<long long> totals;
+  totals.reserve(usage.size());
+
+  for (std::size_t first = 0; first < usage.size(); first += RATE_LIMIT_SYNC_BATCH_SIZE) {
+    const auto last = std::min(usage.size(), first + RATE_LIMIT_SYNC_BATCH_SIZE);
+    std::vector<ArenaString> keys;
+    std::vector<std::string> args;
+    std::vector<sw::redis::StringView> keyViews, argViews;
+
+    keys.reserve(last - first);
+    args.reserve((last - first) * 2);
+
+    for (auto i = first; i < last; i++) {
+      keys.push_back(_key(_prefix, ":rlimit:", usage[i].topic, ":", usage[i].subject, ":tb"));
+      args.push_back(std::to_string(usage[i].consumed));
+      args.push_back(std::to_string(usage[i].ttl));
+    }
 
-  const auto key = REDIS_RATE_LIMIT_PATH(_prefix, subject, topic);
+    for (const auto& key : keys) {
+      keyViews.push_back(toStringView(key));
+    }
 
-  // FIXME: We might be able to optimize away this call to get by using the value from the previous get call
-  // in the isRateLimited() function.
-  auto count = _redisInstance->get(key);
+    argViews.assign(args.begin(), args.end());
 
-  if (count) {
-    _redisInstance->incr(key);
-  } else {
-    _redisInstance->setex(key, interval, "1");
+    const auto reply = _evalScript(_rate_limit_sync_script, keyViews, argViews);
+    if (reply.size() != last - first) {
+      throw std::runtime_error("Unexpected reply from rate limit sync script");
+    }
+
+    totals.insert(totals.end(), reply.begin(), reply.end());
+  }
+
+  return totals;
+}
+
+// Run a script by its SHA1, sending the source only when Redis doesn't
+// have it cached yet.
+std::vector<long long> Redis::_evalScript(const Script& script, const sw::redis::StringView& key, std::initializer_list<sw::redis::StringView> args) {
+  try {
+    return _redisInstance->evalsha<std::vector<long long>>(script.sha, {key}, args);
+  } catch (sw::redis::ReplyError& e) {
+    if (std::string_view(e.what()).substr(0, 8) != "NOSCRIPT") {
+      throw;
+    }
   }
+
+  return _redisInstance->eval<std::vector<long long>>(script.source, {key}, args);
+}
+
+std::vector<long long> Redis::_evalScript(const Script& script, const std::vector<sw::redis::StringView>& keys, const std::vector<sw::redis::StringView>& args) {
+  try {
+    return _redisInstance->evalsha<std::vector<long long>>(script.sha, keys.begin(), keys.end(), args.begin(), args.end());
+  } catch (sw::redis::ReplyError& e) {
+    if (std::string_view(e.what()).substr(0, 8) != "NOSCRIPT") {
+      throw;
+    }
+  }
+
+  return _redisInstance->eval<std::vector<long long>>(script.source, keys.begin(), keys.end(), args.begin(), args.end());
 }
 
 CacheItemMeta::CacheItemMeta(const std::string& id, unsigned long expireAt, const std::string& origin) :
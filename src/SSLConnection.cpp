@@ -9,6 +9,7 @@
 
 #include "Forward.hpp"
 #include "SSLConnection.hpp"
+#include "ConnectionWorker.hpp"
 #include "Util.hpp"
 #include "Common.hpp"
 #include "Logger.hpp"
@@ -16,8 +17,9 @@
 namespace eventhub {
 
 SSLConnection::SSLConnection(int fd, struct sockaddr_in* csin, Worker* worker, Config& cfg, SSL_CTX* ctx) :
-  Connection(fd, csin, worker, cfg), _ssl(nullptr, SSL_free), _ssl_ctx(ctx) {
-  _ssl_handshake_retries = 0;
+  Connection(fd, csin, worker, cfg, worker->getSocketProfile(true)), _ssl(nullptr, SSL_free), _ssl_ctx(ctx) {
+  _ssl_handshake_retries    = 0;
+  _ssl_handshake_want_write = false;
   _init();
 }
 
@@ -34,6 +36,10 @@ void SSLConnection::_init() {
 
   SSL_set_fd(_ssl.get(), _fd);
   SSL_set_accept_state(_ssl.get());
+
+  // _write_buffer may be reallocated between a SSL_write() that wants to be
+  // retried and the retry. Idle connections don't keep record buffers.
+  SSL_set_mode(_ssl.get(), SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_RELEASE_BUFFERS);
 }
 
 void SSLConnection::_handshake() {
@@ -46,6 +52,9 @@ void SSLConnection::_handshake() {
     return;
   }
 
+  const bool wantedWrite    = _ssl_handshake_want_write;
+  _ssl_handshake_want_write = false;
+
   if (ret <= 0) {
     int errorCode = SSL_get_error(_ssl.get(), ret);
     if (errorCode == SSL_ERROR_WANT_READ ||
@@ -56,23 +65,65 @@ void SSLConnection::_handshake() {
       shutdown();
       return;
     }
+
+    // Continued from flushSendBuffer() once the socket is writable. Waiting
+    // on a client that reads slowly is bounded by the handshake timeout.
+    if (errorCode == SSL_ERROR_WANT_WRITE) {
+      _ssl_handshake_want_write = true;
+      _enableEpollOut();
+
+      if (wantedWrite) {
+        return;
+      }
+    }
+  }
+
+  if (!_ssl_handshake_want_write) {
+    _disableEpollOut();
   }
 
   _ssl_handshake_retries++;
 }
 
 ssize_t SSLConnection::flushSendBuffer() {
+  // A handshake that couldn't write continues when the socket is writable.
+  // An edge-triggered socket won't be reported readable for it.
+  if (_ssl_handshake_want_write) {
+    _handshake();
+
+    if (_edge_triggered && !isShutdown() && SSL_is_init_finished(_ssl.get())) {
+      read();
+    }
+
+    return 0;
+  }
+
+  OutputAccountingScope accounting{this};
+  _refillFromBacklog();
+
   if (_write_buffer.empty() || isShutdown()) {
     _disableEpollOut();
     return 0;
   }
 
-  std::size_t pcktSize = _write_buffer.length() > NET_READ_BUFFER_SIZE ? NET_READ_BUFFER_SIZE : _write_buffer.length();
-  int ret               = SSL_write(_ssl.get(), _write_buffer.c_str(), pcktSize);
+  int ret             = 0;
+  std::size_t written = 0;
 
-  if (ret > 0) {
-    _pruneWriteBuffer(ret);
-  } else {
+  // In edge-triggered mode keep writing until OpenSSL can't write more, we
+  // won't be told about the socket being writable until then.
+  do {
+    std::size_t remaining = _write_buffer.length() - written;
+    std::size_t pcktSize  = remaining > NET_READ_BUFFER_SIZE ? NET_READ_BUFFER_SIZE : remaining;
+    ret                   = SSL_write(_ssl.get(), _write_buffer.c_str() + written, pcktSize);
+
+    if (ret > 0) {
+      written += ret;
+    }
+  } while (_edge_triggered && ret > 0 && written < _write_buffer.length());
+
+  _pruneWriteBuffer(written);
+
+  if (ret <= 0) {
     int err = SSL_get_error(_ssl.get(), ret);
 
     if (!(err == SSL_ERROR_SYSCALL && (errno == EAGAIN || errno == EWOULDBLOCK)) &&
@@ -85,6 +136,10 @@ ssize_t SSLConnection::flushSendBuffer() {
 
   if (_write_buffer.empty()) {
     _disableEpollOut();
+
+    if (_hasBacklog()) {
+      return flushSendBuffer();
+    }
   } else {
     _enableEpollOut();
   }
@@ -93,46 +148,30 @@ ssize_t SSLConnection::flushSendBuffer() {
 }
 
 void SSLConnection::read() {
-  _read_buffer.clear();
-
   if (isShutdown()) {
     return;
   }
 
   if (!SSL_is_init_finished(_ssl.get())) {
     _handshake();
-    return;
+
+    // Application data may arrive together with the end of the handshake.
+    // An edge-triggered socket won't report it again, so read it now.
+    if (!_edge_triggered || isShutdown() || !SSL_is_init_finished(_ssl.get())) {
+      return;
+    }
   }
 
-  std::size_t bytesRead = 0;
-  int ret          = 0;
+  auto& buffer = _worker->getReadBuffer();
+  int ret      = 0;
 
+  // Read everything OpenSSL has for us. The parsers take data in pieces,
+  // so each piece is handed over as it is read.
   do {
-    // If more read buffer capacity is required increase it by chunks of NET_READ_BUFFER_SIZE.
-    if ((bytesRead + NET_READ_BUFFER_SIZE) > _read_buffer.capacity()) {
-      std::size_t newCapacity = _read_buffer.capacity() + NET_READ_BUFFER_SIZE;
-
-      if (newCapacity > MAX_DATA_FRAME_SIZE + NET_READ_BUFFER_SIZE) {
-        LOG->error("Client {} exceeded max buffer size. Disconnecting.", getIP());
-        shutdown();
-        return;
-      }
-
-      // Retain data we have in the _read_buffer and copy it back after call to resize().
-      // We have to do this since resize() invalidates existing data.
-      std::vector<char> retain;
-      retain.resize(bytesRead);
-      memcpy(retain.data(), _read_buffer.data(), bytesRead);
-
-      LOG->trace("Resizing readbuffer for client {} to {}", getIP(), newCapacity);
-      _read_buffer.resize(newCapacity);
-      memcpy(_read_buffer.data(), retain.data(), bytesRead);
-    }
-
-    ret = SSL_read(_ssl.get(), _read_buffer.data() + bytesRead, NET_READ_BUFFER_SIZE);
+    ret = SSL_read(_ssl.get(), buffer.data(), buffer.size());
 
     if (ret > 0) {
-      bytesRead += ret;
+      _parseRequest(buffer.data(), ret);
       continue;
     }
 
@@ -146,9 +185,7 @@ void SSLConnection::read() {
       shutdown();
       return;
     }
-  } while (ret > 0);
-
-  _parseRequest(bytesRead);
+  } while (ret > 0 && !isShutdown());
 }
 
 } // namespace eventhub
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <linux/filter.h>
 #include <fmt/format.h>
 #include <openssl/pem.h>
 #include <openssl/ssl3.h>
@@ -15,6 +16,7 @@
 #include <stdio.h>
 #include <sw/redis++/errors.h>
 #include <unistd.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <memory>
@@ -28,10 +30,12 @@
 #include "Server.hpp"
 #include "Common.hpp"
 #include "Config.hpp"
+#include "CpuTopology.hpp"
 #include "Util.hpp"
 #include "jwt/json/json.hpp"
 #include "metrics/Types.hpp"
 #include "ConnectionWorker.hpp"
+#include "TopicManager.hpp"
 #include "KVStore.hpp"
 #include "Logger.hpp"
 
@@ -49,8 +53,11 @@ Server::Server(Config& cfg)
       _server_socket_ssl(-1),
       _ssl_enabled(false),
       _ssl_ctx(nullptr, SSL_CTX_free),
-      _redis(cfg) {
-
+      _redis(cfg),
+      _token_cache(cfg.get<int>("jwt_cache_size")) {
+  if (cfg.get<std::string>("rate_limit_mode") == "local") {
+    _local_rate_limiter = std::make_unique<LocalRateLimiter>(std::chrono::milliseconds(cfg.get<int>("rate_limit_sync_interval_ms")));
+  }
 }
 
 Server::~Server() {
@@ -64,6 +71,51 @@ void Server::start() {
     exit(1);
   }
 
+  const auto& ioBackend = config().get<std::string>("io_backend");
+  if (ioBackend != "epoll" && ioBackend != "io_uring") {
+    LOG->critical("Invalid io_backend \"{}\", must be epoll or io_uring.", ioBackend);
+    exit(1);
+  }
+
+  RateLimitAlgorithm rateLimitAlgorithm;
+  const auto& rateLimitAlgorithmName = config().get<std::string>("rate_limit_algorithm");
+  if (!Redis::parseRateLimitAlgorithm(rateLimitAlgorithmName, rateLimitAlgorithm)) {
+    LOG->critical("Invalid rate_limit_algorithm \"{}\", must be fixed_window, sliding_window or gcra.", rateLimitAlgorithmName);
+    exit(1);
+  }
+
+  const auto& rateLimitMode = config().get<std::string>("rate_limit_mode");
+  if (rateLimitMode != "redis" && rateLimitMode != "local") {
+    LOG->critical("Invalid rate_limit_mode \"{}\", must be redis or local.", rateLimitMode);
+    exit(1);
+  }
+
+  if (_local_rate_limiter && config().get<int>("rate_limit_sync_interval_ms") <= 0) {
+    LOG->critical("rate_limit_sync_interval_ms must be larger than 0.");
+    exit(1);
+  }
+
+  SlowConsumerPolicy slowConsumerPolicy;
+  const auto& slowConsumerPolicyName = config().get<std::string>("slow_consumer_policy");
+  if (!Connection::parseSlowConsumerPolicy(slowConsumerPolicyName, slowConsumerPolicy)) {
+    LOG->critical("Invalid slow_consumer_policy \"{}\", must be disconnect, drop_oldest, conflate or pause.", slowConsumerPolicyName);
+    exit(1);
+  }
+
+  if (config().get<int>("output_budget_bytes") < 0 || config().get<int>("output_budget_worker_bytes") < 0) {
+    LOG->critical("output_budget_bytes and output_budget_worker_bytes can't be negative.");
+    exit(1);
+  }
+
+  SocketProfile socketProfile;
+  const auto& socketProfileName    = config().get<std::string>("socket_profile");
+  const auto& sslSocketProfileName = config().get<std::string>("ssl_socket_profile");
+  if (!Connection::parseSocketProfile(socketProfileName, socketProfile) ||
+      (!sslSocketProfileName.empty() && !Connection::parseSocketProfile(sslSocketProfileName, socketProfile))) {
+    LOG->critical("Invalid socket_profile \"{}\" or ssl_socket_profile \"{}\", must be default or latency.", socketProfileName, sslSocketProfileName);
+    exit(1);
+  }
+
   // Ignore SIGPIPE.
   signal(SIGPIPE, SIG_IGN);
 
@@ -82,15 +134,60 @@ void Server::start() {
   // Start the connection workers.
   _connection_workers_lock.lock();
 
- unsigned int numWorkerThreads = config().get<int>("worker_threads") == 0 ? std::thread::hardware_concurrency() : config().get<int>("worker_threads");
+  // Size the worker pool after the CPUs we may actually use, honouring
+  // the affinity mask and the cgroup CPU quota of containers.
+  unsigned int numWorkerThreads = config().get<int>("worker_threads") == 0 ? CpuTopology::getDefaultWorkerCount() : config().get<int>("worker_threads");
+  const int redisThreadCpu      = config().get<int>("redis_thread_cpu");
+  auto workerCpus               = CpuTopology::getAllowedCpus();
+
+  // Keep the Redis ingest thread's CPU to itself if there are CPUs to spare.
+  if (redisThreadCpu >= 0 && workerCpus.size() > 1) {
+    workerCpus.erase(std::remove(workerCpus.begin(), workerCpus.end(), redisThreadCpu), workerCpus.end());
+  }
+
+  // CPU each worker, and with it each socket of the SO_REUSEPORT groups, is pinned to.
+  std::vector<int> socketCpus;
 
   for (unsigned i = 0; i < numWorkerThreads; i++) {
-    _connection_workers.addWorker(std::make_unique<Worker>(this, i + 1));
+    const int cpu = config().get<bool>("pin_workers") ? workerCpus[i % workerCpus.size()] : -1;
+    _connection_workers.addWorker(std::make_unique<Worker>(this, i + 1, cpu));
+    socketCpus.push_back(cpu);
+  }
+
+  // The program applies to the whole SO_REUSEPORT group, attach it once per port.
+  if (config().get<bool>("reuseport_listeners") && config().get<bool>("reuseport_cpu_steering")) {
+    auto& firstWorker = _connection_workers.getWorkerList().front();
+
+    if (!config().get<bool>("pin_workers")) {
+      LOG->warn("reuseport_cpu_steering needs pin_workers, connections are not steered.");
+    } else {
+      if (firstWorker->getListenSocket() != -1) {
+        _attachReusePortSteering(firstWorker->getListenSocket(), socketCpus);
+      }
+
+      if (firstWorker->getSSLListenSocket() != -1) {
+        _attachReusePortSteering(firstWorker->getSSLListenSocket(), socketCpus);
+      }
+    }
+  }
+
+  if (ioBackend == "io_uring" && !_connection_workers.getWorkerList().front()->usesIoUring()) {
+    LOG->warn("io_uring is not available on this system, connection workers use epoll.");
   }
 
-  _cur_worker = _connection_workers.begin();
   _connection_workers_lock.unlock();
 
+  // Hand off messages from Redis to the workers in batches, so that each worker
+  // gets one job and one eventfd wakeup per batch instead of per message.
+  const auto batchSize    = std::max(1, config().get<int>("publish_batch_size"));
+  const auto batchLatency = std::max(0, config().get<int>("publish_batch_latency_us"));
+
+  _publish_batcher = std::make_unique<PublishBatcher>(batchSize, std::chrono::microseconds(batchLatency), [&](PublishBatchPtr batch) {
+    _publishBatch(batch);
+  });
+
+  _publish_batcher->start();
+
   // Set up cronjob handler thread.
   auto cronJobs = std::thread([&]() {
     while (!stopEventhub) {
@@ -111,6 +208,9 @@ void Server::start() {
   });
 
   _metrics.worker_count          = numWorkerThreads;
+  _metrics.allowed_cpu_count     = CpuTopology::getAllowedCpus().size();
+  _metrics.cpu_quota_millis      = CpuTopology::getCpuQuotaMillis();
+  _metrics.numa_node_count       = CpuTopology::getNumaNodeCount();
   _metrics.server_start_unixtime = Util::getTimeSinceEpoch();
 
   RedisMsgCallback cb = [&](const std::string& pattern, const std::string& topic, const std::string& msg) {
@@ -161,6 +261,20 @@ void Server::start() {
       },
       true);
 
+  // Exchange what the node-local rate limit buckets consumed with the other nodes.
+  if (_local_rate_limiter) {
+    _ev.addTimer(config().get<int>("rate_limit_sync_interval_ms"), [&](TimerCtx* ctx) {
+      _local_rate_limiter->sync(_redis);
+    }, true);
+  }
+
+  // Move connections away from overloaded workers.
+  if (config().get<int>("rebalance_interval") > 0) {
+    _ev.addTimer(1000 * config().get<int>("rebalance_interval"), [&](TimerCtx* ctx) {
+      _rebalanceWorkers();
+    }, true);
+  }
+
   // Monitor ssl certificate and key for changes on disk and reload if updated.
   if (isSSL() && config().get<bool>("ssl_cert_auto_reload")) {
     _ev.addTimer(1000 * config().get<int>("ssl_cert_check_interval"), [&](TimerCtx* ctx) {
@@ -168,6 +282,16 @@ void Server::start() {
     }, true);
   }
 
+  // This thread consumes Redis from here on. Pin it only now so that the
+  // threads started above don't inherit its affinity.
+  if (redisThreadCpu >= 0) {
+    if (CpuTopology::pinCurrentThread(redisThreadCpu)) {
+      LOG->info("Pinned Redis ingest thread to CPU {}.", redisThreadCpu);
+    } else {
+      LOG->warn("Could not pin Redis ingest thread to CPU {}.", redisThreadCpu);
+    }
+  }
+
   bool reconnect = false;
   while (!stopEventhub) {
     try {
@@ -218,75 +342,114 @@ int alpn_cb(SSL* ssl, const unsigned char** out, unsigned char* outlen,
   return SSL_TLSEXT_ERR_NOACK;
 }
 
-void Server::_listenerInit() {
-  // Set up listening socket.
-  _server_socket = socket(AF_INET, SOCK_STREAM, 0);
-  if (_server_socket == -1) {
+/**
+ * Create a non-blocking listening socket bound to port.
+ * @param port Port to listen on.
+ * @param reusePort Set SO_REUSEPORT so several sockets can share the port.
+ */
+int Server::openListenSocket(int port, bool reusePort) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
     LOG->critical("Could not create server socket: {}.", strerror(errno));
     exit(1);
   }
 
   // Reuse port and address.
   int on = 1;
-  setsockopt(_server_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+  if (reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&on, sizeof(on)) == -1) {
+    LOG->critical("Could not set SO_REUSEPORT on server socket: {}.", strerror(errno));
+    exit(1);
+  }
 
   // Bind socket.
   struct sockaddr_in sin;
   memset(reinterpret_cast<char*>(&sin), '\0', sizeof(sin));
   sin.sin_family = AF_INET;
-  sin.sin_port   = htons(config().get<int>("listen_port"));
+  sin.sin_port   = htons(port);
 
-  if (::bind(_server_socket, (struct sockaddr*)&sin, sizeof(sin)) == -1) {
-    LOG->critical("Could not bind server socket to port {}: {}.", config().get<int>("listen_port"), strerror(errno));
+  if (::bind(fd, (struct sockaddr*)&sin, sizeof(sin)) == -1) {
+    LOG->critical("Could not bind server socket to port {}: {}.", port, strerror(errno));
     exit(1);
   }
 
   // Use a reasonable backlog size to reduce dropped connections during bursts.
-  if (listen(_server_socket, SOMAXCONN) == -1) {
+  if (listen(fd, SOMAXCONN) == -1) {
     LOG->critical("Could not listen on server socket: {}", strerror(errno));
     exit(1);
   }
 
-  if (fcntl(_server_socket, F_SETFL, O_NONBLOCK) == -1) {
+  if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
     LOG->critical("Failed set nonblock mode on server socket: {}.", strerror(errno));
     exit(1);
   }
 
+  return fd;
+}
+
+void Server::_listenerInit() {
+  // With reuseport_listeners every worker opens its own socket.
+  if (!config().get<bool>("reuseport_listeners")) {
+    _server_socket = openListenSocket(config().get<int>("listen_port"), false);
+  }
+
   LOG->info("Listening on port {}.", config().get<int>("listen_port"));
 }
 
 void Server::_sslListenerInit() {
-  _server_socket_ssl = socket(AF_INET, SOCK_STREAM, 0);
-  if (_server_socket_ssl == -1) {
-    LOG->critical("Could not create SSL server socket: {}.", strerror(errno));
-    exit(1);
+  if (!config().get<bool>("reuseport_listeners")) {
+    _server_socket_ssl = openListenSocket(config().get<int>("ssl_listen_port"), false);
   }
 
-  int on = 1;
-  setsockopt(_server_socket_ssl, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+  LOG->info("Listening for SSL connections on port {}.", config().get<int>("ssl_listen_port"));
+}
 
-  struct sockaddr_in sin;
-  memset(reinterpret_cast<char*>(&sin), '\0', sizeof(sin));
-  sin.sin_family = AF_INET;
-  sin.sin_port   = htons(config().get<int>("ssl_listen_port"));
+/**
+ * Steer new connections to the listening socket of the worker pinned to the
+ * CPU that handled the incoming packet. Packets handled by a CPU no worker
+ * is pinned to are spread over the sockets by CPU number.
+ * @param listenSocket Any socket in the SO_REUSEPORT group.
+ * @param socketCpus CPU the worker of each socket in the group is pinned to,
+ *                   in the order the sockets joined the group.
+ */
+void Server::_attachReusePortSteering(int listenSocket, const std::vector<int>& socketCpus) {
+  std::vector<struct sock_filter> code;
+
+  // A = raw_smp_processor_id()
+  code.push_back({ BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) });
+
+  // Jump table: if A == cpu return the index of the first socket on it.
+  std::vector<int> seen;
+  for (std::size_t i = 0; i < socketCpus.size(); i++) {
+    if (socketCpus[i] < 0 || std::find(seen.begin(), seen.end(), socketCpus[i]) != seen.end()) {
+      continue;
+    }
 
-  if (::bind(_server_socket_ssl, (struct sockaddr*)&sin, sizeof(sin)) == -1) {
-    LOG->critical("Could not bind server socket to port {}: {}.", config().get<int>("ssl_listen_port"), strerror(errno));
-    exit(1);
+    seen.push_back(socketCpus[i]);
+    code.push_back({ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(socketCpus[i]) });
+    code.push_back({ BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(i) });
   }
 
-  // Use a reasonable backlog size to reduce dropped connections during bursts.
-  if (listen(_server_socket_ssl, SOMAXCONN) == -1) {
-    LOG->critical("Could not listen on server socket: {}", strerror(errno));
-    exit(1);
+  // Unknown CPU: return A % number of sockets.
+  code.push_back({ BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(socketCpus.size()) });
+  code.push_back({ BPF_RET | BPF_A, 0, 0, 0 });
+
+  if (code.size() > BPF_MAXINSNS) {
+    LOG->warn("Too many CPUs for the SO_REUSEPORT CPU steering program, connections are not steered.");
+    return;
   }
 
-  if (fcntl(_server_socket_ssl, F_SETFL, O_NONBLOCK) == -1) {
-    LOG->critical("Failed set nonblock mode on server socket: {}.", strerror(errno));
-    exit(1);
+  struct sock_fprog prog;
+  prog.len    = static_cast<unsigned short>(code.size());
+  prog.filter = code.data();
+
+  if (setsockopt(listenSocket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == -1) {
+    LOG->warn("Could not attach SO_REUSEPORT CPU steering program: {}.", strerror(errno));
+    return;
   }
 
-  LOG->info("Listening for SSL connections on port {}.", config().get<int>("ssl_listen_port"));
+  LOG->debug("Attached SO_REUSEPORT CPU steering program for {} sockets on {} CPUs.", socketCpus.size(), seen.size());
 }
 
 void Server::_initSSL() {
@@ -401,23 +564,98 @@ void Server::_checkSSLCertUpdated() {
   }
 }
 
+/**
+ * Pick the least loaded worker for a new connection.
+ */
 Worker* Server::getWorker() {
   std::lock_guard<std::mutex> lock(_connection_workers_lock);
-  if (_cur_worker == _connection_workers.end()) {
-    _cur_worker = _connection_workers.begin();
+  Worker* selected  = nullptr;
+  uint64_t minLoad  = 0;
+
+  for (auto& worker : _connection_workers) {
+    const auto load = worker->getLoad();
+
+    if (selected == nullptr || load < minLoad) {
+      selected = worker.get();
+      minLoad  = load;
+    }
+  }
+
+  return selected;
+}
+
+/**
+ * Move connections from the most to the least loaded worker when their load
+ * differs by more than rebalance_threshold percent.
+ */
+void Server::_rebalanceWorkers() {
+  std::lock_guard<std::mutex> lock(_connection_workers_lock);
+  Worker* busiest = nullptr;
+  Worker* idlest  = nullptr;
+  uint64_t maxLoad = 0;
+  uint64_t minLoad = 0;
+
+  for (auto& worker : _connection_workers) {
+    const auto load = worker->getLoad();
+
+    if (busiest == nullptr || load > maxLoad) {
+      busiest = worker.get();
+      maxLoad = load;
+    }
+
+    if (idlest == nullptr || load < minLoad) {
+      idlest  = worker.get();
+      minLoad = load;
+    }
+  }
+
+  if (busiest == idlest || maxLoad * 100 <= minLoad * (100 + config().get<int>("rebalance_threshold"))) {
+    return;
+  }
+
+  // Move enough connections to even out the load, estimating each connection
+  // to carry its share of the busiest worker's load.
+  const auto connections = std::max(1UL, busiest->getMetrics().current_connections_count.load());
+  const auto loadPerConn = std::max<uint64_t>(1, maxLoad / connections);
+  const auto count       = std::min<uint64_t>((maxLoad - minLoad) / 2 / loadPerConn, config().get<int>("rebalance_max_migrations"));
+
+  if (count == 0) {
+    return;
   }
 
-  return (_cur_worker++)->get();
+  LOG->debug("Rebalancing: moving up to {} connections from worker {} (load {}) to worker {} (load {}).",
+             count, busiest->getWorkerId(), maxLoad, idlest->getWorkerId(), minLoad);
+
+  busiest->migrateConnections(idlest, count);
 }
 
 void Server::publish(const std::string& topicName, const std::string& data) {
+  // Intern once here, workers match and look up topics by ID from now on.
+  InternedTopic topic(topicName);
+
+  if (_publish_batcher) {
+    _publish_batcher->add(topic, data);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_connection_workers_lock);
+  for (auto& worker : _connection_workers.getWorkerList()) {
+    worker->publish(topic, data);
+  }
+}
+
+void Server::_publishBatch(PublishBatchPtr batch) {
   std::lock_guard<std::mutex> lock(_connection_workers_lock);
   for (auto& worker : _connection_workers.getWorkerList()) {
-    worker->publish(topicName, data);
+    worker->publishBatch(batch);
   }
 }
 
 void Server::stop() {
+  if (_publish_batcher) {
+    _publish_batcher->stop();
+  }
+
   close(_server_socket);
 
   if (isSSL())
@@ -427,6 +665,50 @@ void Server::stop() {
   _ssl_ctx.reset();
 }
 
+/**
+ * Count a publish against a rate limit and tell if it is allowed, in
+ * Redis or in the node-local buckets depending on rate_limit_mode.
+ * @param topic Rate limit pattern.
+ */
+RateLimitResult Server::checkRateLimit(const std::string& topic, const std::string& subject, unsigned long interval, unsigned long max) {
+  if (_local_rate_limiter) {
+    return _local_rate_limiter->check(topic, subject, interval, max);
+  }
+
+  return _redis.checkRateLimit(topic, subject, interval, max);
+}
+
+/**
+ * Count a publish refused by a rate limit.
+ * @param pattern Rate limit pattern that refused it.
+ */
+void Server::countRateLimited(const std::string& pattern) {
+  _metrics.rate_limited_count++;
+
+  std::lock_guard<std::mutex> lock(_rate_limited_lock);
+  auto it = _rate_limited_patterns.find(pattern);
+
+  if (it != _rate_limited_patterns.end()) {
+    it->second++;
+  } else if (_rate_limited_patterns.size() < RATE_LIMIT_METRIC_MAX_PATTERNS) {
+    _rate_limited_patterns.emplace(pattern, 1);
+  }
+}
+
+/**
+ * Bytes waiting to be sent to clients, summed over all workers.
+ */
+std::size_t Server::getOutputBytes() {
+  std::lock_guard<std::mutex> lock(_connection_workers_lock);
+  std::size_t bytes = 0;
+
+  for (auto& wrk : _connection_workers) {
+    bytes += wrk->getMetrics().output_bytes.load(std::memory_order_relaxed);
+  }
+
+  return bytes;
+}
+
 metrics::AggregatedMetrics Server::getAggregatedMetrics() {
   std::lock_guard<std::mutex> lock(_connection_workers_lock);
   metrics::AggregatedMetrics m;
@@ -436,6 +718,18 @@ metrics::AggregatedMetrics Server::getAggregatedMetrics() {
   m.server_start_unixtime       = _metrics.server_start_unixtime.load();
   m.publish_count               = _metrics.publish_count.load();
   m.redis_connection_fail_count = _metrics.redis_connection_fail_count.load();
+  m.allowed_cpu_count           = _metrics.allowed_cpu_count.load();
+  m.cpu_quota_millis            = _metrics.cpu_quota_millis.load();
+  m.numa_node_count             = _metrics.numa_node_count.load();
+  m.jwt_cache_hits              = _token_cache.getHitCount();
+  m.jwt_cache_misses            = _token_cache.getMissCount();
+  m.jwt_cache_size              = _token_cache.size();
+  m.rate_limited_count          = _metrics.rate_limited_count.load();
+
+  {
+    std::lock_guard<std::mutex> rateLimitedLock(_rate_limited_lock);
+    m.rate_limited_patterns.assign(_rate_limited_patterns.begin(), _rate_limited_patterns.end());
+  }
 
   for (auto& wrk : _connection_workers) {
     const auto& wrkM = wrk->getMetrics();
@@ -443,6 +737,28 @@ metrics::AggregatedMetrics Server::getAggregatedMetrics() {
     m.total_connect_count += wrkM.total_connect_count.load();
     m.total_disconnect_count += wrkM.total_disconnect_count.load();
     m.eventloop_delay_ms += wrkM.eventloop_delay_ms.load();
+    m.eventloop_delay_max_ms = std::max(m.eventloop_delay_max_ms, wrkM.eventloop_delay_ms.load());
+    m.current_subscription_count += wrk->getTopicManager()->getSubscriptionCount();
+    m.total_migrated_count += wrkM.total_migrated_count.load();
+    m.pinned_worker_count += wrkM.pinned.load() ? 1 : 0;
+    m.slow_consumer_dropped_count += wrkM.slow_consumer_dropped_count.load();
+    m.slow_consumer_conflated_count += wrkM.slow_consumer_conflated_count.load();
+    m.slow_consumer_disconnect_count += wrkM.slow_consumer_disconnect_count.load();
+    m.slow_consumer_resume_count += wrkM.slow_consumer_resume_count.load();
+    m.output_bytes += wrkM.output_bytes.load();
+    m.worker_output_bytes.push_back(wrkM.output_bytes.load());
+    m.output_budget_shed_count += wrkM.output_budget_shed_count.load();
+
+    for (const auto& topic : wrk->getSlowConsumerTopicMetrics()) {
+      auto& total = m.slow_consumer_topics[topic.first];
+      total.dropped += topic.second.dropped;
+      total.conflated += topic.second.conflated;
+    }
+
+    const auto poolStats = wrk->getConnectionPools().getStats();
+    m.pool_blocks_in_use += poolStats.blocks_in_use;
+    m.pool_blocks_free += poolStats.blocks_free;
+    m.pool_bytes += poolStats.bytes;
   }
 
   const auto workerCount = _connection_workers.getWorkerList().size();
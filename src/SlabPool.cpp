@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "SlabPool.hpp"
+#include "Common.hpp"
+
+namespace eventhub {
+namespace {
+// Blocks start after the slab header and keep the alignment of malloc().
+constexpr std::size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+constexpr std::size_t alignUp(std::size_t size) {
+  return (size + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+}
+} // namespace
+
+SlabPool::SlabPool(const std::string& name) :
+  _name(name), _block_size(0), _blocks_per_slab(0), _slabs(nullptr), _free(nullptr),
+  _remote_free(nullptr), _refs(1), _slab_count(0), _capacity(0) {}
+
+SlabPool::~SlabPool() {
+  while (_slabs != nullptr) {
+    Slab* next = _slabs->next;
+    free(_slabs);
+    _slabs = next;
+  }
+}
+
+/**
+ * Get a block of at least size bytes. Only called by the owner thread.
+ * Throws std::length_error if size is larger than the pool's block size.
+ */
+void* SlabPool::allocate(std::size_t size) {
+  ASSERT_OWNER_THREAD(_owner);
+
+  if (_block_size == 0) {
+    if (size > SLAB_POOL_SLAB_SIZE - alignUp(sizeof(Slab))) {
+      throw std::length_error{"Block of " + std::to_string(size) + " bytes does not fit in a slab of pool " + _name};
+    }
+
+    _block_size      = alignUp(std::max(size, sizeof(FreeBlock)));
+    _blocks_per_slab = (SLAB_POOL_SLAB_SIZE - alignUp(sizeof(Slab))) / _block_size;
+  }
+
+  // The block size is fixed by the first allocation. Handing out a block
+  // too small for the object would corrupt its neighbour.
+  if (size > _block_size) {
+    throw std::length_error{"Block of " + std::to_string(size) + " bytes requested from pool " + _name + " of " +
+                            std::to_string(_block_size) + " byte blocks"};
+  }
+
+  if (_free == nullptr) {
+    _free = _remote_free.exchange(nullptr, std::memory_order_acquire);
+
+    if (_free == nullptr) {
+      _addSlab();
+    }
+  }
+
+  FreeBlock* block = _free;
+  _free            = block->next;
+  _refs.fetch_add(1, std::memory_order_relaxed);
+
+  return block;
+}
+
+/**
+ * Return a block to the pool it came from. Safe to call from any thread.
+ */
+void SlabPool::deallocate(void* block) {
+  auto slab      = reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(block) & ~(uintptr_t(SLAB_POOL_SLAB_SIZE) - 1));
+  auto pool      = slab->pool;
+  auto freeBlock = static_cast<FreeBlock*>(block);
+
+  if (pool->_owner.isBoundToCurrentThread()) {
+    freeBlock->next = pool->_free;
+    pool->_free     = freeBlock;
+  } else {
+    FreeBlock* head = pool->_remote_free.load(std::memory_order_relaxed);
+    do {
+      freeBlock->next = head;
+    } while (!pool->_remote_free.compare_exchange_weak(head, freeBlock, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  if (pool->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete pool;
+  }
+}
+
+/**
+ * Give up the pool. It is deleted right away, or when the last block still
+ * in use is returned.
+ */
+void SlabPool::orphan() {
+  if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+SlabPoolStats SlabPool::getStats() const {
+  SlabPoolStats stats;
+  const std::size_t capacity = _capacity.load(std::memory_order_relaxed);
+
+  stats.blocks_in_use = _refs.load(std::memory_order_relaxed) - 1;
+  stats.blocks_free   = capacity - std::min(stats.blocks_in_use, capacity);
+  stats.bytes         = _slab_count.load(std::memory_order_relaxed) * SLAB_POOL_SLAB_SIZE;
+
+  return stats;
+}
+
+void SlabPool::_addSlab() {
+  void* memory = aligned_alloc(SLAB_POOL_SLAB_SIZE, SLAB_POOL_SLAB_SIZE);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  auto slab  = static_cast<Slab*>(memory);
+  slab->pool = this;
+  slab->next = _slabs;
+  _slabs     = slab;
+
+  char* blocks = static_cast<char*>(memory) + alignUp(sizeof(Slab));
+  for (std::size_t i = _blocks_per_slab; i > 0; i--) {
+    auto block  = reinterpret_cast<FreeBlock*>(blocks + (i - 1) * _block_size);
+    block->next = _free;
+    _free       = block;
+  }
+
+  _slab_count.fetch_add(1, std::memory_order_relaxed);
+  _capacity.fetch_add(_blocks_per_slab, std::memory_order_relaxed);
+}
+
+} // namespace eventhub
@@ -0,0 +1,115 @@
+#include <openssl/evp.h>
+#include <stdint.h>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "TokenCache.hpp"
+#include "AccessController.hpp"
+
+namespace eventhub {
+
+/**
+ * @param capacity Max number of tokens to keep, 0 disables the cache.
+ */
+TokenCache::TokenCache(std::size_t capacity) :
+  _shard_capacity(capacity == 0 ? 0 : (capacity + TOKEN_CACHE_SHARDS - 1) / TOKEN_CACHE_SHARDS) {}
+
+/**
+ * Digest of a token and the secret it is verified with.
+ */
+TokenCache::Digest TokenCache::digest(const std::string& token, const std::string& secret) {
+  std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+  const uint64_t secretLength = secret.length();
+  Digest digest;
+
+  if (!ctx ||
+      EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr) != 1 ||
+      EVP_DigestUpdate(ctx.get(), &secretLength, sizeof(secretLength)) != 1 ||
+      EVP_DigestUpdate(ctx.get(), secret.data(), secret.length()) != 1 ||
+      EVP_DigestUpdate(ctx.get(), token.data(), token.length()) != 1 ||
+      EVP_DigestFinal_ex(ctx.get(), digest.data(), nullptr) != 1) {
+    throw std::runtime_error("TokenCache: failed to digest token");
+  }
+
+  return digest;
+}
+
+/**
+ * Look up a verified token.
+ * @returns The permissions of the token, or nullptr if it is not cached or
+ *          has expired.
+ */
+TokenPermissionsPtr TokenCache::get(const Digest& digest) {
+  if (!isEnabled()) {
+    return nullptr;
+  }
+
+  auto& shard = _getShard(digest);
+  std::lock_guard<std::mutex> lock(shard.lock);
+
+  auto it = shard.index.find(digest);
+  if (it == shard.index.end()) {
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  const auto& permissions = it->second->second;
+  if (permissions->expires != 0 && permissions->expires <= std::time(nullptr)) {
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  _hits.fetch_add(1, std::memory_order_relaxed);
+
+  return permissions;
+}
+
+/**
+ * Add a verified token.
+ */
+void TokenCache::put(const Digest& digest, TokenPermissionsPtr permissions) {
+  if (!isEnabled()) {
+    return;
+  }
+
+  auto& shard = _getShard(digest);
+  std::lock_guard<std::mutex> lock(shard.lock);
+
+  auto it = shard.index.find(digest);
+  if (it != shard.index.end()) {
+    it->second->second = std::move(permissions);
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+
+  if (shard.lru.size() >= _shard_capacity) {
+    shard.index.erase(shard.lru.back().first);
+    shard.lru.pop_back();
+  }
+
+  shard.lru.emplace_front(digest, std::move(permissions));
+  shard.index.emplace(digest, shard.lru.begin());
+}
+
+/**
+ * Number of tokens in the cache.
+ */
+std::size_t TokenCache::size() {
+  std::size_t count = 0;
+
+  for (auto& shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    count += shard.lru.size();
+  }
+
+  return count;
+}
+
+} // namespace eventhub
@@ -22,62 +22,184 @@ Topic::~Topic() {}
  * Add a subscriber to this Topic.
  * @param conn Connection to add.
  * @param subscriptionRequestId ID from JSONRPC call to publish().
+ * @returns Handle to remove the subscriber with.
  */
-TopicSubscriberList::iterator Topic::addSubscriber(ConnectionPtr conn, const jsonrpcpp::Id subscriptionRequestId) {
-  std::lock_guard<std::mutex> lock(_subscriber_lock);
-  return _subscriber_list.insert(_subscriber_list.begin(), std::make_pair(ConnectionWeakPtr(conn), subscriptionRequestId));
+TopicSubscriberHandle Topic::addSubscriber(Connection* conn, const jsonrpcpp::Id& subscriptionRequestId) {
+  TopicSubscriberHandle handle;
+
+  if (!_free_handles.empty()) {
+    handle = _free_handles.back();
+    _free_handles.pop_back();
+  } else {
+    handle = static_cast<TopicSubscriberHandle>(_handle_slots.size());
+    _handle_slots.push_back(0);
+  }
+
+  _handle_slots[handle] = static_cast<uint32_t>(_subscribers.size());
+  _subscribers.push_back(TopicSubscriber{conn, renderRpcId(subscriptionRequestId), handle});
+
+  return handle;
 }
 
 /**
- * Publish a message to this topic.
- * @param data Message to publish.
+ * Delete a subscriber.
+ * @param handle Handle returned by addSubscriber().
  */
-void Topic::publish(const std::string& data) {
-  std::lock_guard<std::mutex> lock(_subscriber_lock);
-  nlohmann::json jsonData;
+void Topic::deleteSubscriber(TopicSubscriberHandle handle) {
+  const std::size_t slot = _handle_slots[handle];
+  const std::size_t last = _subscribers.size() - 1;
 
-  try {
-    jsonData = nlohmann::json::parse(data);
+  // During a publish, [0, _publish_cursor) holds the subscribers that already
+  // have the message. Refill the hole from the end of that range and the end
+  // of the range from the back, so nobody gets the message twice or never.
+  if (_publish_message && slot < _publish_cursor) {
+    const std::size_t lastDelivered = _publish_cursor - 1;
 
-    for (auto subscriber : _subscriber_list) {
-      auto c = subscriber.first.lock();
+    _moveSubscriber(lastDelivered, slot);
+    _moveSubscriber(last, lastDelivered);
+    _publish_cursor--;
+  } else {
+    _moveSubscriber(last, slot);
+  }
 
-      if (!c || c->isShutdown()) {
-        continue;
-      }
+  _subscribers.pop_back();
+  _free_handles.push_back(handle);
+}
 
-      if (c->getState() == ConnectionState::WEBSOCKET) {
-        websocket::Response::sendData(c,
-                                      jsonrpcpp::Response(subscriber.second, jsonData).to_json().dump(),
-                                      websocket::FrameType::TEXT_FRAME);
-      } else if (c->getState() == ConnectionState::SSE) {
-        sse::Response::sendEvent(c, jsonData["id"], jsonData["message"]);
-      }
-    }
+void Topic::_moveSubscriber(std::size_t from, std::size_t to) {
+  if (from == to) {
+    return;
   }
 
-  catch (std::exception& e) {
-    LOG->debug("Invalid publish to {}: {}.", _id, e.what());
+  _subscribers[to]                       = std::move(_subscribers[from]);
+  _handle_slots[_subscribers[to].handle] = static_cast<uint32_t>(to);
+}
+
+/**
+ * Start delivering a message to the subscribers of this topic.
+ * Delivery is done by continuePublish(), a topic only has one message in flight.
+ * @param message Parsed message to publish.
+ * @param seq Sequence number of the message, 0 if unknown.
+ * @param publishTopic Topic the message was published to.
+ */
+void Topic::beginPublish(TopicMessagePtr message, uint64_t seq, const InternedTopic& publishTopic) {
+  _publish_message = message;
+  _publish_topic   = publishTopic;
+  _publish_seq     = seq;
+  _publish_cursor  = 0;
+
+  // Rendered once for all websocket subscribers.
+  _publish_rendered = message->dump();
+}
+
+/**
+ * Check if a subscriber already has the message being published.
+ * @param handle Handle returned by addSubscriber().
+ */
+bool Topic::hasDelivered(TopicSubscriberHandle handle) const {
+  return _publish_message && _handle_slots[handle] < _publish_cursor;
+}
+
+/**
+ * Render a JSONRPC ID the way it appears in a response.
+ */
+std::string Topic::renderRpcId(const jsonrpcpp::Id& subscriptionRequestId) {
+  return subscriptionRequestId.to_json().dump();
+}
+
+/**
+ * Send a message to a single subscriber.
+ * @param conn Connection to send to.
+ * @param rpcId ID from the JSONRPC subscribe call, rendered by renderRpcId().
+ * @param message Parsed message.
+ * @param renderedMessage message rendered as JSON.
+ * @param publishTopic Topic the message was published to. Messages without
+ *                     one bypass the slow consumer policy of the connection.
+ */
+void Topic::deliver(Connection* conn, const std::string& rpcId, const nlohmann::json& message, const std::string& renderedMessage, const InternedTopic& publishTopic) {
+  struct MessageGuard {
+    Connection* conn;
+    ~MessageGuard() { conn->endMessage(); }
+  };
+
+  if (!publishTopic.empty() && !conn->beginMessage(publishTopic, rpcId)) {
     return;
   }
+
+  MessageGuard guard{conn};
+
+  if (conn->getState() == ConnectionState::WEBSOCKET) {
+    // Same output as jsonrpcpp::Response(id, message).to_json().dump(),
+    // without building a JSON object per subscriber.
+    std::string response;
+    response.reserve(rpcId.length() + renderedMessage.length() + 32);
+    response.append("{\"id\":").append(rpcId).append(",\"jsonrpc\":\"2.0\",\"result\":").append(renderedMessage).append("}");
+
+    websocket::Response::sendData(conn, response, websocket::FrameType::TEXT_FRAME);
+  } else if (conn->getState() == ConnectionState::SSE) {
+    sse::Response::sendEvent(conn, message.at("id"), message.at("message"));
+  }
 }
 
 /**
- * Delete a subscriber.
- * @param it Iterator pointing to the subscriber to be deleted.
- *           This is obtained by call to addSubscriber.
+ * Send a message to a single subscriber.
+ * @param conn Connection to send to.
+ * @param subscriptionRequestId ID from the JSONRPC subscribe call.
+ * @param message Parsed message.
+ * @param publishTopic Topic the message was published to.
  */
-void Topic::deleteSubscriberByIterator(TopicSubscriberList::iterator it) {
-  std::lock_guard<std::mutex> lock(_subscriber_lock);
-  _subscriber_list.erase(it);
+void Topic::deliver(ConnectionPtr conn, const jsonrpcpp::Id& subscriptionRequestId, const nlohmann::json& message, const InternedTopic& publishTopic) {
+  deliver(conn.get(), renderRpcId(subscriptionRequestId), message, message.dump(), publishTopic);
 }
 
 /**
- * Returns the number of subscribers on the topic.
+ * Deliver the message started by beginPublish() to as many subscribers as
+ * the budget allows.
+ * @param budget Fan-out budget for the current event loop iteration.
+ * @returns true when every subscriber has received the message.
  */
-std::size_t Topic::getSubscriberCount() {
-  std::lock_guard<std::mutex> lock(_subscriber_lock);
-  return _subscriber_list.size();
+bool Topic::continuePublish(FanoutBudget& budget) {
+  if (!_publish_message) {
+    return true;
+  }
+
+  const auto& jsonData = *_publish_message;
+
+  try {
+    // A delivery can't unsubscribe anyone, connections are only shut down
+    // here and removed by the worker later, so the vector stays put.
+    while (_publish_cursor < _subscribers.size()) {
+      if (budget.exhausted()) {
+        return false;
+      }
+
+      const auto& subscriber = _subscribers[_publish_cursor];
+      _publish_cursor++;
+
+      auto c = subscriber.conn;
+
+      if (c->isShutdown()) {
+        continue;
+      }
+
+      // Connection migrated from a worker that had already delivered this message.
+      if (_publish_seq != 0 && _publish_seq <= c->getSkipPublishSeq()) {
+        continue;
+      }
+
+      deliver(c, subscriber.rpc_id, jsonData, _publish_rendered, _publish_topic);
+      budget.consume();
+    }
+  }
+
+  catch (std::exception& e) {
+    LOG->debug("Invalid publish to {}: {}.", _name.name(), e.what());
+  }
+
+  _publish_message.reset();
+  _publish_topic    = InternedTopic();
+  _publish_rendered = std::string();
+  return true;
 }
 
 } // namespace eventhub
@@ -1,81 +1,204 @@
 #include <ctype.h>
 #include <spdlog/logger.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
-#include <list>
 #include <string_view>
 #include <vector>
 
 #include "TopicManager.hpp"
 #include "Topic.hpp"
+#include "TopicMatcher.hpp"
 #include "Logger.hpp"
 
 namespace eventhub {
-namespace {
-std::vector<std::string_view> splitLevels(const std::string& input) {
-  std::vector<std::string_view> parts;
-  std::size_t start = 0;
-
-  for (std::size_t i = 0; i <= input.size(); ++i) {
-    if (i == input.size() || input[i] == '/') {
-      parts.emplace_back(input.data() + start, i - start);
-      start = i + 1;
-    }
-  }
 
-  return parts;
-}
-} // namespace
 /*
 * Subscribe a client to a topic.
 * @param conn Client to subscribe.
 * @param topicFilter Topic or filter name.
 * @param subscriptionRequestId JSONRPC ID for request.
 */
-std::pair<TopicPtr, TopicSubscriberList::iterator> TopicManager::subscribeConnection(ConnectionPtr conn, const std::string& topicFilter, const jsonrpcpp::Id subscriptionRequestId) {
-  std::lock_guard<std::mutex> lock(_topic_list_lock);
+std::pair<TopicPtr, TopicSubscriberHandle> TopicManager::subscribeConnection(ConnectionPtr conn, const InternedTopic& topicFilter, const jsonrpcpp::Id subscriptionRequestId) {
+  ASSERT_OWNER_THREAD(_owner);
 
-  auto it = _topic_list.find(topicFilter);
-  if (it == _topic_list.end()) {
-    it = _topic_list.emplace(topicFilter, std::make_shared<Topic>(topicFilter)).first;
+  auto& list = isValidTopicFilter(topicFilter.name()) ? _filter_list : _topic_list;
+  auto it    = list.find(topicFilter.id());
+  if (it == list.end()) {
+    it = list.emplace(topicFilter.id(), std::make_shared<Topic>(topicFilter)).first;
   }
 
-  auto subIt = it->second->addSubscriber(conn, subscriptionRequestId);
+  auto handle = it->second->addSubscriber(conn.get(), subscriptionRequestId);
+  _subscription_count++;
+
+  return std::make_pair(it->second, handle);
+}
+
+/*
+* Remove a subscription made by subscribeConnection, deleting the topic if it was the last subscriber.
+* @param subscription Subscription to remove.
+*/
+void TopicManager::unsubscribeConnection(TopicSubscription& subscription) {
+  ASSERT_OWNER_THREAD(_owner);
+
+  subscription.topic->deleteSubscriber(subscription.handle);
+  _subscription_count--;
 
-  return std::make_pair(it->second, subIt);
+  if (subscription.topic->getSubscriberCount() == 0) {
+    deleteTopic(subscription.topic->getName());
+  }
 }
 
 /*
 * Publish to a topic.
-* @param topicName topic to publish to.
+* The message is queued for every matching topic and delivered by processFanout().
+* @param topic topic to publish to.
 * @param data message to publish.
+* @param seq sequence number of the message, 0 if unknown.
+*/
+void TopicManager::publish(const InternedTopic& topic, const std::string& data, uint64_t seq) {
+  ASSERT_OWNER_THREAD(_owner);
+  TopicMessagePtr message;
+
+  // Parse once, no matter how many topics and filters match.
+  auto enqueue = [&](const TopicPtr& match) {
+    if (!message) {
+      try {
+        message = std::make_shared<const nlohmann::json>(nlohmann::json::parse(data));
+      } catch (std::exception& e) {
+        LOG->debug("Invalid publish to {}: {}.", topic.name(), e.what());
+        return false;
+      }
+    }
+
+    _fanout_queue.push_back(FanoutMessage{match, message, seq, topic});
+    return true;
+  };
+
+  auto exact = _topic_list.find(topic.id());
+  if (exact != _topic_list.end() && !enqueue(exact->second)) {
+    return;
+  }
+
+  for (auto& filter : _filter_list) {
+    if (isFilterMatched(filter.second->getName().name(), topic.name()) && !enqueue(filter.second)) {
+      return;
+    }
+  }
+
+  // The queue is full. Deliver until there is room again, which holds up
+  // the jobs of the worker and with them whoever publishes to it.
+  while (_fanout_queue.size() > FANOUT_QUEUE_MAX_MESSAGES) {
+    FanoutBudget budget(FANOUT_DRAIN_SUBSCRIBERS, std::chrono::microseconds(0));
+    processFanout(budget);
+  }
+}
+
+/*
+* Deliver queued messages until the budget is exhausted.
+* Messages are delivered one at a time in the order they were published. A
+* message reaches all of its subscribers before the next one is started, so
+* a connection receives messages in publish order across all of its
+* subscriptions, even when a large fan-out is spread over several event loop
+* iterations. Messages queued behind a large fan-out wait for it, for at most
+* FANOUT_QUEUE_MAX_MESSAGES messages.
+* @param budget Fan-out budget for this iteration.
+* @returns true if there is more to deliver.
+*/
+bool TopicManager::processFanout(FanoutBudget& budget) {
+  ASSERT_OWNER_THREAD(_owner);
+
+  while (!_fanout_queue.empty() && !budget.exhausted()) {
+    auto& next = _fanout_queue.front();
+
+    if (!_fanout_started) {
+      next.topic->beginPublish(next.message, next.seq, next.publishTopic);
+      _fanout_started = true;
+    }
+
+    if (!next.topic->continuePublish(budget)) {
+      break;
+    }
+
+    _fanout_queue.pop_front();
+    _fanout_started = false;
+  }
+
+  return !_fanout_queue.empty();
+}
+
+/*
+* Index the messages queued for fan-out by topic, for getDeliveredSeq().
+* Messages without a sequence number are left out.
 */
-void TopicManager::publish(const std::string& topicName, const std::string& data) {
-  std::lock_guard<std::mutex> lock(_topic_list_lock);
+PendingFanoutSeqs TopicManager::getPendingFanoutSeqs() {
+  ASSERT_OWNER_THREAD(_owner);
+  PendingFanoutSeqs pending;
+
+  for (const auto& queued : _fanout_queue) {
+    if (queued.seq == 0) {
+      continue;
+    }
 
-  for (auto& topic : _topic_list) {
-    if (isFilterMatched(topic.first, topicName)) {
-      topic.second->publish(data);
+    auto& seqs = pending[queued.topic.get()];
+    if (seqs.first == 0) {
+      seqs.first = queued.seq;
+    } else if (seqs.second == 0) {
+      seqs.second = queued.seq;
     }
   }
+
+  return pending;
+}
+
+/*
+* Sequence number of the last message a subscription has received. Messages
+* are delivered in publish order, so that is the one before the first queued
+* message of its topic that the subscriber doesn't have yet.
+* @param subscription Subscription to check.
+* @param pending Messages queued for fan-out, from getPendingFanoutSeqs().
+* @param lastSeq Sequence number of the last message published to the worker.
+*/
+uint64_t TopicManager::getDeliveredSeq(const TopicSubscription& subscription, const PendingFanoutSeqs& pending, uint64_t lastSeq) {
+  ASSERT_OWNER_THREAD(_owner);
+
+  auto it = pending.find(subscription.topic.get());
+  if (it == pending.end()) {
+    return lastSeq;
+  }
+
+  uint64_t next = it->second.first;
+
+  // The first one may be the message in flight, which the subscriber may have.
+  const auto& inFlight = _fanout_queue.front();
+  if (_fanout_started && inFlight.topic == subscription.topic && inFlight.seq == next && subscription.topic->hasDelivered(subscription.handle)) {
+    next = it->second.second;
+  }
+
+  return next == 0 ? lastSeq : next - 1;
 }
 
 /*
 * Delete a topic.
 * @param topicFilter topic to delete.
 */
-void TopicManager::deleteTopic(const std::string& topicFilter) {
-  std::lock_guard<std::mutex> lock(_topic_list_lock);
+void TopicManager::deleteTopic(const InternedTopic& topicFilter) {
+  ASSERT_OWNER_THREAD(_owner);
 
-  auto it = _topic_list.find(topicFilter);
-  if (it == _topic_list.end()) {
-    LOG->error("deleteTopic: {} does not exist.", topicFilter);
+  auto& list = _filter_list.count(topicFilter.id()) ? _filter_list : _topic_list;
+
+  auto it = list.find(topicFilter.id());
+  if (it == list.end()) {
+    LOG->error("deleteTopic: {} does not exist.", topicFilter.name());
     return;
   }
 
-  _topic_list.erase(it);
+  list.erase(it);
 }
 
 /*
@@ -170,30 +293,29 @@ bool TopicManager::isValidTopicOrFilter(const std::string& topic) {
 * @returns true if it matches, false otherwise.
 */
 bool TopicManager::isFilterMatched(const std::string& filterName, const std::string& topicName) {
-  const auto filterLevels = splitLevels(filterName);
-  const auto topicLevels  = splitLevels(topicName);
+  std::string_view filter(filterName);
+  std::string_view topic(topicName);
+  bool filterHasMore = true;
+  bool topicHasMore  = true;
 
-  std::size_t topicIndex = 0;
-  for (std::size_t filterIndex = 0; filterIndex < filterLevels.size(); ++filterIndex, ++topicIndex) {
-    const auto filterLevel = filterLevels[filterIndex];
+  while (filterHasMore) {
+    const auto filterLevel = TopicMatcher::nextLevel(filter, filterHasMore);
 
     if (filterLevel == "#") {
       return true;
     }
 
-    if (topicIndex >= topicLevels.size()) {
+    if (!topicHasMore) {
       return false;
     }
 
-    if (filterLevel == "+") {
-      continue;
-    }
+    const auto topicLevel = TopicMatcher::nextLevel(topic, topicHasMore);
 
-    if (filterLevel != topicLevels[topicIndex]) {
+    if (filterLevel != "+" && filterLevel != topicLevel) {
       return false;
     }
   }
 
-  return topicIndex == topicLevels.size();
+  return !topicHasMore;
 }
 } // namespace eventhub
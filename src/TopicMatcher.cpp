@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "TopicMatcher.hpp"
+
+namespace eventhub {
+
+TopicMatcher::TopicMatcher() {
+  clear();
+}
+
+/**
+ * Add a filter.
+ * @param filter Topic or topic filter.
+ * @returns Number of the filter.
+ */
+std::size_t TopicMatcher::add(const std::string& filter) {
+  const auto filterNumber = static_cast<uint32_t>(_filter_lengths.size());
+  std::string_view rest(filter);
+  bool hasMore  = true;
+  uint32_t node = 0;
+
+  _filter_lengths.push_back(filter.length());
+
+  while (hasMore) {
+    const auto level = nextLevel(rest, hasMore);
+
+    // Like isFilterMatched() the filter matches anything once a '#' is reached.
+    if (level == "#") {
+      if (_nodes[node].rest == NONE) {
+        _nodes[node].rest = filterNumber;
+      }
+
+      return filterNumber;
+    }
+
+    node = _getChild(node, level);
+  }
+
+  if (_nodes[node].terminal == NONE) {
+    _nodes[node].terminal = filterNumber;
+  }
+
+  return filterNumber;
+}
+
+/**
+ * Remove all filters.
+ */
+void TopicMatcher::clear() {
+  _nodes.assign(1, Node());
+  _filter_lengths.clear();
+}
+
+/**
+ * Check if any of the filters match a topic.
+ */
+bool TopicMatcher::matches(std::string_view topic) const {
+  Match best;
+  return _match(0, topic, true, true, true, best);
+}
+
+/**
+ * Find the filter closest to a topic: the first filter equal to it, or else
+ * the longest matching filter. Ties go to the filter added first.
+ * @returns Number of the filter, or nothing if none match.
+ */
+std::optional<std::size_t> TopicMatcher::findClosestMatch(std::string_view topic) const {
+  Match best;
+  _match(0, topic, true, true, false, best);
+
+  if (best.filter == NONE) {
+    return std::nullopt;
+  }
+
+  return best.filter;
+}
+
+/**
+ * Cut the next level off a topic or filter.
+ * @param rest What is left of the topic, the level is removed from it.
+ * @param hasMore Set to false when the last level is returned.
+ */
+std::string_view TopicMatcher::nextLevel(std::string_view& rest, bool& hasMore) {
+  const auto pos = rest.find('/');
+
+  if (pos == std::string_view::npos) {
+    const auto level = rest;
+    rest             = std::string_view();
+    hasMore          = false;
+    return level;
+  }
+
+  const auto level = rest.substr(0, pos);
+  rest.remove_prefix(pos + 1);
+  return level;
+}
+
+uint32_t TopicMatcher::_getChild(uint32_t node, std::string_view level) {
+  if (level == "+") {
+    if (_nodes[node].plus == NONE) {
+      _nodes[node].plus = static_cast<uint32_t>(_nodes.size());
+      _nodes.emplace_back();
+    }
+
+    return _nodes[node].plus;
+  }
+
+  auto& children = _nodes[node].children;
+  auto it        = std::lower_bound(children.begin(), children.end(), level, [](const auto& child, std::string_view l) {
+    return child.first < l;
+  });
+
+  if (it != children.end() && it->first == level) {
+    return it->second;
+  }
+
+  const auto child = static_cast<uint32_t>(_nodes.size());
+  children.emplace(it, std::string(level), child);
+  _nodes.emplace_back();
+
+  return child;
+}
+
+/**
+ * Walk the trie along the levels of a topic.
+ * @param exact True as long as only literal levels were followed.
+ * @param firstOnly Stop at the first match.
+ * @returns true if the walk was stopped.
+ */
+bool TopicMatcher::_match(uint32_t node, std::string_view rest, bool hasMore, bool exact, bool firstOnly, Match& best) const {
+  const auto& n = _nodes[node];
+
+  if (n.rest != NONE && _addMatch(n.rest, false, firstOnly, best)) {
+    return true;
+  }
+
+  if (!hasMore) {
+    return n.terminal != NONE && _addMatch(n.terminal, exact, firstOnly, best);
+  }
+
+  const auto level = nextLevel(rest, hasMore);
+
+  auto it = std::lower_bound(n.children.begin(), n.children.end(), level, [](const auto& child, std::string_view l) {
+    return child.first < l;
+  });
+
+  if (it != n.children.end() && it->first == level && _match(it->second, rest, hasMore, exact, firstOnly, best)) {
+    return true;
+  }
+
+  return n.plus != NONE && _match(n.plus, rest, hasMore, false, firstOnly, best);
+}
+
+bool TopicMatcher::_addMatch(uint32_t filter, bool exact, bool firstOnly, Match& best) const {
+  if (firstOnly) {
+    best.filter = filter;
+    return true;
+  }
+
+  if (best.filter != NONE) {
+    const auto length     = _filter_lengths[filter];
+    const auto bestLength = _filter_lengths[best.filter];
+
+    if (exact != best.exact) {
+      if (!exact) {
+        return false;
+      }
+    } else if (length < bestLength || (length == bestLength && filter > best.filter)) {
+      return false;
+    }
+  }
+
+  best.filter = filter;
+  best.exact  = exact;
+
+  return false;
+}
+
+} // namespace eventhub
@@ -0,0 +1,100 @@
+#include <array>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "TopicRegistry.hpp"
+#include "Common.hpp"
+
+namespace eventhub {
+namespace {
+/**
+ * Part of the table. IDs are handed out per shard as slot * shard count +
+ * shard index, so a shard can reuse its IDs on its own and the shard of an
+ * entry follows from its ID.
+ */
+struct Shard {
+  std::mutex lock;
+  std::unordered_map<std::string_view, TopicRegistry::Entry*> entries; // Keys point into Entry::name.
+  std::vector<uint32_t> free_slots;
+  uint32_t next_slot = 0;
+};
+
+std::array<Shard, TOPIC_REGISTRY_SHARDS>& shards() {
+  static std::array<Shard, TOPIC_REGISTRY_SHARDS> instance;
+  return instance;
+}
+} // namespace
+
+/**
+ * Intern a name, adding it to the table if it is not there yet.
+ * @param name Topic or filter name.
+ * @returns Entry with a reference held for the caller.
+ */
+TopicRegistry::Entry* TopicRegistry::acquire(const std::string& name) {
+  const std::size_t shardIndex = std::hash<std::string_view>()(name) % TOPIC_REGISTRY_SHARDS;
+  auto& shard                  = shards()[shardIndex];
+
+  std::lock_guard<std::mutex> lock(shard.lock);
+
+  auto it = shard.entries.find(name);
+  if (it != shard.entries.end()) {
+    it->second->refs.fetch_add(1, std::memory_order_relaxed);
+    return it->second;
+  }
+
+  uint32_t slot;
+  if (!shard.free_slots.empty()) {
+    slot = shard.free_slots.back();
+    shard.free_slots.pop_back();
+  } else {
+    slot = shard.next_slot++;
+  }
+
+  auto entry = new Entry{name, static_cast<TopicId>(slot * TOPIC_REGISTRY_SHARDS + shardIndex), {1}};
+  shard.entries.emplace(entry->name, entry);
+
+  return entry;
+}
+
+/**
+ * Drop a reference, removing the entry when it was the last one.
+ */
+void TopicRegistry::release(Entry* entry) {
+  // Other references remain, no need to touch the shard.
+  uint32_t refs = entry->refs.load(std::memory_order_relaxed);
+  while (refs > 1) {
+    if (entry->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+
+  // Possibly the last reference. Decide under the shard lock, acquire() may
+  // find the entry and take a new reference until we hold it.
+  auto& shard = shards()[entry->id % TOPIC_REGISTRY_SHARDS];
+  std::lock_guard<std::mutex> lock(shard.lock);
+
+  if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  shard.entries.erase(entry->name);
+  shard.free_slots.push_back(entry->id / TOPIC_REGISTRY_SHARDS);
+  delete entry;
+}
+
+std::size_t TopicRegistry::size() {
+  std::size_t count = 0;
+
+  for (auto& shard : shards()) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    count += shard.entries.size();
+  }
+
+  return count;
+}
+
+} // namespace eventhub
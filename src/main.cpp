@@ -122,37 +122,7 @@ int main(int argc, char** argv) {
     }
   }
 
-  ConfigMap cfgMap = {
-      { "listen_port",               ConfigValueType::INT,    "8080",      ConfigValueSettings::REQUIRED },
-      { "worker_threads",            ConfigValueType::INT,    "0",         ConfigValueSettings::REQUIRED },
-      { "jwt_secret",                ConfigValueType::STRING, "FooBarBaz", ConfigValueSettings::REQUIRED },
-      { "log_level",                 ConfigValueType::STRING, "info",      ConfigValueSettings::REQUIRED },
-      { "disable_auth",              ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
-      { "prometheus_metric_prefix",  ConfigValueType::STRING, "eventhub",  ConfigValueSettings::REQUIRED },
-      { "redis_host",                ConfigValueType::STRING, "localhost", ConfigValueSettings::REQUIRED },
-      { "redis_port",                ConfigValueType::INT,    "6379",      ConfigValueSettings::REQUIRED },
-      { "redis_password",            ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
-      { "redis_prefix",              ConfigValueType::STRING, "eventhub",  ConfigValueSettings::OPTIONAL },
-      { "redis_pool_size",           ConfigValueType::INT,    "5",         ConfigValueSettings::REQUIRED },
-      { "enable_cache",              ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
-      { "max_cache_length",          ConfigValueType::INT,    "1000",      ConfigValueSettings::REQUIRED },
-      { "max_cache_request_limit",   ConfigValueType::INT,    "100",       ConfigValueSettings::REQUIRED },
-      { "default_cache_ttl",         ConfigValueType::INT,    "60",        ConfigValueSettings::REQUIRED },
-      { "ping_interval",             ConfigValueType::INT,    "30",        ConfigValueSettings::REQUIRED },
-      { "handshake_timeout",         ConfigValueType::INT,    "5",         ConfigValueSettings::REQUIRED },
-      { "enable_sse",                ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
-      { "enable_ssl",                ConfigValueType::BOOL,   "false",     ConfigValueSettings::REQUIRED },
-      { "ssl_listen_port",           ConfigValueType::INT,    "8443",      ConfigValueSettings::REQUIRED },
-      { "ssl_ca_certificate",        ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
-      { "ssl_certificate",           ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
-      { "ssl_private_key",           ConfigValueType::STRING, "",          ConfigValueSettings::OPTIONAL },
-      { "ssl_cert_auto_reload",      ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
-      { "ssl_cert_check_interval",   ConfigValueType::INT,    "300",       ConfigValueSettings::OPTIONAL },
-      { "disable_unsecure_listener", ConfigValueType::BOOL,   "false",     ConfigValueSettings::OPTIONAL },
-      { "enable_kvstore",            ConfigValueType::BOOL,   "true",      ConfigValueSettings::REQUIRED }
-    };
-
-  Config cfg(cfgMap);
+  Config cfg(defaultConfigMap());
 
   try {
     if (!cfgFile.empty()) {
@@ -21,10 +21,46 @@ const std::string JsonRenderer::RenderMetrics(Server* server) {
   j["redis_connection_fail_count"] = metrics.redis_connection_fail_count;
   j["redis_publish_delay_ms"]      = metrics.redis_publish_delay_ms;
 
+  j["allowed_cpu_count"]   = metrics.allowed_cpu_count;
+  j["cpu_quota_millis"]    = metrics.cpu_quota_millis;
+  j["numa_node_count"]     = metrics.numa_node_count;
+  j["pinned_worker_count"] = metrics.pinned_worker_count;
+
   j["current_connections_count"] = metrics.current_connections_count;
   j["total_connect_count"]       = metrics.total_connect_count;
   j["total_disconnect_count"]    = metrics.total_disconnect_count;
   j["eventloop_delay_ms"]        = metrics.eventloop_delay_ms;
+  j["eventloop_delay_max_ms"]    = metrics.eventloop_delay_max_ms;
+
+  j["current_subscription_count"] = metrics.current_subscription_count;
+  j["total_migrated_count"]       = metrics.total_migrated_count;
+
+  j["pool_blocks_in_use"] = metrics.pool_blocks_in_use;
+  j["pool_blocks_free"]   = metrics.pool_blocks_free;
+  j["pool_bytes"]         = metrics.pool_bytes;
+
+  j["jwt_cache_hits"]   = metrics.jwt_cache_hits;
+  j["jwt_cache_misses"] = metrics.jwt_cache_misses;
+  j["jwt_cache_size"]   = metrics.jwt_cache_size;
+
+  j["rate_limited_count"]    = metrics.rate_limited_count;
+  j["rate_limited_patterns"] = nlohmann::json::object();
+  for (const auto& pattern : metrics.rate_limited_patterns) {
+    j["rate_limited_patterns"][pattern.first] = pattern.second;
+  }
+
+  j["slow_consumer_dropped_count"]    = metrics.slow_consumer_dropped_count;
+  j["slow_consumer_conflated_count"]  = metrics.slow_consumer_conflated_count;
+  j["slow_consumer_disconnect_count"] = metrics.slow_consumer_disconnect_count;
+  j["slow_consumer_resume_count"]     = metrics.slow_consumer_resume_count;
+  j["slow_consumer_topics"]           = nlohmann::json::object();
+  for (const auto& topic : metrics.slow_consumer_topics) {
+    j["slow_consumer_topics"][topic.first] = {{"dropped", topic.second.dropped}, {"conflated", topic.second.conflated}};
+  }
+
+  j["output_bytes"]             = metrics.output_bytes;
+  j["worker_output_bytes"]      = metrics.worker_output_bytes;
+  j["output_budget_shed_count"] = metrics.output_budget_shed_count;
 
   return j.dump(4) + "\r\n";
 }
@@ -22,11 +22,36 @@ const std::string PrometheusRenderer::RenderMetrics(Server* server) {
       {"publish_count", "counter", metrics.publish_count},
       {"redis_connection_fail_count", "counter", metrics.redis_connection_fail_count},
       {"redis_publish_delay_ms", "gauge", metrics.redis_publish_delay_ms},
+      {"allowed_cpu_count", "gauge", metrics.allowed_cpu_count},
+      {"cpu_quota_millis", "gauge", metrics.cpu_quota_millis},
+      {"numa_node_count", "gauge", metrics.numa_node_count},
+      {"pinned_worker_count", "gauge", metrics.pinned_worker_count},
 
       {"current_connections_count", "gauge", metrics.current_connections_count},
       {"total_connect_count", "counter", metrics.total_connect_count},
       {"total_disconnect_count", "counter", metrics.total_disconnect_count},
-      {"eventloop_delay_ms", "gauge", metrics.eventloop_delay_ms}};
+      {"eventloop_delay_ms", "gauge", metrics.eventloop_delay_ms},
+      {"eventloop_delay_max_ms", "gauge", metrics.eventloop_delay_max_ms},
+      {"current_subscription_count", "gauge", metrics.current_subscription_count},
+      {"total_migrated_count", "counter", metrics.total_migrated_count},
+
+      {"pool_blocks_in_use", "gauge", metrics.pool_blocks_in_use},
+      {"pool_blocks_free", "gauge", metrics.pool_blocks_free},
+      {"pool_bytes", "gauge", metrics.pool_bytes},
+
+      {"jwt_cache_hits", "counter", metrics.jwt_cache_hits},
+      {"jwt_cache_misses", "counter", metrics.jwt_cache_misses},
+      {"jwt_cache_size", "gauge", metrics.jwt_cache_size},
+
+      {"rate_limited_count", "counter", metrics.rate_limited_count},
+
+      {"slow_consumer_dropped_count", "counter", metrics.slow_consumer_dropped_count},
+      {"slow_consumer_conflated_count", "counter", metrics.slow_consumer_conflated_count},
+      {"slow_consumer_disconnect_count", "counter", metrics.slow_consumer_disconnect_count},
+      {"slow_consumer_resume_count", "counter", metrics.slow_consumer_resume_count},
+
+      {"output_bytes", "gauge", metrics.output_bytes},
+      {"output_budget_shed_count", "counter", metrics.output_budget_shed_count}};
 
   char h_buf[128] = {0};
   std::stringstream ss;
@@ -46,8 +71,62 @@ const std::string PrometheusRenderer::RenderMetrics(Server* server) {
        << "} " << metricValue << "\n";
   }
 
+  // Throttled publishes per rate limit pattern.
+  if (!metrics.rate_limited_patterns.empty()) {
+    const std::string metricName = config.get<std::string>("prometheus_metric_prefix") + "_rate_limited_pattern_count";
+    ss << "# TYPE " << metricName << " counter\n";
+
+    for (const auto& pattern : metrics.rate_limited_patterns) {
+      ss << metricName << "{instance=\"" << h_buf << ":" << config.get<int>("listen_port") << "\""
+         << ",pattern=\"" << _escapeLabelValue(pattern.first) << "\"} " << pattern.second << "\n";
+    }
+  }
+
+  // Messages dropped and conflated for slow consumers per topic.
+  if (!metrics.slow_consumer_topics.empty()) {
+    const std::string droppedName   = config.get<std::string>("prometheus_metric_prefix") + "_slow_consumer_dropped_topic_count";
+    const std::string conflatedName = config.get<std::string>("prometheus_metric_prefix") + "_slow_consumer_conflated_topic_count";
+
+    for (const auto& metric : {std::make_pair(droppedName, &SlowConsumerTopicMetrics::dropped), std::make_pair(conflatedName, &SlowConsumerTopicMetrics::conflated)}) {
+      ss << "# TYPE " << metric.first << " counter\n";
+
+      for (const auto& topic : metrics.slow_consumer_topics) {
+        ss << metric.first << "{instance=\"" << h_buf << ":" << config.get<int>("listen_port") << "\""
+           << ",topic=\"" << _escapeLabelValue(topic.first) << "\"} " << topic.second.*metric.second << "\n";
+      }
+    }
+  }
+
+  // Bytes waiting to be sent to clients per worker.
+  if (!metrics.worker_output_bytes.empty()) {
+    const std::string metricName = config.get<std::string>("prometheus_metric_prefix") + "_worker_output_bytes";
+    ss << "# TYPE " << metricName << " gauge\n";
+
+    for (std::size_t i = 0; i < metrics.worker_output_bytes.size(); i++) {
+      ss << metricName << "{instance=\"" << h_buf << ":" << config.get<int>("listen_port") << "\""
+         << ",worker=\"" << i + 1 << "\"} " << metrics.worker_output_bytes[i] << "\n";
+    }
+  }
+
   return ss.str();
 }
 
+// Escape a label value as the Prometheus text format requires.
+std::string PrometheusRenderer::_escapeLabelValue(const std::string& value) {
+  std::string escaped;
+  escaped.reserve(value.length());
+
+  for (const auto c : value) {
+    switch (c) {
+      case '\\': escaped += "\\\\"; break;
+      case '"': escaped += "\\\""; break;
+      case '\n': escaped += "\\n"; break;
+      default: escaped += c;
+    }
+  }
+
+  return escaped;
+}
+
 } // namespace metrics
 } // namespace eventhub
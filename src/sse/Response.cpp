@@ -24,10 +24,15 @@ void Response::ok(ConnectionPtr conn) {
 }
 
 void Response::sendPing(ConnectionPtr conn) {
-  conn->write(":\n\n");
+  static const std::string ping(":\n\n");
+  conn->write(ping);
 }
 
 void Response::sendEvent(ConnectionPtr conn, const std::string& id, const std::string& message, const std::string& event) {
+  sendEvent(conn.get(), id, message, event);
+}
+
+void Response::sendEvent(Connection* conn, const std::string& id, const std::string& message, const std::string& event) {
   std::string data;
 
   if (event.empty()) {
@@ -5,8 +5,11 @@
 #include <memory>
 
 #include "websocket/Handler.hpp"
+#include "Arena.hpp"
 #include "Connection.hpp"
+#include "ConnectionWorker.hpp"
 #include "HandlerContext.hpp"
+#include "RPCDecoder.hpp"
 #include "RPCHandler.hpp"
 #include "jsonrpc/jsonrpcpp.hpp"
 #include "websocket/Response.hpp"
@@ -58,6 +61,7 @@ void Handler::HandleRequest(HandlerContext&& ctx, ParserStatus parserStatus, Fra
       break;
 
     case FrameType::PONG_FRAME:
+      ctx.connection()->touchLastPong();
       break;
 
     case FrameType::CLOSE_FRAME:
@@ -77,6 +81,25 @@ void Handler::_handleTextFrame(HandlerContext& ctx, const std::string& data) {
   thread_local jsonrpcpp::Parser parser;
   jsonrpcpp::entity_ptr entity;
 
+  // Scratch memory of the request is released all at once when we're done.
+  Arena::Scope arenaScope(ctx.worker()->getRPCArena());
+
+  // Publish and subscribe are decoded without jsonrpcpp. The request is
+  // reused so its strings keep their buffers between requests.
+  thread_local RPCRequest request;
+  if (RPCDecoder::decode(data, request)) {
+    try {
+      RPCHandler::handleRequest(ctx, request);
+    } catch (std::exception& e) {
+      LOG->error("Error while handling RPC request from {}: {}.", ctx.connection()->getIP(), e.what());
+      Response::sendData(ctx.connection(),
+                         jsonrpcpp::Response(jsonrpcpp::InternalErrorException(e.what(), request.id)).to_json().dump(),
+                         websocket::FrameType::TEXT_FRAME);
+    }
+
+    return;
+  }
+
   try {
     entity = parser.parse(data);
   } catch (std::exception& e) {
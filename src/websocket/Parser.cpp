@@ -26,6 +26,7 @@ static int parserOnDataPayload(void* userData, const char* buff, std::size_t len
 static int parserOnDataEnd(void* userData) {
   auto obj = static_cast<Parser*>(userData);
   obj->callback(ParserStatus::PARSER_OK, obj->getDataFrameType(), obj->getDataPayload());
+  obj->clearDataPayload();
   return 0;
 }
 
@@ -45,32 +46,35 @@ static int parserOnControlPayload(void* userData, const char* buff, std::size_t
 static int parserOnControlEnd(void* userData) {
   auto obj = static_cast<Parser*>(userData);
   obj->callback(ParserStatus::PARSER_OK, obj->getControlFrameType(), obj->getControlPayload());
+  obj->clearControlPayload();
   return 0;
 }
 
+static const ws_parser_callbacks_t parserCallbacks = {
+    .on_data_begin      = parserOnDataBegin,
+    .on_data_payload    = parserOnDataPayload,
+    .on_data_end        = parserOnDataEnd,
+    .on_control_begin   = parserOnControlBegin,
+    .on_control_payload = parserOnControlPayload,
+    .on_control_end     = parserOnControlEnd,
+};
+
 Parser::Parser() {
   _callback = [](ParserStatus status, FrameType frameType, const std::string& data) {
     LOG->error("Websocket parser callback was called before it was initialized.");
   };
 
   ws_parser_init(&_ws_parser);
-
-  _ws_parser_callbacks = {
-      .on_data_begin      = parserOnDataBegin,
-      .on_data_payload    = parserOnDataPayload,
-      .on_data_end        = parserOnDataEnd,
-      .on_control_begin   = parserOnControlBegin,
-      .on_control_payload = parserOnControlPayload,
-      .on_control_end     = parserOnControlEnd,
-  };
 }
 
+// Payloads are released rather than cleared, an idle connection should not
+// hold on to the buffer of the last message it sent.
 void Parser::clearDataPayload() {
-  _data_payload_buf.clear();
+  std::string().swap(_data_payload_buf);
 }
 
 void Parser::clearControlPayload() {
-  _control_payload_buf.clear();
+  std::string().swap(_control_payload_buf);
 }
 
 void Parser::appendDataPayload(const char* data, std::size_t len) {
@@ -114,7 +118,7 @@ const std::string& Parser::getControlPayload() {
 }
 
 void Parser::parse(char* buf, std::size_t len) {
-  ws_parser_execute(&_ws_parser, &_ws_parser_callbacks, this, buf, len);
+  ws_parser_execute(&_ws_parser, &parserCallbacks, this, buf, len);
 }
 
 } // namespace websocket
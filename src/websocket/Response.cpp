@@ -4,16 +4,16 @@
 #include <memory>
 
 #include "websocket/Response.hpp"
+#include "Arena.hpp"
 #include "Common.hpp"
 #include "websocket/Types.hpp"
 
 namespace eventhub {
 namespace websocket {
-void Response::_sendFragment(ConnectionPtr conn, const std::string& fragment, uint8_t frameType, bool fin) {
-  std::string sndBuf;
+void Response::_sendFragment(Connection* conn, const char* fragment, std::size_t fragmentSize, uint8_t frameType, bool fin) {
+  ArenaString sndBuf;
   char header[8];
-  std::size_t headerSize   = 0;
-  std::size_t fragmentSize = fragment.size();
+  std::size_t headerSize = 0;
 
   header[0] = fin << 7;
   header[0] = header[0] | (0xF & frameType);
@@ -34,16 +34,23 @@ void Response::_sendFragment(ConnectionPtr conn, const std::string& fragment, ui
     headerSize = 8;
   }
 
-  sndBuf.insert(0, header, headerSize);
-  sndBuf.append(fragment);
-  conn->write(sndBuf);
+  sndBuf.reserve(headerSize + fragmentSize);
+  sndBuf.append(header, headerSize);
+  sndBuf.append(fragment, fragmentSize);
+  conn->write(sndBuf.data(), sndBuf.length());
 }
 
 void Response::sendData(ConnectionPtr conn, const std::string& data, FrameType frameType) {
-  std::size_t dataSize = data.size();
+  sendData(conn.get(), data, frameType);
+}
+
+void Response::sendData(Connection* conn, const std::string& data, FrameType frameType) {
+  sendData(conn, data.c_str(), data.length(), frameType);
+}
 
+void Response::sendData(Connection* conn, const char* data, std::size_t dataSize, FrameType frameType) {
   if (dataSize < WS_MAX_CHUNK_SIZE) {
-    _sendFragment(conn, data, (uint8_t)frameType, true);
+    _sendFragment(conn, data, dataSize, (uint8_t)frameType, true);
   } else {
     // First: fin = false, frameType = frameType
     // Following: fin = false, frameType = CONTINUATION_FRAME
@@ -52,12 +59,21 @@ void Response::sendData(ConnectionPtr conn, const std::string& data, FrameType f
     for (unsigned i = 0; i < nChunks; i++) {
       uint8_t chunkFrametype = uint8_t((i == 0) ? frameType : FrameType::CONTINUATION_FRAME);
       bool fin               = (i < (nChunks - 1)) ? false : true;
-      std::size_t len             = (i < (nChunks - 1)) ? WS_MAX_CHUNK_SIZE : std::string::npos;
-      auto const chunk       = data.substr(i * WS_MAX_CHUNK_SIZE, len);
-      _sendFragment(conn, chunk, chunkFrametype, fin);
+      std::size_t offset     = i * WS_MAX_CHUNK_SIZE;
+      std::size_t len        = (i < (nChunks - 1)) ? WS_MAX_CHUNK_SIZE : dataSize - offset;
+      _sendFragment(conn, data + offset, len, chunkFrametype, fin);
     }
   }
 }
 
+/**
+ * Send an empty PING frame.
+ * The frame never changes, so it is built once and shared by every ping.
+ */
+void Response::sendPing(ConnectionPtr conn) {
+  static const std::string pingFrame{static_cast<char>(0x80 | static_cast<uint8_t>(FrameType::PING_FRAME)), '\0'};
+  conn->write(pingFrame);
+}
+
 } // namespace websocket
 } // namespace eventhub
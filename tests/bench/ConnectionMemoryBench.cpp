@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "Connection.hpp"
+#include "ConnectionWorker.hpp"
+#include "Server.hpp"
+#include "TestConfig.hpp"
+
+using namespace eventhub;
+
+/*
+ * Memory footprint of idle connections.
+ *
+ * Opens connections over socket pairs and takes each one through a
+ * websocket handshake and a subscription, the way a client would, then
+ * reports how much heap the connections hold on to while idle. Kernel socket
+ * buffers are not included.
+ *
+ * Usage: eventhub_memory_bench [connections]
+ */
+
+namespace {
+
+const std::string websocketRequest =
+  "GET / HTTP/1.1\r\n"
+  "Host: localhost\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "Sec-WebSocket-Version: 13\r\n\r\n";
+
+/**
+ * Masked websocket text frame, as sent by a client.
+ */
+std::string clientFrame(const std::string& payload) {
+  const char mask[4] = {0x12, 0x34, 0x56, 0x78};
+  std::string frame;
+
+  frame += static_cast<char>(0x81);
+  frame += static_cast<char>(0x80 | payload.length());
+  frame.append(mask, sizeof(mask));
+
+  for (std::size_t i = 0; i < payload.length(); i++) {
+    frame += payload[i] ^ mask[i % 4];
+  }
+
+  return frame;
+}
+
+std::size_t heapInUse() {
+  return mallinfo2().uordblks;
+}
+
+struct Client {
+  int fd;
+  ConnectionPtr conn;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 5000;
+
+  // Two descriptors per connection.
+  struct rlimit rlim;
+  getrlimit(RLIMIT_NOFILE, &rlim);
+  rlim.rlim_cur = rlim.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &rlim);
+
+  Config cfg(testConfigMap({ { "reuseport_listeners", "false" } }));
+  cfg.load();
+
+  Server server(cfg);
+  Worker worker(&server, 1);
+
+  const std::string subscribeFrame = clientFrame("{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"subscribe\",\"params\":{\"topic\":\"bench/topic\"}}");
+  std::vector<Client> clients;
+  clients.reserve(count);
+
+  // Subscribe one connection first so the topic itself isn't counted.
+  const std::size_t before = heapInUse();
+  std::size_t baseline     = before;
+  char buf[4096];
+
+  for (std::size_t i = 0; i < count; i++) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+      std::cerr << "socketpair: " << strerror(errno) << " after " << i << " connections." << std::endl;
+      break;
+    }
+
+    struct sockaddr_in csin;
+    memset(&csin, 0, sizeof(csin));
+    csin.sin_family = AF_INET;
+
+    auto conn = std::allocate_shared<Connection>(PoolAllocator<Connection>(worker.getConnectionPools().connection), fds[0], &csin, &worker, cfg);
+
+    ::write(fds[1], websocketRequest.c_str(), websocketRequest.length());
+    conn->read();
+    ::write(fds[1], subscribeFrame.c_str(), subscribeFrame.length());
+    conn->read();
+
+    // Drain the responses so they don't count against the socket.
+    while (::recv(fds[1], buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+
+    if (conn->getState() != ConnectionState::WEBSOCKET || conn->listSubscriptions().size() != 1) {
+      std::cerr << "Connection " << i << " failed to subscribe." << std::endl;
+      return 1;
+    }
+
+    clients.push_back(Client{fds[1], conn});
+
+    if (i == 0) {
+      baseline = heapInUse();
+    }
+  }
+
+  const std::size_t after = heapInUse();
+  const std::size_t n     = clients.size();
+
+  std::cout << n << " idle websocket connections subscribed to one topic." << std::endl;
+  std::cout << "First connection and topic: " << (baseline - before) << " bytes." << std::endl;
+
+  if (n > 1) {
+    std::cout << "Heap per connection: " << (after - baseline) / (n - 1) << " bytes." << std::endl;
+  }
+
+  for (auto& client : clients) {
+    client.conn->unsubscribeAll();
+    client.conn.reset();
+    close(client.fd);
+  }
+
+  return 0;
+}
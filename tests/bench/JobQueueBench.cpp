@@ -0,0 +1,105 @@
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.hpp"
+
+using namespace eventhub;
+
+/*
+ * Contention benchmark for the EventLoop job queue.
+ *
+ * N producer threads each post M small jobs while a single consumer drains
+ * the queue, mirroring the Redis thread -> worker handoff. The lock-free
+ * EventLoop queue is compared against the previous mutex + std::deque of
+ * std::function implementation, kept here as the reference.
+ *
+ * Usage: eventhub_bench [producers] [jobs per producer]
+ */
+
+namespace {
+
+class LockedJobQueue {
+public:
+  void addJob(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(_job_queue_lock);
+    _job_queue.push_back(callback);
+  }
+
+  void processJobs() {
+    std::lock_guard<std::mutex> lock(_job_queue_lock);
+
+    for (auto& callback : _job_queue) {
+      callback();
+    }
+
+    _job_queue.clear();
+  }
+
+private:
+  std::deque<std::function<void()>> _job_queue;
+  std::mutex _job_queue_lock;
+};
+
+template <class Queue>
+double run(Queue& queue, unsigned int producers, unsigned int jobsPerProducer) {
+  std::atomic<unsigned long long> processed{0};
+  const unsigned long long total = static_cast<unsigned long long>(producers) * jobsPerProducer;
+  std::vector<std::thread> threads;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (unsigned int p = 0; p < producers; p++) {
+    threads.emplace_back([&]() {
+      // Capture a string like Worker::publish does, to include the cost of
+      // storing a non-trivial callable.
+      const std::string payload = "topic/with/a/reasonable/length";
+
+      for (unsigned int i = 0; i < jobsPerProducer; i++) {
+        queue.addJob([&processed, payload]() {
+          processed.fetch_add(payload.size() > 0 ? 1 : 0, std::memory_order_relaxed);
+        });
+      }
+    });
+  }
+
+  while (processed.load(std::memory_order_relaxed) < total) {
+    queue.processJobs();
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+void report(const std::string& name, double seconds, unsigned long long total) {
+  std::cout << name << ": " << seconds * 1000.0 << " ms, "
+            << static_cast<unsigned long long>(total / seconds) << " jobs/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const unsigned int producers       = argc > 1 ? std::stoul(argv[1]) : 4;
+  const unsigned int jobsPerProducer = argc > 2 ? std::stoul(argv[2]) : 250000;
+  const unsigned long long total     = static_cast<unsigned long long>(producers) * jobsPerProducer;
+
+  std::cout << producers << " producers, " << jobsPerProducer << " jobs each." << std::endl;
+
+  LockedJobQueue locked;
+  report("mutex + deque<std::function>", run(locked, producers, jobsPerProducer), total);
+
+  EventLoop ev;
+  report("EventLoop (lock-free MPSC)  ", run(ev, producers, jobsPerProducer), total);
+
+  return 0;
+}
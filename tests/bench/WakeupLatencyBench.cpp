@@ -0,0 +1,185 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Config.hpp"
+#include "ConnectionWorker.hpp"
+#include "Server.hpp"
+#include "TestConfig.hpp"
+
+using namespace eventhub;
+
+/*
+ * Wakeup latency benchmark for the connection workers.
+ *
+ * An SSE client subscribes to a topic on a single worker. Messages are then
+ * published to the worker from this thread, the way the Redis thread hands
+ * them off, one at a time with a short pause so the worker runs out of work
+ * in between. The time from Worker::publish() until the event is read by the
+ * client is measured with the default blocking loop and with busy polling.
+ *
+ * Usage: eventhub_latency_bench [messages] [pause us] [busy_poll_us] [io_backend]
+ */
+
+namespace {
+
+int pickFreePort() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in sin;
+  socklen_t sinLen = sizeof(sin);
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family      = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  bind(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin));
+  getsockname(fd, reinterpret_cast<struct sockaddr*>(&sin), &sinLen);
+  close(fd);
+
+  return ntohs(sin.sin_port);
+}
+
+/**
+ * Read from fd until buffer contains terminator, and drop everything up to
+ * and including it.
+ */
+bool readUntil(int fd, std::string& buffer, const std::string& terminator) {
+  char buf[4096];
+
+  while (buffer.find(terminator) == std::string::npos) {
+    ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      return false;
+    }
+
+    buffer.append(buf, n);
+  }
+
+  buffer.erase(0, buffer.find(terminator) + terminator.length());
+  return true;
+}
+
+int connectSSE(int port, const std::string& topic) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in sin;
+  int flag = 1;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family      = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sin.sin_port        = htons(port);
+
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin)) == -1) {
+    close(fd);
+    return -1;
+  }
+
+  const std::string request = "GET /" + topic + " HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+  if (::write(fd, request.c_str(), request.length()) != static_cast<ssize_t>(request.length())) {
+    close(fd);
+    return -1;
+  }
+
+  // The subscription is in place once the worker has answered.
+  std::string buffer;
+  if (!readUntil(fd, buffer, ":ok\n\n")) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/**
+ * Latencies in microseconds of messages published to a worker running with
+ * the given busy poll window.
+ */
+std::vector<double> run(const std::string& ioBackend, int busyPoll, unsigned int messages, std::chrono::microseconds pause) {
+  const int port = pickFreePort();
+
+  Config cfg(testConfigMap({ { "max_cache_request_limit", "10" } }));
+  cfg << ("listen_port = " + std::to_string(port) + "\n").c_str();
+  cfg << ("io_backend = " + ioBackend + "\n").c_str();
+  cfg << ("busy_poll_us = " + std::to_string(busyPoll) + "\n").c_str();
+  cfg.load();
+
+  Server server(cfg);
+  auto worker = std::make_unique<Worker>(&server, 1);
+  worker->run();
+
+  std::vector<double> latencies;
+  const int fd = connectSSE(port, "bench");
+
+  if (fd == -1) {
+    std::cerr << "Could not subscribe to the worker." << std::endl;
+  } else {
+    std::string buffer;
+    const InternedTopic topic("bench");
+    latencies.reserve(messages);
+
+    for (unsigned int i = 0; i < messages; i++) {
+      std::this_thread::sleep_for(pause);
+
+      const auto start = std::chrono::steady_clock::now();
+      worker->publish(topic, "{\"id\": \"" + std::to_string(i) + "\", \"message\": \"x\"}");
+
+      if (!readUntil(fd, buffer, "\n\n")) {
+        std::cerr << "Connection closed by the worker." << std::endl;
+        break;
+      }
+
+      latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    close(fd);
+  }
+
+  worker->stop();
+  worker->thread().join();
+
+  return latencies;
+}
+
+void report(const std::string& name, std::vector<double> latencies) {
+  if (latencies.empty()) {
+    return;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+
+  auto percentile = [&](double p) {
+    return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()))];
+  };
+
+  std::cout << name << ": p50 " << percentile(0.50) << " us, p90 " << percentile(0.90)
+            << " us, p99 " << percentile(0.99) << " us, p99.9 " << percentile(0.999)
+            << " us, max " << latencies.back() << " us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const unsigned int messages = argc > 1 ? std::stoul(argv[1]) : 20000;
+  const auto pause            = std::chrono::microseconds(argc > 2 ? std::stoul(argv[2]) : 100);
+  const int busyPoll          = argc > 3 ? std::stoi(argv[3]) : 1000;
+  const std::string ioBackend = argc > 4 ? argv[4] : "epoll";
+
+  std::cout << messages << " messages, " << pause.count() << " us apart, " << ioBackend << " backend." << std::endl;
+
+  report("blocking", run(ioBackend, 0, messages, pause));
+  report("busy_poll_us = " + std::to_string(busyPoll), run(ioBackend, busyPoll, messages, pause));
+
+  return 0;
+}
@@ -130,6 +130,7 @@ def start_eventhub(
     enable_sse=False,
     enable_kvstore=True,
     jwt_secret="eventhub_secret",
+    io_backend="epoll",
     quiet=True,
 ):
     env = os.environ.copy()
@@ -143,6 +144,7 @@ def start_eventhub(
             "ENABLE_SSE": "true" if enable_sse else "false",
             "ENABLE_KVSTORE": "true" if enable_kvstore else "false",
             "JWT_SECRET": jwt_secret,
+            "IO_BACKEND": io_backend,
         }
     )
 
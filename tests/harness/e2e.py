@@ -320,6 +320,7 @@ def parse_args():
     parser.add_argument("--redis-bin", default="redis-server", help="Path to redis-server")
     parser.add_argument("--with-auth", action="store_true", help="Run tests with JWT auth enabled")
     parser.add_argument("--jwt-secret", default="eventhub_secret")
+    parser.add_argument("--io-backend", default="epoll", choices=["epoll", "io_uring"], help="Worker I/O backend of the started eventhub")
     parser.add_argument("--check-data-integrity", action="store_true", help="Verify per-subscriber message integrity")
     parser.add_argument("--verbose", action="store_true")
     return parser.parse_args()
@@ -351,6 +352,7 @@ def main():
                 enable_cache=True,
                 enable_kvstore=True,
                 jwt_secret=args.jwt_secret,
+                io_backend=args.io_backend,
                 quiet=not args.verbose,
             )
             managed.append(eventhub_proc)
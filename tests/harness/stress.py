@@ -166,6 +166,7 @@ def parse_args():
     parser.add_argument("--redis-bin", default="redis-server")
     parser.add_argument("--with-auth", action="store_true")
     parser.add_argument("--jwt-secret", default="eventhub_secret")
+    parser.add_argument("--io-backend", default="epoll", choices=["epoll", "io_uring"], help="Worker I/O backend of the started eventhub")
     parser.add_argument("--topic", default="stress/topic")
     parser.add_argument("--subscribers", type=int, default=50)
     parser.add_argument("--publishers", type=int, default=1)
@@ -204,6 +205,7 @@ def main():
                 enable_cache=False,
                 enable_kvstore=True,
                 jwt_secret=args.jwt_secret,
+                io_backend=args.io_backend,
                 quiet=not args.verbose,
             )
             managed.append(eventhub_proc)
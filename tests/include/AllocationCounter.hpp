@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+namespace eventhub {
+
+/**
+ * Counts the calls to the global operator new made by the current thread
+ * while it is alive. See AllocationCounter.cpp for the replaced operators.
+ */
+class AllocationCounter final {
+public:
+  AllocationCounter();
+  ~AllocationCounter();
+  AllocationCounter(const AllocationCounter&) = delete;
+  AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+  std::size_t count() const;
+
+private:
+  std::size_t _start;
+};
+
+} // namespace eventhub
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "Config.hpp"
+
+namespace eventhub {
+
+/**
+ * The server's default options with the overrides the tests share: auth is
+ * disabled, SSE is enabled and the Redis pool and JWT cache are kept small.
+ * Callers override only the options they need on top of that.
+ */
+inline ConfigMap testConfigMap(std::initializer_list<std::pair<std::string, std::string>> overrides = {}) {
+  ConfigMap cfgMap = defaultConfigMap();
+
+  auto set = [&cfgMap](const std::string& name, const std::string& value) {
+    for (auto& opt : cfgMap) {
+      if (opt.name == name) {
+        opt.defaultValue = value;
+        return;
+      }
+    }
+
+    throw std::runtime_error{"Unknown config option \"" + name + "\""};
+  };
+
+  set("redis_host", "127.0.0.1");
+  set("redis_pool_size", "1");
+  set("disable_auth", "true");
+  set("enable_sse", "true");
+  set("jwt_cache_size", "0");
+
+  for (const auto& [name, value] : overrides) {
+    set(name, value);
+  }
+
+  return cfgMap;
+}
+
+} // namespace eventhub
@@ -61,6 +61,20 @@ TEST_CASE("Test authorization", "[access_controller]") {
         REQUIRE(!acs.allowPublish("my/very/private/channel"));
       }
     }
+
+    WHEN("Checking more topics than the decision cache holds") {
+      THEN("Decisions should stay the same after being evicted") {
+        for (int round = 0; round < 3; round++) {
+          for (int i = 0; i < 20; i++) {
+            const auto n = std::to_string(i);
+            REQUIRE(acs.allowPublish("test1/" + n));
+            REQUIRE(acs.allowSubscribe("test2/" + n));
+            REQUIRE(!acs.allowPublish("test4/" + n));
+            REQUIRE(!acs.allowSubscribe("test4/" + n));
+          }
+        }
+      }
+    }
   }
 
   GIVEN("An invalid token") {
@@ -0,0 +1,47 @@
+#include <stdlib.h>
+#include <cstddef>
+#include <new>
+
+#include "AllocationCounter.hpp"
+
+namespace {
+thread_local std::size_t allocations = 0;
+thread_local unsigned int counters   = 0;
+} // namespace
+
+void* operator new(std::size_t size) {
+  if (counters > 0) {
+    allocations++;
+  }
+
+  void* p = malloc(size > 0 ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  free(p);
+}
+
+namespace eventhub {
+
+AllocationCounter::AllocationCounter() : _start(allocations) {
+  counters++;
+}
+
+AllocationCounter::~AllocationCounter() {
+  counters--;
+}
+
+std::size_t AllocationCounter::count() const {
+  return allocations - _start;
+}
+
+} // namespace eventhub
@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "Arena.hpp"
+#include "Util.hpp"
+#include "catch.hpp"
+#include "jwt/json/json.hpp"
+
+namespace eventhub {
+
+TEST_CASE("Arena test", "[arena]") {
+  Arena arena(1024, 16 * 1024);
+
+  SECTION("Allocations should be aligned and not overlap") {
+    auto a = static_cast<char*>(arena.allocate(3, 1));
+    auto b = static_cast<char*>(arena.allocate(8, 8));
+    auto c = static_cast<char*>(arena.allocate(16));
+
+    REQUIRE(reinterpret_cast<uintptr_t>(b) % 8 == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(c) % alignof(std::max_align_t) == 0);
+    REQUIRE(b >= a + 3);
+    REQUIRE(c >= b + 8);
+    REQUIRE(arena.getChunkCount() == 1);
+  }
+
+  SECTION("Reset should hand out the same memory again") {
+    void* first = arena.allocate(100);
+    arena.reset();
+
+    REQUIRE(arena.allocate(100) == first);
+  }
+
+  SECTION("Chunks should be merged on reset") {
+    for (int i = 0; i < 10; i++) {
+      arena.allocate(512);
+    }
+
+    arena.allocate(4096);
+    REQUIRE(arena.getChunkCount() > 1);
+
+    const auto capacity = arena.getCapacity();
+    arena.reset();
+
+    REQUIRE(arena.getChunkCount() == 1);
+    REQUIRE(arena.getCapacity() == capacity);
+  }
+
+  SECTION("Reset should give back what is over the retained limit") {
+    arena.allocate(64 * 1024);
+    REQUIRE(arena.getChunkCount() == 1);
+
+    arena.reset();
+    REQUIRE(arena.getCapacity() == 16 * 1024);
+
+    arena.allocate(8 * 1024);
+    arena.allocate(32 * 1024);
+    REQUIRE(arena.getChunkCount() == 2);
+
+    arena.reset();
+    REQUIRE(arena.getChunkCount() == 1);
+    REQUIRE(arena.getCapacity() == 16 * 1024);
+  }
+
+  SECTION("Scopes should set the current arena and reset it when done") {
+    REQUIRE(Arena::current() == nullptr);
+    void* first;
+
+    {
+      Arena::Scope scope(arena);
+      REQUIRE(Arena::current() == &arena);
+
+      {
+        Arena::Scope nested(arena);
+        first = arena.allocate(64);
+      }
+
+      // The outer scope is still using the arena.
+      REQUIRE(Arena::current() == &arena);
+      REQUIRE(arena.allocate(64) != first);
+    }
+
+    REQUIRE(Arena::current() == nullptr);
+    REQUIRE(arena.allocate(64) == first);
+  }
+
+  SECTION("Arena strings should use the heap outside of a scope") {
+    ArenaString str("this string is too long for the small string buffer");
+    REQUIRE(str.get_allocator().getArena() == nullptr);
+    REQUIRE(arena.getChunkCount() == 0);
+  }
+
+  SECTION("Arena strings should not allocate from the heap once the arena has grown") {
+    std::size_t allocations = 0;
+
+    for (int i = 0; i < 10; i++) {
+      AllocationCounter counter;
+      Arena::Scope scope(arena);
+
+      ArenaString json;
+      for (int j = 0; j < 100; j++) {
+        Util::appendJsonString(json, "a \"quoted\" string\n");
+      }
+
+      std::vector<int, ArenaAllocator<int>> numbers;
+      for (int j = 0; j < 100; j++) {
+        numbers.push_back(j);
+      }
+
+      allocations = counter.count();
+    }
+
+    REQUIRE(allocations == 0);
+  }
+}
+
+TEST_CASE("JSON strings should be escaped like nlohmann::json does", "[arena]") {
+  const std::string str("a\"b\\c\n\t\x01\x1f/\x7f", 12);
+  std::string out;
+
+  Util::appendJsonString(out, str);
+  REQUIRE(out == nlohmann::json(str).dump());
+}
+
+} // namespace eventhub
@@ -257,4 +257,13 @@ TEST_CASE("Config test") {
     }
 
   }
+
+  SECTION("Default ConfigMap loads with its own defaults") {
+    Config cfg(defaultConfigMap());
+    cfg.load();
+
+    REQUIRE(cfg.get<int>("listen_port") == 8080);
+    REQUIRE(cfg.get<std::string>("slow_consumer_policy") == "disconnect");
+    REQUIRE(cfg.get<std::string>("redis_password").empty());
+  }
 }
@@ -0,0 +1,1261 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "Arena.hpp"
+#include "Common.hpp"
+#include "Config.hpp"
+#include "Connection.hpp"
+#include "ConnectionWorker.hpp"
+#include "SSLConnection.hpp"
+#include "Server.hpp"
+#include "TestConfig.hpp"
+#include "Topic.hpp"
+#include "TopicManager.hpp"
+#include "http/Parser.hpp"
+#include "websocket/Response.hpp"
+#include "catch.hpp"
+
+using namespace eventhub;
+
+namespace eventhub {
+
+/**
+ * Runs worker thread only methods of a worker that isn't running, on the
+ * test thread, which owns it.
+ */
+struct WorkerTestAccess {
+  static ConnectionPtr addConnection(Worker& worker, int fd, struct sockaddr_in* csin, bool ssl) {
+    return worker._addConnection(fd, csin, ssl);
+  }
+
+  static void enforceOutputBudget(Worker& worker) {
+    worker._enforceOutputBudget();
+  }
+
+  static void migrateConnections(Worker& source, Worker& target, std::size_t count) {
+    source._migrateConnections(&target, count);
+  }
+
+  static void processJobs(Worker& worker) {
+    worker._ev->processJobs();
+  }
+};
+
+} // namespace eventhub
+
+namespace {
+
+/**
+ * Connected TCP socket pair over loopback. server is handed to the
+ * Connection under test, client plays the remote peer.
+ */
+struct SocketPair {
+  int server = -1;
+  int client = -1;
+  struct sockaddr_in csin;
+
+  SocketPair() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sin;
+    socklen_t sinLen = sizeof(sin);
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family      = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port        = 0;
+
+    bind(listener, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin));
+    listen(listener, 1);
+    getsockname(listener, reinterpret_cast<struct sockaddr*>(&sin), &sinLen);
+
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    connect(client, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin));
+
+    sinLen = sizeof(csin);
+    server = accept(listener, reinterpret_cast<struct sockaddr*>(&csin), &sinLen);
+    close(listener);
+
+    fcntl(client, F_SETFL, O_NONBLOCK);
+  }
+
+  ~SocketPair() {
+    if (client != -1) {
+      close(client);
+    }
+  }
+
+  // Shrink the send buffer so a large write is guaranteed to be partial.
+  void shrinkBuffers() {
+    int size = 4096;
+    setsockopt(server, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  }
+};
+
+struct TestServer {
+  Config cfg;
+  std::unique_ptr<Server> server;
+  std::unique_ptr<Worker> worker;
+
+  explicit TestServer(bool edgeTriggered, const std::string& extraConfig = "") : cfg(testConfigMap({ { "reuseport_listeners", "false" } })) {
+    cfg << (edgeTriggered ? "epoll_edge_triggered = true\n" : "epoll_edge_triggered = false\n");
+    cfg << extraConfig.c_str();
+    cfg.load();
+
+    server = std::make_unique<Server>(cfg);
+    worker = std::make_unique<Worker>(server.get(), 1);
+  }
+
+  /**
+   * Wait for the next EPOLLOUT notification for conn on the worker epoll set.
+   * Returns false if none arrives within timeoutMs.
+   */
+  bool waitWritable(Connection* conn, int timeoutMs) {
+    struct epoll_event events[8];
+    int n = epoll_wait(worker->getEpollFileDescriptor(), events, 8, timeoutMs);
+
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.ptr == conn && (events[i].events & EPOLLOUT)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // Throw away notifications that are already pending.
+  void drainEvents() {
+    struct epoll_event events[8];
+    while (epoll_wait(worker->getEpollFileDescriptor(), events, 8, 0) > 0) {
+    }
+  }
+};
+
+// HTTP request several times larger than a single read() on the connection.
+std::string largeRequest() {
+  return "GET /sub HTTP/1.1\r\nHost: localhost\r\nX-Padding: " + std::string(NET_READ_BUFFER_SIZE * 6, 'x') + "\r\n\r\n";
+}
+
+std::string largePayload() {
+  std::string payload;
+  payload.reserve(4 * 1024 * 1024);
+
+  for (std::size_t i = 0; payload.length() < 4 * 1024 * 1024; i++) {
+    payload += std::to_string(i) + ",";
+  }
+
+  return payload;
+}
+
+/**
+ * Write payload through conn and read it back on the client, flushing
+ * conn every time the worker epoll set reports it as writable.
+ * flushes is set to the number of writable notifications needed.
+ */
+template <class ReadFn>
+std::string transferLargePayload(TestServer& srv, Connection* conn, const std::string& payload, std::size_t& flushes, ReadFn clientRead) {
+  std::string received;
+  char buf[8192];
+
+  flushes = 0;
+  conn->write(payload);
+
+  while (received.length() < payload.length()) {
+    ssize_t n;
+    while ((n = clientRead(buf, sizeof(buf))) > 0) {
+      received.append(buf, n);
+    }
+
+    if (received.length() == payload.length()) {
+      break;
+    }
+
+    if (!srv.waitWritable(conn, 1000)) {
+      break;
+    }
+
+    conn->flushSendBuffer();
+    flushes++;
+  }
+
+  return received;
+}
+
+std::shared_ptr<EVP_PKEY> generateKey() {
+  return std::shared_ptr<EVP_PKEY>(EVP_RSA_gen(2048), EVP_PKEY_free);
+}
+
+std::shared_ptr<X509> generateCertificate(EVP_PKEY* key) {
+  std::shared_ptr<X509> cert(X509_new(), X509_free);
+
+  ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert.get()), 3600);
+  X509_set_pubkey(cert.get(), key);
+
+  auto name = X509_get_subject_name(cert.get());
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(cert.get(), name);
+  X509_sign(cert.get(), key, EVP_sha256());
+
+  return cert;
+}
+
+/**
+ * TLS client driving a handshake against an SSLConnection without
+ * involving the worker thread.
+ */
+struct TLSClient {
+  std::shared_ptr<EVP_PKEY> key;
+  std::shared_ptr<X509> cert;
+  std::shared_ptr<SSL_CTX> serverCtx;
+  std::shared_ptr<SSL_CTX> clientCtx;
+  std::shared_ptr<SSL> ssl;
+
+  TLSClient() {
+    key  = generateKey();
+    cert = generateCertificate(key.get());
+
+    serverCtx = std::shared_ptr<SSL_CTX>(SSL_CTX_new(TLS_server_method()), SSL_CTX_free);
+    SSL_CTX_use_certificate(serverCtx.get(), cert.get());
+    SSL_CTX_use_PrivateKey(serverCtx.get(), key.get());
+
+    clientCtx = std::shared_ptr<SSL_CTX>(SSL_CTX_new(TLS_client_method()), SSL_CTX_free);
+    SSL_CTX_set_verify(clientCtx.get(), SSL_VERIFY_NONE, nullptr);
+  }
+
+  bool handshake(int fd, Connection* conn) {
+    ssl = std::shared_ptr<SSL>(SSL_new(clientCtx.get()), SSL_free);
+    SSL_set_fd(ssl.get(), fd);
+    SSL_set_connect_state(ssl.get());
+
+    for (int i = 0; i < 20; i++) {
+      int ret = SSL_connect(ssl.get());
+
+      if (ret == 1) {
+        return true;
+      }
+
+      int err = SSL_get_error(ssl.get(), ret);
+      if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) {
+        return false;
+      }
+
+      conn->read();
+    }
+
+    return false;
+  }
+
+  bool write(const std::string& data) {
+    return SSL_write(ssl.get(), data.c_str(), data.length()) == static_cast<int>(data.length());
+  }
+
+  ssize_t read(char* buf, std::size_t len) {
+    int ret = SSL_read(ssl.get(), buf, len);
+    return ret > 0 ? ret : -1;
+  }
+};
+
+} // namespace
+
+TEST_CASE("Edge-triggered plain connections", "[connection]") {
+  TestServer srv(true);
+
+  SECTION("A single read notification should consume a request spanning several reads") {
+    SocketPair sp;
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+
+    http::RequestState lastState = http::RequestState::REQ_INCOMPLETE;
+    std::string header;
+    conn->onHTTPRequest([&](http::Parser* req, http::RequestState state) {
+      lastState = state;
+      header    = req->getHeader("x-padding");
+    });
+
+    const auto request = largeRequest();
+    REQUIRE(::write(sp.client, request.c_str(), request.length()) == static_cast<ssize_t>(request.length()));
+
+    conn->read();
+
+    REQUIRE(lastState == http::RequestState::REQ_OK);
+    REQUIRE(header.length() == NET_READ_BUFFER_SIZE * 6);
+    REQUIRE_FALSE(conn->isShutdown());
+  }
+
+  SECTION("Partial writes should resume on the next EPOLLOUT edge") {
+    SocketPair sp;
+    sp.shrinkBuffers();
+
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+    srv.drainEvents();
+
+    std::size_t flushes = 0;
+    const auto payload  = largePayload();
+    const auto received = transferLargePayload(srv, conn.get(), payload, flushes, [&](char* buf, std::size_t len) {
+      return ::read(sp.client, buf, len);
+    });
+
+    REQUIRE(received.length() == payload.length());
+    REQUIRE(received == payload);
+    REQUIRE(flushes > 0);
+    REQUIRE_FALSE(conn->isShutdown());
+  }
+
+  SECTION("Peer closing the connection should shut it down") {
+    SocketPair sp;
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+
+    close(sp.client);
+    sp.client = -1;
+
+    conn->read();
+    REQUIRE(conn->isShutdown());
+  }
+}
+
+TEST_CASE("Level-triggered plain connections", "[connection]") {
+  TestServer srv(false);
+
+  SECTION("A read should consume at most one buffer") {
+    SocketPair sp;
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+
+    http::RequestState lastState = http::RequestState::REQ_INCOMPLETE;
+    conn->onHTTPRequest([&](http::Parser* req, http::RequestState state) {
+      lastState = state;
+    });
+
+    const auto request = largeRequest();
+    REQUIRE(::write(sp.client, request.c_str(), request.length()) == static_cast<ssize_t>(request.length()));
+
+    conn->read();
+    REQUIRE(lastState == http::RequestState::REQ_INCOMPLETE);
+
+    for (int i = 0; i < 10 && lastState == http::RequestState::REQ_INCOMPLETE; i++) {
+      conn->read();
+    }
+
+    REQUIRE(lastState == http::RequestState::REQ_OK);
+  }
+
+  SECTION("Partial writes should resume when EPOLLOUT is reported") {
+    SocketPair sp;
+    sp.shrinkBuffers();
+
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+
+    std::size_t flushes = 0;
+    const auto payload  = largePayload();
+    const auto received = transferLargePayload(srv, conn.get(), payload, flushes, [&](char* buf, std::size_t len) {
+      return ::read(sp.client, buf, len);
+    });
+
+    REQUIRE(received == payload);
+    REQUIRE(flushes > 0);
+  }
+}
+
+TEST_CASE("Edge-triggered TLS connections", "[connection]") {
+  TestServer srv(true);
+  TLSClient tls;
+
+  SECTION("A single read notification should consume a request spanning several TLS records") {
+    SocketPair sp;
+    auto conn = std::make_shared<SSLConnection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg, tls.serverCtx.get());
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+
+    http::RequestState lastState = http::RequestState::REQ_INCOMPLETE;
+    std::string header;
+    conn->onHTTPRequest([&](http::Parser* req, http::RequestState state) {
+      lastState = state;
+      header    = req->getHeader("x-padding");
+    });
+
+    REQUIRE(tls.handshake(sp.client, conn.get()));
+
+    // Split the request over several records.
+    const auto request = largeRequest();
+    for (std::size_t offset = 0; offset < request.length(); offset += 1000) {
+      REQUIRE(tls.write(request.substr(offset, 1000)));
+    }
+
+    conn->read();
+
+    REQUIRE(lastState == http::RequestState::REQ_OK);
+    REQUIRE(header.length() == NET_READ_BUFFER_SIZE * 6);
+    REQUIRE_FALSE(conn->isShutdown());
+  }
+
+  SECTION("A handshake that can't write should resume on the next EPOLLOUT edge") {
+    // A certificate chain that doesn't fit in the socket buffers.
+    for (int i = 0; i < 40; i++) {
+      SSL_CTX_add_extra_chain_cert(tls.serverCtx.get(), X509_dup(tls.cert.get()));
+    }
+
+    SocketPair sp;
+    sp.shrinkBuffers();
+
+    int size = 4096;
+    setsockopt(sp.client, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    auto conn = std::make_shared<SSLConnection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg, tls.serverCtx.get());
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+
+    auto client = std::shared_ptr<SSL>(SSL_new(tls.clientCtx.get()), SSL_free);
+    SSL_set_fd(client.get(), sp.client);
+    SSL_set_connect_state(client.get());
+
+    // The client hello is the only read notification the server gets.
+    REQUIRE(SSL_connect(client.get()) <= 0);
+    conn->read();
+    srv.drainEvents();
+
+    bool connected = false;
+    for (int i = 0; i < 100 && !connected && !conn->isShutdown(); i++) {
+      connected = SSL_connect(client.get()) == 1;
+
+      if (!connected && srv.waitWritable(conn.get(), 1000)) {
+        conn->flushSendBuffer();
+      }
+    }
+
+    REQUIRE(connected);
+    REQUIRE_FALSE(conn->isShutdown());
+  }
+
+  SECTION("Partial TLS writes should resume on the next EPOLLOUT edge") {
+    SocketPair sp;
+    sp.shrinkBuffers();
+
+    auto conn = std::make_shared<SSLConnection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg, tls.serverCtx.get());
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+    REQUIRE(tls.handshake(sp.client, conn.get()));
+    srv.drainEvents();
+
+    std::size_t flushes = 0;
+    const auto payload  = largePayload();
+    const auto received = transferLargePayload(srv, conn.get(), payload, flushes, [&](char* buf, std::size_t len) {
+      return tls.read(buf, len);
+    });
+
+    REQUIRE(received.length() == payload.length());
+    REQUIRE(received == payload);
+    REQUIRE(flushes > 0);
+    REQUIRE_FALSE(conn->isShutdown());
+  }
+
+  SECTION("A single TLS write should reach the client without further socket events") {
+    SocketPair sp;
+    auto conn = std::make_shared<SSLConnection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg, tls.serverCtx.get());
+    REQUIRE(conn->addToEpoll(EPOLLIN | EPOLLRDHUP) == 0);
+    REQUIRE(tls.handshake(sp.client, conn.get()));
+    srv.drainEvents();
+
+    conn->write("hello");
+
+    std::string received;
+    char buf[64];
+    for (int i = 0; i < 100 && received.length() < 5; i++) {
+      struct pollfd pfd = {sp.client, POLLIN, 0};
+      poll(&pfd, 1, 10);
+
+      ssize_t n;
+      while ((n = tls.read(buf, sizeof(buf))) > 0) {
+        received.append(buf, n);
+      }
+    }
+
+    REQUIRE(received == "hello");
+    REQUIRE(conn->getOutputBytes() == 0);
+  }
+}
+
+TEST_CASE("Topic fan-out to websocket connections", "[topic]") {
+  TestServer srv(false);
+  auto tm = srv.worker->getTopicManager();
+
+  const std::string topic   = "fanout/test";
+  const std::string message = "{\"id\": \"1\", \"message\": \"hello\"}";
+
+  std::vector<std::unique_ptr<SocketPair>> pairs;
+  std::vector<ConnectionPtr> conns;
+
+  for (int i = 0; i < 6; i++) {
+    pairs.push_back(std::make_unique<SocketPair>());
+    conns.push_back(std::make_shared<Connection>(pairs.back()->server, &pairs.back()->csin, srv.worker.get(), srv.cfg));
+    conns.back()->setState(ConnectionState::WEBSOCKET);
+    conns.back()->subscribe(topic, jsonrpcpp::Id(i));
+  }
+
+  // Read what the client end of a connection received, without the 2 byte frame header.
+  auto received = [&](int i) {
+    char buf[4096];
+    std::string data;
+    ssize_t n;
+
+    while ((n = ::read(pairs[i]->client, buf, sizeof(buf))) > 0) {
+      data.append(buf, n);
+    }
+
+    return data.empty() ? data : data.substr(2);
+  };
+
+  auto expected = [&](int i) {
+    return jsonrpcpp::Response(jsonrpcpp::Id(i), nlohmann::json::parse(message)).to_json().dump();
+  };
+
+  SECTION("Every subscriber should receive the same JSONRPC response as before") {
+    tm->publish(InternedTopic(topic), message);
+    FanoutBudget budget(0, std::chrono::microseconds(0));
+    REQUIRE_FALSE(tm->processFanout(budget));
+
+    for (int i = 0; i < 6; i++) {
+      REQUIRE(received(i) == expected(i));
+    }
+  }
+
+  SECTION("Unsubscribing during a fan-out should not skip or repeat anyone") {
+    tm->publish(InternedTopic(topic), message);
+
+    FanoutBudget firstBudget(3, std::chrono::microseconds(0));
+    REQUIRE(tm->processFanout(firstBudget));
+
+    // One that already has the message and one that hasn't.
+    REQUIRE(conns[0]->unsubscribe(topic));
+    REQUIRE(conns[5]->unsubscribe(topic));
+
+    FanoutBudget secondBudget(0, std::chrono::microseconds(0));
+    REQUIRE_FALSE(tm->processFanout(secondBudget));
+
+    for (int i = 0; i < 5; i++) {
+      REQUIRE(received(i) == expected(i));
+    }
+
+    REQUIRE(received(5).empty());
+  }
+
+  SECTION("Filter subscribers should receive what is published to matching topics") {
+    REQUIRE(conns[1]->unsubscribe(topic));
+    conns[1]->subscribe("fanout/+", jsonrpcpp::Id(1));
+    REQUIRE(conns[1]->listSubscriptions() == std::vector<std::string>{"fanout/+"});
+
+    tm->publish(InternedTopic("other/test"), message);
+    REQUIRE_FALSE(tm->hasPendingFanout());
+
+    tm->publish(InternedTopic(topic), message);
+    FanoutBudget budget(0, std::chrono::microseconds(0));
+    REQUIRE_FALSE(tm->processFanout(budget));
+
+    for (int i = 0; i < 6; i++) {
+      REQUIRE(received(i) == expected(i));
+    }
+  }
+
+  SECTION("Handles should stay valid as subscribers move") {
+    REQUIRE(conns[2]->unsubscribe(topic));
+    REQUIRE(conns[0]->unsubscribe(topic));
+    conns[2]->subscribe(topic, jsonrpcpp::Id(2));
+    REQUIRE(tm->getSubscriptionCount() == 5);
+
+    for (int i = 5; i >= 1; i--) {
+      REQUIRE(conns[i]->unsubscribe(topic));
+    }
+
+    REQUIRE(tm->getSubscriptionCount() == 0);
+  }
+}
+
+// Payloads of the websocket frames in data, which must hold whole frames of less than 64 KB.
+std::vector<std::string> websocketFrames(const std::string& data) {
+  std::vector<std::string> frames;
+  std::size_t pos = 0;
+
+  while (pos + 2 <= data.length()) {
+    std::size_t length = static_cast<unsigned char>(data[pos + 1]) & 0x7F;
+    std::size_t header = 2;
+
+    if (length == 126) {
+      length = (static_cast<unsigned char>(data[pos + 2]) << 8) | static_cast<unsigned char>(data[pos + 3]);
+      header = 4;
+    }
+
+    frames.push_back(data.substr(pos + header, length));
+    pos += header + length;
+  }
+
+  return frames;
+}
+
+TEST_CASE("Fan-out queue with subscribers", "[topic]") {
+  TestServer srv(false);
+  auto tm = srv.worker->getTopicManager();
+
+  std::vector<std::unique_ptr<SocketPair>> pairs;
+  std::vector<ConnectionPtr> conns;
+
+  auto connect = [&](const std::string& topic) {
+    pairs.push_back(std::make_unique<SocketPair>());
+    conns.push_back(std::make_shared<Connection>(pairs.back()->server, &pairs.back()->csin, srv.worker.get(), srv.cfg));
+    conns.back()->setState(ConnectionState::WEBSOCKET);
+    conns.back()->subscribe(topic, jsonrpcpp::Id(static_cast<int>(conns.size())));
+  };
+
+  // IDs of the messages the client end of a connection received.
+  auto received = [&](std::size_t i) {
+    char buf[8192];
+    std::string data;
+    ssize_t n;
+
+    while ((n = ::read(pairs[i]->client, buf, sizeof(buf))) > 0) {
+      data.append(buf, n);
+    }
+
+    std::vector<std::string> ids;
+    for (const auto& frame : websocketFrames(data)) {
+      ids.push_back(nlohmann::json::parse(frame)["result"]["id"]);
+    }
+
+    return ids;
+  };
+
+  auto publish = [&](const std::string& topic, const std::string& id) {
+    tm->publish(InternedTopic(topic), "{\"id\": \"" + id + "\", \"message\": \"hello\"}");
+  };
+
+  SECTION("A fan-out spread over several budgets should reach every subscriber once") {
+    for (int i = 0; i < 10; i++) {
+      connect("queue/a");
+    }
+
+    publish("queue/a", "1");
+
+    std::size_t yields = 0;
+    for (;;) {
+      FanoutBudget budget(3, std::chrono::microseconds(0));
+      if (!tm->processFanout(budget)) {
+        break;
+      }
+
+      REQUIRE(budget.delivered() == 3);
+      yields++;
+    }
+
+    REQUIRE(yields == 3);
+    for (std::size_t i = 0; i < conns.size(); i++) {
+      REQUIRE(received(i) == std::vector<std::string>{"1"});
+    }
+  }
+
+  SECTION("Messages of a topic should arrive in publish order") {
+    connect("queue/a");
+    connect("queue/+");
+
+    for (int i = 0; i < 5; i++) {
+      publish("queue/a", std::to_string(i));
+    }
+
+    REQUIRE(tm->getPendingFanoutCount() == 10);
+
+    while (true) {
+      FanoutBudget budget(1, std::chrono::microseconds(0));
+      if (!tm->processFanout(budget)) {
+        break;
+      }
+    }
+
+    const std::vector<std::string> expected{"0", "1", "2", "3", "4"};
+    REQUIRE(received(0) == expected);
+    REQUIRE(received(1) == expected);
+  }
+
+  SECTION("A connection should receive messages in publish order across its subscriptions") {
+    for (int i = 0; i < 10; i++) {
+      connect("queue/large");
+    }
+
+    conns.back()->subscribe("queue/small", jsonrpcpp::Id(100));
+    connect("queue/small");
+
+    publish("queue/large", "1");
+    publish("queue/small", "2");
+
+    // The first fan-out is cut before it reaches the connection on both topics,
+    // so the second message must wait for it.
+    FanoutBudget budget(5, std::chrono::microseconds(0));
+    REQUIRE(tm->processFanout(budget));
+    REQUIRE(received(9).empty());
+    REQUIRE(received(10).empty());
+
+    FanoutBudget rest(0, std::chrono::microseconds(0));
+    REQUIRE_FALSE(tm->processFanout(rest));
+    REQUIRE(received(9) == std::vector<std::string>{"1", "2"});
+    REQUIRE(received(10) == std::vector<std::string>{"2"});
+  }
+
+  SECTION("A full queue should be drained before more is queued") {
+    connect("queue/a");
+
+    for (std::size_t i = 0; i < FANOUT_QUEUE_MAX_MESSAGES + 10; i++) {
+      publish("queue/a", "1");
+    }
+
+    REQUIRE(tm->getPendingFanoutCount() <= FANOUT_QUEUE_MAX_MESSAGES);
+    REQUIRE(tm->hasPendingFanout());
+  }
+}
+
+TEST_CASE("Requests without a callback of their own go to the worker", "[connection]") {
+  TestServer srv(false);
+  SocketPair sp;
+  auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+
+  auto response = [&]() {
+    char buf[4096];
+    std::string data;
+    ssize_t n;
+
+    while ((n = ::read(sp.client, buf, sizeof(buf))) > 0) {
+      data.append(buf, n);
+    }
+
+    return data;
+  };
+
+  const std::string handshake = "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                                "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  REQUIRE(::write(sp.client, handshake.c_str(), handshake.length()) == static_cast<ssize_t>(handshake.length()));
+  conn->read();
+
+  REQUIRE(conn->getState() == ConnectionState::WEBSOCKET);
+  REQUIRE(response().find("HTTP/1.1 101") == 0);
+
+  // Masked text frame carrying a subscribe request.
+  const std::string rpc = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"subscribe\",\"params\":{\"topic\":\"test/topic\"}}";
+  const char mask[4]    = {1, 2, 3, 4};
+  std::string frame     = {static_cast<char>(0x81), static_cast<char>(0x80 | rpc.length())};
+  frame.append(mask, sizeof(mask));
+  for (std::size_t i = 0; i < rpc.length(); i++) {
+    frame += rpc[i] ^ mask[i % 4];
+  }
+
+  REQUIRE(::write(sp.client, frame.c_str(), frame.length()) == static_cast<ssize_t>(frame.length()));
+  conn->read();
+
+  REQUIRE(conn->listSubscriptions() == std::vector<std::string>{"test/topic"});
+  REQUIRE(response().find("\"status\":\"ok\"") != std::string::npos);
+  REQUIRE(conn->unsubscribeAll() == 1);
+}
+
+TEST_CASE("Websocket responses should not allocate once the worker arena has grown", "[connection]") {
+  TestServer srv(false);
+  SocketPair sp;
+  auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+
+  const std::string result = "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":{\"action\":\"publish\",\"status\":\"ok\"}}";
+  std::size_t allocations  = 0;
+  char buf[4096];
+
+  for (int i = 0; i < 10; i++) {
+    {
+      AllocationCounter counter;
+      Arena::Scope scope(srv.worker->getRPCArena());
+
+      websocket::Response::sendData(conn.get(), result.c_str(), result.length(), websocket::FrameType::TEXT_FRAME);
+      allocations = counter.count();
+    }
+
+    REQUIRE(::read(sp.client, buf, sizeof(buf)) == static_cast<ssize_t>(result.length() + 2));
+    REQUIRE(std::string(buf + 2, result.length()) == result);
+  }
+
+  REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Repeated subscribe requests should not allocate once warmed up", "[connection]") {
+  TestServer srv(false);
+  SocketPair sp;
+  auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+
+  const std::string rpc = R"({"jsonrpc":"2.0","id":1,"method":"subscribe","params":{"topic":"a/b"}})";
+  const std::string result = R"({"id":1,"jsonrpc":"2.0","result":{"action":"subscribe","status":"ok","topic":"a/b"}})";
+  std::size_t allocations  = 0;
+  char buf[4096];
+
+  for (int i = 0; i < 10; i++) {
+    {
+      AllocationCounter counter;
+      srv.worker->handleWebsocketRequest(conn, websocket::ParserStatus::PARSER_OK, websocket::FrameType::TEXT_FRAME, rpc);
+      allocations = counter.count();
+    }
+
+    REQUIRE(::read(sp.client, buf, sizeof(buf)) == static_cast<ssize_t>(result.length() + 2));
+    REQUIRE(std::string(buf + 2, result.length()) == result);
+  }
+
+  REQUIRE(allocations == 0);
+}
+
+/**
+ * A websocket subscriber that doesn't read, with a small high watermark.
+ */
+struct SlowConsumer {
+  TestServer srv;
+  SocketPair sp;
+  ConnectionPtr conn;
+
+  explicit SlowConsumer(const std::string& policy, const std::string& extraConfig = "") :
+    srv(false, "slow_consumer_policy = " + policy + "\nslow_consumer_high_watermark = 16384\n" + extraConfig) {
+    sp.shrinkBuffers();
+
+    int size = 4096;
+    setsockopt(sp.client, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+    conn->setState(ConnectionState::WEBSOCKET);
+    conn->subscribe("slow/#", jsonrpcpp::Id(1));
+  }
+
+  // Publish count messages of about 1 KB, round robin to the given number of topics.
+  void publish(int count, int topics = 1) {
+    auto tm = srv.worker->getTopicManager();
+
+    for (int i = 0; i < count; i++) {
+      const auto message = "{\"id\": \"" + std::to_string(i) + "\", \"message\": \"" + std::string(1000, 'x') + "\"}";
+      tm->publish(InternedTopic("slow/" + std::to_string(i % topics)), message);
+
+      FanoutBudget budget(0, std::chrono::microseconds(0));
+      tm->processFanout(budget);
+    }
+  }
+
+  // Let the client catch up and return the payloads of the frames it got.
+  std::vector<std::string> drain() {
+    std::string raw;
+    char buf[8192];
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    auto readAll = [&]() {
+      ssize_t n;
+      while ((n = ::read(sp.client, buf, sizeof(buf))) > 0) {
+        raw.append(buf, n);
+      }
+    };
+
+    while (std::chrono::steady_clock::now() < deadline) {
+      readAll();
+      conn->flushSendBuffer();
+
+      // Done once neither the connection nor the kernel holds anything for
+      // the client. With small buffers the kernel may sit on the tail until
+      // a window probe, so keep waiting for that too.
+      int unacked = 0;
+      ioctl(sp.server, SIOCOUTQ, &unacked);
+
+      if (conn->isShutdown() || (conn->getOutputBytes() == 0 && unacked == 0)) {
+        break;
+      }
+
+      struct pollfd pfd = {sp.client, POLLIN, 0};
+      poll(&pfd, 1, 10);
+    }
+
+    readAll();
+    return websocketFrames(raw);
+  }
+};
+
+// IDs of the published messages among the frames.
+std::vector<int> messageIds(const std::vector<std::string>& frames) {
+  std::vector<int> ids;
+
+  for (const auto& frame : frames) {
+    auto j = nlohmann::json::parse(frame);
+    if (j.contains("result")) {
+      ids.push_back(std::stoi(j["result"]["id"].get<std::string>()));
+    }
+  }
+
+  return ids;
+}
+
+TEST_CASE("Slow consumer policies", "[connection]") {
+  SECTION("disconnect should shut down a client that reaches the high watermark") {
+    SlowConsumer slow("disconnect");
+    slow.publish(1000);
+
+    REQUIRE(slow.conn->isShutdown());
+    REQUIRE(slow.srv.worker->getMetrics().slow_consumer_disconnect_count == 1);
+  }
+
+  SECTION("drop_oldest should keep the newest messages in order") {
+    SlowConsumer slow("drop_oldest");
+    slow.publish(1000);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+
+    const auto dropped = slow.srv.worker->getMetrics().slow_consumer_dropped_count.load();
+    const auto ids     = messageIds(slow.drain());
+
+    REQUIRE(dropped > 0);
+    REQUIRE(ids.size() + dropped == 1000);
+    REQUIRE(ids.back() == 999);
+    REQUIRE(std::is_sorted(ids.begin(), ids.end()));
+    REQUIRE(slow.srv.worker->getSlowConsumerTopicMetrics().empty());
+    slow.srv.worker->publishSlowConsumerTopicMetrics();
+    REQUIRE(slow.srv.worker->getSlowConsumerTopicMetrics().at("slow/0").dropped == dropped);
+  }
+
+  SECTION("conflate should keep the latest message of each topic") {
+    SlowConsumer slow("conflate");
+    slow.publish(1000, 4);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+
+    const auto& metrics = slow.srv.worker->getMetrics();
+    const auto ids      = messageIds(slow.drain());
+
+    REQUIRE(metrics.slow_consumer_conflated_count > 0);
+    REQUIRE(metrics.slow_consumer_dropped_count == 0);
+    REQUIRE(ids.size() + metrics.slow_consumer_conflated_count == 1000);
+
+    // A conflated message takes the place of the one it replaces in the queue.
+    std::vector<int> latest(ids.end() - 4, ids.end());
+    std::sort(latest.begin(), latest.end());
+    REQUIRE(latest == std::vector<int>{996, 997, 998, 999});
+  }
+
+  SECTION("conflate should keep the latest message of each overlapping subscription") {
+    SlowConsumer slow("conflate");
+    slow.conn->subscribe("slow/0", jsonrpcpp::Id(2));
+    slow.publish(1000);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+
+    std::vector<int> wildcard, exact;
+    for (const auto& frame : slow.drain()) {
+      auto j = nlohmann::json::parse(frame);
+      if (j.contains("result")) {
+        (j["id"] == 1 ? wildcard : exact).push_back(std::stoi(j["result"]["id"].get<std::string>()));
+      }
+    }
+
+    // Each subscription gets the latest message instead of one replacing the other.
+    REQUIRE_FALSE(wildcard.empty());
+    REQUIRE_FALSE(exact.empty());
+    REQUIRE(wildcard.back() == 999);
+    REQUIRE(exact.back() == 999);
+    REQUIRE(slow.srv.worker->getMetrics().slow_consumer_conflated_count > 0);
+  }
+
+  SECTION("pause should tell the client what it missed when it has caught up") {
+    SlowConsumer slow("pause");
+    slow.publish(1000);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+
+    const auto frames  = slow.drain();
+    const auto ids     = messageIds(frames);
+    const auto dropped = slow.srv.worker->getMetrics().slow_consumer_dropped_count.load();
+
+    REQUIRE(dropped > 0);
+    REQUIRE(ids.size() + dropped == 1000);
+
+    auto gap = nlohmann::json::parse(frames.back());
+    REQUIRE(gap["method"] == "gap");
+    REQUIRE(gap["params"]["dropped"] == dropped);
+    REQUIRE(gap["params"]["topics"] == nlohmann::json::array({"slow/0"}));
+    REQUIRE(slow.srv.worker->getMetrics().slow_consumer_resume_count == 1);
+  }
+
+  SECTION("A client just below the high watermark should take a large message") {
+    // The high watermark is capped to leave room for a message below the write buffer limit.
+    SlowConsumer slow("drop_oldest", "slow_consumer_high_watermark = " + std::to_string(NET_WRITE_BUFFER_MAX) + "\n");
+    const auto highWatermark = slow.srv.worker->getSlowConsumerHighWatermark();
+    REQUIRE(highWatermark + SLOW_CONSUMER_WATERMARK_HEADROOM <= NET_WRITE_BUFFER_MAX);
+
+    auto publish = [&slow](std::size_t size) {
+      auto tm = slow.srv.worker->getTopicManager();
+      tm->publish(InternedTopic("slow/0"), "{\"id\": \"0\", \"message\": \"" + std::string(size, 'x') + "\"}");
+
+      FanoutBudget budget(0, std::chrono::microseconds(0));
+      tm->processFanout(budget);
+    };
+
+    while (slow.conn->getOutputBytes() + 64 * 1024 < highWatermark) {
+      publish(32 * 1024);
+    }
+
+    REQUIRE(slow.conn->getOutputBytes() < highWatermark);
+
+    publish(SLOW_CONSUMER_WATERMARK_HEADROOM / 2);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+    REQUIRE(slow.conn->getOutputBytes() >= highWatermark);
+
+    // The client now lags, and the policy queues the next one instead of
+    // the write buffer overflowing.
+    publish(SLOW_CONSUMER_WATERMARK_HEADROOM / 2);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+    REQUIRE(slow.conn->getOutputBytes() > highWatermark + SLOW_CONSUMER_WATERMARK_HEADROOM / 2);
+  }
+}
+
+TEST_CASE("Socket profiles", "[connection]") {
+  SocketPair sp;
+  int value;
+  socklen_t len = sizeof(value);
+
+  SECTION("The default profile should leave the socket to the kernel") {
+    TestServer srv(false);
+    int notSentLowat = 0;
+
+    getsockopt(sp.server, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &notSentLowat, &len);
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+
+    REQUIRE(getsockopt(sp.server, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value, &len) == 0);
+    REQUIRE(value == notSentLowat);
+  }
+
+  SECTION("The latency profile should cap unsent data and the send buffer") {
+    TestServer srv(false, "socket_profile = latency\ntcp_notsent_lowat = 8192\nsocket_sndbuf = 65536\n");
+    auto conn = std::make_shared<Connection>(sp.server, &sp.csin, srv.worker.get(), srv.cfg);
+
+    REQUIRE(getsockopt(sp.server, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value, &len) == 0);
+    REQUIRE(value == 8192);
+
+    // The kernel doubles SO_SNDBUF for its own bookkeeping.
+    REQUIRE(getsockopt(sp.server, SOL_SOCKET, SO_SNDBUF, &value, &len) == 0);
+    REQUIRE(value == 2 * 65536);
+  }
+
+  SECTION("A stalled client on the latency profile should trigger the slow consumer policy") {
+    // A send buffer the kernel could hide the whole backlog in, if not for
+    // tcp_notsent_lowat.
+    SlowConsumer slow("disconnect", "socket_profile = latency\ntcp_notsent_lowat = 4096\nsocket_sndbuf = 1048576\n");
+
+    // Once the kernel holds tcp_notsent_lowat bytes it takes no more, and
+    // the rest waits in the write buffer.
+    for (int i = 0; i < 100 && slow.conn->getOutputBytes() == 0; i++) {
+      slow.publish(1);
+    }
+
+    REQUIRE(slow.conn->getOutputBytes() > 0);
+    REQUIRE_FALSE(slow.conn->isShutdown());
+
+    // The kernel may overshoot by the segment it was still filling, but
+    // nowhere near the send buffer.
+    int unsent = 0;
+    REQUIRE(ioctl(slow.sp.server, SIOCOUTQNSD, &unsent) == 0);
+    REQUIRE(unsent <= 65536);
+
+    slow.publish(100);
+    REQUIRE(slow.conn->isShutdown());
+    REQUIRE(slow.srv.worker->getMetrics().slow_consumer_disconnect_count == 1);
+  }
+
+  SECTION("The SSL listener should use its own profile when it has one") {
+    TestServer srv(false, "ssl_socket_profile = latency\n");
+    REQUIRE(srv.worker->getSocketProfile(false) == SocketProfile::DEFAULT);
+    REQUIRE(srv.worker->getSocketProfile(true) == SocketProfile::LATENCY);
+  }
+}
+
+TEST_CASE("Output accounting", "[connection]") {
+  SlowConsumer slow("drop_oldest");
+  const auto& metrics = slow.srv.worker->getMetrics();
+
+  SECTION("The worker should count what is waiting to be sent") {
+    slow.publish(1000);
+    REQUIRE(metrics.output_bytes > 0);
+    REQUIRE(metrics.output_bytes == slow.conn->getOutputBytes());
+
+    slow.drain();
+    REQUIRE(metrics.output_bytes == 0);
+  }
+
+  SECTION("Shedding should free the output and disconnect the client") {
+    slow.publish(1000);
+    const auto bytes = slow.conn->getOutputBytes();
+
+    REQUIRE(slow.conn->shedOutput() == bytes);
+    REQUIRE(slow.conn->isShutdown());
+    REQUIRE(metrics.output_bytes == 0);
+  }
+
+  SECTION("Closed connections should no longer count") {
+    slow.publish(1000);
+    slow.conn.reset();
+    REQUIRE(metrics.output_bytes == 0);
+  }
+}
+
+TEST_CASE("Output budget", "[connection]") {
+  SECTION("Each worker should shed its share of the excess over the process budget") {
+    // Within budget.
+    REQUIRE(Worker::getOutputBudgetExcess(1000, 3000, 0, 4000) == 0);
+    REQUIRE(Worker::getOutputBudgetExcess(1000, 3000, 2000, 0) == 0);
+
+    // 2000 bytes over the process budget, shared by what each worker holds.
+    REQUIRE(Worker::getOutputBudgetExcess(1500, 3000, 0, 1000) == 1000);
+    REQUIRE(Worker::getOutputBudgetExcess(500, 3000, 0, 1000) == 334);
+    REQUIRE(Worker::getOutputBudgetExcess(0, 3000, 0, 1000) == 0);
+
+    // The worker budget applies when it asks for more.
+    REQUIRE(Worker::getOutputBudgetExcess(1500, 3000, 200, 1000) == 1300);
+    REQUIRE(Worker::getOutputBudgetExcess(1500, 3000, 1400, 1000) == 1000);
+  }
+
+  SECTION("The largest and then the oldest backlogs should be shed first") {
+    TestServer srv(false, "slow_consumer_policy = disconnect\nslow_consumer_high_watermark = 16384\noutput_budget_worker_bytes = 8000\n");
+    std::vector<std::unique_ptr<SocketPair>> pairs;
+    std::vector<ConnectionPtr> conns;
+    const std::string junk(4096, 'x');
+
+    // Clients that don't read, with socket buffers that are already full,
+    // so everything published to them stays in their write buffer.
+    for (const char* topic : {"out/a", "out/b", "out/c", "out/d"}) {
+      pairs.push_back(std::make_unique<SocketPair>());
+      auto conn = WorkerTestAccess::addConnection(*srv.worker, pairs.back()->server, &pairs.back()->csin, false);
+      REQUIRE(conn != nullptr);
+
+      int rcvbuf = 4096;
+      pairs.back()->shrinkBuffers();
+      setsockopt(pairs.back()->client, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+      // Until the kernel takes nothing more even after a pause.
+      for (bool wrote = true; wrote;) {
+        wrote = false;
+
+        while (::write(pairs.back()->server, junk.data(), junk.size()) > 0) {
+          wrote = true;
+        }
+
+        usleep(5000);
+      }
+
+      conn->setState(ConnectionState::WEBSOCKET);
+      conn->subscribe(topic, jsonrpcpp::Id(1));
+      conns.push_back(conn);
+    }
+
+    auto publish = [&](const char* topic, int count) {
+      auto tm = srv.worker->getTopicManager();
+
+      for (int i = 0; i < count; i++) {
+        tm->publish(InternedTopic(topic), "{\"id\": \"" + std::to_string(i) + "\", \"message\": \"" + std::string(1000, 'x') + "\"}");
+
+        FanoutBudget budget(0, std::chrono::microseconds(0));
+        tm->processFanout(budget);
+      }
+    };
+
+    // c and d hold the same, c since earlier.
+    publish("out/a", 12);
+    publish("out/b", 8);
+    publish("out/c", 5);
+    usleep(1000);
+    publish("out/d", 5);
+
+    REQUIRE(conns[2]->getOutputBytes() == conns[3]->getOutputBytes());
+    REQUIRE(conns[3]->getOutputBytes() >= srv.worker->getSlowConsumerHighWatermark() / OUTPUT_BUDGET_WATERMARK_DIVISOR);
+    REQUIRE_FALSE(srv.worker->isOverOutputBudget());
+
+    WorkerTestAccess::enforceOutputBudget(*srv.worker);
+
+    REQUIRE(conns[0]->isShutdown());
+    REQUIRE(conns[1]->isShutdown());
+    REQUIRE(conns[2]->isShutdown());
+    REQUIRE_FALSE(conns[3]->isShutdown());
+    REQUIRE(srv.worker->getMetrics().output_budget_shed_count == 3);
+    REQUIRE(srv.worker->getMetrics().output_bytes == conns[3]->getOutputBytes());
+
+    // While over budget, a client lags at a fraction of the high watermark.
+    REQUIRE(srv.worker->isOverOutputBudget());
+    publish("out/d", 1);
+    REQUIRE(conns[3]->isShutdown());
+    REQUIRE(srv.worker->getMetrics().slow_consumer_disconnect_count == 1);
+
+    // The next check finds the worker within budget and lifts the throttle.
+    WorkerTestAccess::enforceOutputBudget(*srv.worker);
+    REQUIRE_FALSE(srv.worker->isOverOutputBudget());
+  }
+}
+
+TEST_CASE("Migration during a fan-out", "[connection]") {
+  TestServer srv(false);
+  auto target = std::make_unique<Worker>(srv.server.get(), 2);
+  auto tm     = srv.worker->getTopicManager();
+
+  std::vector<std::unique_ptr<SocketPair>> pairs;
+  std::vector<ConnectionPtr> conns;
+
+  // The first subscriber is the one that moves, the others stay.
+  for (int i = 0; i < 10; i++) {
+    pairs.push_back(std::make_unique<SocketPair>());
+    auto conn = std::make_shared<Connection>(pairs.back()->server, &pairs.back()->csin, srv.worker.get(), srv.cfg);
+
+    if (i == 0) {
+      conn = WorkerTestAccess::addConnection(*srv.worker, pairs.back()->server, &pairs.back()->csin, false);
+    }
+
+    conn->setState(ConnectionState::WEBSOCKET);
+    conn->subscribe("mig/a", jsonrpcpp::Id(1));
+    conns.push_back(conn);
+  }
+
+  auto batch = std::make_shared<PublishBatch>();
+  for (uint64_t seq = 1; seq <= 3; seq++) {
+    batch->push_back({InternedTopic("mig/a"), "{\"id\": \"" + std::to_string(seq) + "\", \"message\": \"hello\"}", seq});
+  }
+
+  srv.worker->publishBatch(batch);
+  target->publishBatch(batch);
+  WorkerTestAccess::processJobs(*srv.worker);
+  WorkerTestAccess::processJobs(*target);
+
+  // The first message has reached half of the subscribers, the migrating one among them.
+  FanoutBudget budget(5, std::chrono::microseconds(0));
+  REQUIRE(tm->processFanout(budget));
+
+  WorkerTestAccess::migrateConnections(*srv.worker, *target, 1);
+  REQUIRE(srv.worker->getMetrics().total_migrated_count == 1);
+
+  WorkerTestAccess::processJobs(*target);
+  REQUIRE(target->getMetrics().current_connections_count == 1);
+
+  FanoutBudget rest(0, std::chrono::microseconds(0));
+  REQUIRE_FALSE(tm->processFanout(rest));
+
+  // Each connection should have every message exactly once, in order.
+  for (std::size_t i = 0; i < pairs.size(); i++) {
+    char buf[8192];
+    std::string data;
+    ssize_t n;
+
+    while ((n = ::read(pairs[i]->client, buf, sizeof(buf))) > 0) {
+      data.append(buf, n);
+    }
+
+    REQUIRE(messageIds(websocketFrames(data)) == std::vector<int>{1, 2, 3});
+  }
+}
@@ -0,0 +1,30 @@
+#include <string>
+
+#include "CpuTopology.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+TEST_CASE("CpuTopology test", "[cpu_topology]") {
+  SECTION("Parse cgroup v2 cpu.max") {
+    REQUIRE(CpuTopology::parseCgroupV2CpuMax("max 100000\n") == 0);
+    REQUIRE(CpuTopology::parseCgroupV2CpuMax("800000 100000\n") == 8000);
+    REQUIRE(CpuTopology::parseCgroupV2CpuMax("150000 100000") == 1500);
+    REQUIRE(CpuTopology::parseCgroupV2CpuMax("") == 0);
+  }
+
+  SECTION("Parse cgroup v1 quota") {
+    REQUIRE(CpuTopology::parseCgroupV1CpuQuota("-1\n", "100000\n") == 0);
+    REQUIRE(CpuTopology::parseCgroupV1CpuQuota("200000\n", "100000\n") == 2000);
+    REQUIRE(CpuTopology::parseCgroupV1CpuQuota("50000", "100000") == 500);
+    REQUIRE(CpuTopology::parseCgroupV1CpuQuota("garbage", "100000") == 0);
+  }
+
+  SECTION("Default worker count should be within the affinity mask") {
+    const auto count = CpuTopology::getDefaultWorkerCount();
+    REQUIRE(count >= 1);
+    REQUIRE(count <= CpuTopology::getAllowedCpus().size());
+  }
+}
+
+} // namespace eventhub
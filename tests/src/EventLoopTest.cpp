@@ -1,6 +1,8 @@
 #include <chrono>
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <vector>
 
 #include "EventLoop.hpp"
 #include "catch.hpp"
@@ -33,6 +35,76 @@ TEST_CASE("jobs", "[eventloop]") {
   }
 }
 
+TEST_CASE("jobs added from a job", "[eventloop]") {
+  EventLoop ev;
+  int order = 0;
+  int outerRan = 0;
+  int innerRan = 0;
+
+  ev.addJob([&]() {
+    outerRan = ++order;
+    ev.addJob([&]() {
+      innerRan = ++order;
+    });
+  });
+
+  SECTION("a job should be able to add a new job without deadlocking") {
+    ev.processJobs();
+    REQUIRE(outerRan == 1);
+    REQUIRE(innerRan == 0);
+    REQUIRE(ev.hasWork() == true);
+
+    ev.processJobs();
+    REQUIRE(innerRan == 2);
+    REQUIRE(ev.hasWork() == false);
+  }
+}
+
+TEST_CASE("jobs from multiple producers", "[eventloop]") {
+  constexpr int numProducers = 4;
+  constexpr int jobsPerProducer = 10000;
+
+  EventLoop ev;
+  std::atomic<bool> done{false};
+  std::vector<int> lastSeen(numProducers, -1);
+  bool inOrder = true;
+  int processed = 0;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < numProducers; p++) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < jobsPerProducer; i++) {
+        ev.addJob([&, p, i]() {
+          if (lastSeen[p] + 1 != i) {
+            inOrder = false;
+          }
+          lastSeen[p] = i;
+          processed++;
+        });
+      }
+    });
+  }
+
+  std::thread joiner([&]() {
+    for (auto& t : producers) {
+      t.join();
+    }
+    done = true;
+  });
+
+  while (!done || ev.hasWork()) {
+    ev.processJobs();
+  }
+
+  joiner.join();
+  ev.processJobs();
+
+  SECTION("every job should run exactly once, in order per producer") {
+    REQUIRE(processed == numProducers * jobsPerProducer);
+    REQUIRE(inOrder == true);
+  }
+}
+
 TEST_CASE("timers", "[eventloop]") {
   EventLoop ev;
   bool timerHasRun = false;
@@ -0,0 +1,405 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Config.hpp"
+#include "ConnectionWorker.hpp"
+#include "CpuTopology.hpp"
+#include "IoUring.hpp"
+#include "Server.hpp"
+#include "TestConfig.hpp"
+#include "TopicManager.hpp"
+#include "catch.hpp"
+
+using namespace eventhub;
+
+namespace {
+
+int pickFreePort() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in sin;
+  socklen_t sinLen = sizeof(sin);
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family      = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  bind(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin));
+  getsockname(fd, reinterpret_cast<struct sockaddr*>(&sin), &sinLen);
+  close(fd);
+
+  return ntohs(sin.sin_port);
+}
+
+/**
+ * Send request to 127.0.0.1:port and read the response until the server
+ * closes the connection.
+ */
+std::string httpRequest(int port, const std::string& request) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in sin;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family      = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sin.sin_port        = htons(port);
+
+  struct timeval tv = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin)) == -1) {
+    close(fd);
+    return "";
+  }
+
+  // Split the request to exercise partial reads on the server.
+  const std::size_t half = request.length() / 2;
+  ::write(fd, request.c_str(), half);
+  usleep(10000);
+  ::write(fd, request.c_str() + half, request.length() - half);
+
+  std::string response;
+  char buf[4096];
+  ssize_t n;
+
+  while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+    response.append(buf, n);
+  }
+
+  close(fd);
+  return response;
+}
+
+/**
+ * Connect a websocket client to 127.0.0.1:port.
+ * @returns Socket of the client, -1 if the handshake failed.
+ */
+int websocketConnect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family      = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sin.sin_port        = htons(port);
+
+  struct timeval tv = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  const std::string handshake = "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                                "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  char buf[4096];
+
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin)) == -1 ||
+      ::write(fd, handshake.c_str(), handshake.length()) != static_cast<ssize_t>(handshake.length())) {
+    close(fd);
+    return -1;
+  }
+
+  ssize_t n = ::read(fd, buf, sizeof(buf));
+  if (n <= 0 || std::string(buf, n).find("HTTP/1.1 101") != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+// Send a masked text frame with a zero mask, payload must be shorter than 126 bytes.
+bool websocketSend(int fd, const std::string& payload) {
+  std::string frame = {static_cast<char>(0x81), static_cast<char>(0x80 | payload.length()), 0, 0, 0, 0};
+  frame.append(payload);
+
+  return ::write(fd, frame.c_str(), frame.length()) == static_cast<ssize_t>(frame.length());
+}
+
+bool waitFor(const std::function<bool()>& done) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    usleep(1000);
+  }
+
+  return done();
+}
+
+} // namespace
+
+TEST_CASE("IoUring", "[io_uring]") {
+  IoUring ring;
+
+  if (!ring.init(64, 256)) {
+    WARN("io_uring is not available: " << ring.getError());
+    return;
+  }
+
+  SECTION("Completions should carry the user data of their request") {
+    for (uint64_t i = 1; i <= 3; i++) {
+      auto sqe       = ring.getSqe();
+      sqe->opcode    = IORING_OP_NOP;
+      sqe->user_data = i;
+    }
+
+    std::vector<uint64_t> completed;
+    while (completed.size() < 3) {
+      REQUIRE(ring.submitAndWait(std::chrono::milliseconds(1000)) >= 0);
+      ring.forEachCqe([&](const struct io_uring_cqe* cqe) {
+        completed.push_back(cqe->user_data);
+      });
+    }
+
+    REQUIRE(completed == std::vector<uint64_t>{1, 2, 3});
+  }
+
+  SECTION("Multishot receive should fill provided buffers and keep going") {
+    REQUIRE(ring.setupBufferRing(0, 4, 16));
+
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    auto sqe       = ring.getSqe();
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fds[0];
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = ring.getBufferGroup();
+    sqe->user_data = 42;
+    REQUIRE(ring.submit() >= 0);
+
+    std::string received;
+    bool more = true;
+
+    // More data than all buffers together hold, so buffers must be recycled.
+    for (int i = 0; i < 8; i++) {
+      const std::string chunk = "chunk" + std::to_string(i) + ";";
+      REQUIRE(::write(fds[1], chunk.c_str(), chunk.length()) == static_cast<ssize_t>(chunk.length()));
+
+      while (received.find(chunk) == std::string::npos && more) {
+        REQUIRE(ring.submitAndWait(std::chrono::milliseconds(1000)) >= 0);
+        ring.forEachCqe([&](const struct io_uring_cqe* cqe) {
+          REQUIRE(cqe->user_data == 42);
+          REQUIRE(cqe->res > 0);
+          REQUIRE((cqe->flags & IORING_CQE_F_BUFFER));
+
+          const uint16_t bufferId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+          received.append(ring.getBuffer(bufferId), cqe->res);
+          ring.recycleBuffer(bufferId);
+          more = cqe->flags & IORING_CQE_F_MORE;
+        });
+      }
+    }
+
+    REQUIRE(more);
+    REQUIRE(received == "chunk0;chunk1;chunk2;chunk3;chunk4;chunk5;chunk6;chunk7;");
+
+    close(fds[0]);
+    close(fds[1]);
+  }
+}
+
+TEST_CASE("Worker backends", "[io_uring]") {
+  for (const std::string backend : {"epoll", "io_uring"}) {
+    for (const int busyPoll : {0, 200}) {
+      DYNAMIC_SECTION("Worker should serve HTTP requests with " << backend << " and busy_poll_us " << busyPoll) {
+        const int port = pickFreePort();
+
+        Config cfg(testConfigMap());
+        cfg << ("listen_port = " + std::to_string(port) + "\n").c_str();
+        cfg << ("io_backend = " + backend + "\n").c_str();
+        cfg << ("busy_poll_us = " + std::to_string(busyPoll) + "\n").c_str();
+        cfg.load();
+
+        Server server(cfg);
+        auto worker = std::make_unique<Worker>(&server, 1);
+
+        if (backend == "io_uring" && !worker->usesIoUring()) {
+          WARN("io_uring is not available, skipping.");
+          continue;
+        }
+
+        worker->run();
+
+        // Several requests in a row exercise accept, receive and send
+        // being re-armed on the ring.
+        for (int i = 0; i < 5; i++) {
+          const auto response = httpRequest(port, "GET /healthz HTTP/1.1\r\nHost: localhost\r\n\r\n");
+          REQUIRE(response.find("HTTP/1.1 200") == 0);
+          REQUIRE(response.find("\"status\": \"ok\"") != std::string::npos);
+        }
+
+        // The worker notices the hangup of the last connection on its own time.
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (worker->getMetrics().current_connections_count > 0 && std::chrono::steady_clock::now() < deadline) {
+          usleep(1000);
+        }
+
+        worker->stop();
+        worker->thread().join();
+
+        REQUIRE(worker->getMetrics().total_connect_count == 5);
+        REQUIRE(worker->getMetrics().current_connections_count == 0);
+      }
+    }
+  }
+}
+
+TEST_CASE("Migration between backends", "[io_uring]") {
+  const int epollPort = pickFreePort();
+  const int uringPort = pickFreePort();
+
+  Config epollCfg(testConfigMap());
+  epollCfg << ("listen_port = " + std::to_string(epollPort) + "\n").c_str();
+  epollCfg.load();
+
+  Config uringCfg(testConfigMap());
+  uringCfg << ("listen_port = " + std::to_string(uringPort) + "\n").c_str();
+  uringCfg << "io_backend = io_uring\n";
+  uringCfg.load();
+
+  Server epollServer(epollCfg);
+  Server uringServer(uringCfg);
+  auto epollWorker = std::make_unique<Worker>(&epollServer, 1);
+  auto uringWorker = std::make_unique<Worker>(&uringServer, 2);
+
+  if (!uringWorker->usesIoUring()) {
+    WARN("io_uring is not available, skipping.");
+    return;
+  }
+
+  epollWorker->run();
+  uringWorker->run();
+
+  int fd = websocketConnect(epollPort);
+  REQUIRE(fd != -1);
+
+  // An epoll worker hands the websocket client to an io_uring worker.
+  epollWorker->migrateConnections(uringWorker.get(), 1);
+  REQUIRE(waitFor([&]() { return uringWorker->getMetrics().current_connections_count == 1; }));
+
+  // The io_uring worker should pick up what the client sends from now on.
+  REQUIRE(websocketSend(fd, "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\",\"params\":{}}"));
+
+  char buf[4096];
+  ssize_t n = ::read(fd, buf, sizeof(buf));
+  REQUIRE(n > 0);
+  REQUIRE(std::string(buf, n).find("pong") != std::string::npos);
+
+  close(fd);
+
+  epollWorker->stop();
+  epollWorker->thread().join();
+  uringWorker->stop();
+  uringWorker->thread().join();
+}
+
+TEST_CASE("Migration while the target has a fan-out pending", "[worker]") {
+  const int sourcePort = pickFreePort();
+  const int targetPort = pickFreePort();
+
+  Config sourceCfg(testConfigMap());
+  sourceCfg << ("listen_port = " + std::to_string(sourcePort) + "\n").c_str();
+  sourceCfg.load();
+
+  // One delivery per loop iteration, to a subscriber that never reads.
+  Config targetCfg(testConfigMap());
+  targetCfg << ("listen_port = " + std::to_string(targetPort) + "\n").c_str();
+  targetCfg << "fanout_budget_subscribers = 1\nslow_consumer_policy = drop_oldest\n";
+  targetCfg.load();
+
+  Server sourceServer(sourceCfg);
+  Server targetServer(targetCfg);
+  auto source = std::make_unique<Worker>(&sourceServer, 1);
+  auto target = std::make_unique<Worker>(&targetServer, 2);
+
+  source->run();
+  target->run();
+
+  int subscriberFd = websocketConnect(targetPort);
+  REQUIRE(subscriberFd != -1);
+  REQUIRE(websocketSend(subscriberFd, "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"subscribe\",\"params\":{\"topic\":\"busy\"}}"));
+  REQUIRE(waitFor([&]() { return target->getTopicManager()->getSubscriptionCount() == 1; }));
+
+  // Publish faster than the target delivers, so its fan-out queue never drains.
+  std::atomic<bool> publishing{true};
+  std::thread publisher([&]() {
+    uint64_t seq = 0;
+
+    while (publishing) {
+      auto batch = std::make_shared<PublishBatch>();
+      for (int i = 0; i < 500; i++) {
+        batch->push_back({InternedTopic("busy"), "{\"id\": \"" + std::to_string(++seq) + "\", \"message\": \"x\"}", seq});
+      }
+
+      target->publishBatch(batch);
+      usleep(500);
+    }
+  });
+
+  int fd = websocketConnect(sourcePort);
+  REQUIRE(fd != -1);
+
+  source->migrateConnections(target.get(), 1);
+  const bool adopted = waitFor([&]() { return target->getMetrics().current_connections_count == 2; });
+
+  // The migrated client should be served while the fan-out goes on.
+  char buf[4096];
+  ssize_t n = -1;
+
+  if (adopted && websocketSend(fd, "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\",\"params\":{}}")) {
+    n = ::read(fd, buf, sizeof(buf));
+  }
+
+  publishing = false;
+  publisher.join();
+
+  REQUIRE(adopted);
+  REQUIRE(n > 0);
+  REQUIRE(std::string(buf, n).find("pong") != std::string::npos);
+
+  close(fd);
+  close(subscriberFd);
+
+  source->stop();
+  source->thread().join();
+  target->stop();
+  target->thread().join();
+}
+
+TEST_CASE("Worker pinning", "[io_uring]") {
+  Config cfg(testConfigMap());
+  cfg << ("listen_port = " + std::to_string(pickFreePort()) + "\n").c_str();
+  cfg.load();
+
+  const int cpu = CpuTopology::getAllowedCpus().back();
+  Server server(cfg);
+  auto worker = std::make_unique<Worker>(&server, 1, cpu);
+  worker->run();
+
+  // The worker pins itself when its thread starts.
+  auto pinnedCpus = [&]() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(worker->thread().native_handle(), sizeof(set), &set);
+    return CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set);
+  };
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!pinnedCpus() && std::chrono::steady_clock::now() < deadline) {
+    usleep(1000);
+  }
+
+  REQUIRE(pinnedCpus());
+  REQUIRE(waitFor([&]() { return worker->getMetrics().pinned.load(); }));
+
+  worker->stop();
+  worker->thread().join();
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "LocalRateLimiter.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+TEST_CASE("LocalRateLimiter test", "[local_rate_limiter]") {
+  using namespace std::chrono_literals;
+
+  LocalRateLimiter limiter(1000ms);
+  const auto now = LocalRateLimiter::Clock::now();
+
+  SECTION("Publishes should be allowed until the bucket is empty") {
+    for (long long i = 1; i <= 3; i++) {
+      auto res = limiter.check("a/#", "user", 10, 3, now);
+      REQUIRE_FALSE(res.limited);
+      REQUIRE(res.count == i);
+    }
+
+    auto res = limiter.check("a/#", "user", 10, 3, now);
+    REQUIRE(res.limited);
+    REQUIRE(res.count == 3);
+
+    // Other subjects and patterns have buckets of their own.
+    REQUIRE_FALSE(limiter.check("a/#", "other", 10, 3, now).limited);
+    REQUIRE_FALSE(limiter.check("b", "user", 10, 3, now).limited);
+    REQUIRE(limiter.size() == 3);
+  }
+
+  SECTION("The bucket should refill at max per interval") {
+    for (int i = 0; i < 10; i++) {
+      limiter.check("a", "user", 10, 10, now);
+    }
+
+    REQUIRE(limiter.check("a", "user", 10, 10, now).limited);
+    REQUIRE_FALSE(limiter.check("a", "user", 10, 10, now + 1s).limited);
+    REQUIRE(limiter.check("a", "user", 10, 10, now + 1s).limited);
+  }
+
+  SECTION("A limit of 0 should never limit") {
+    REQUIRE_FALSE(limiter.check("a", "user", 10, 0, now).limited);
+    REQUIRE_FALSE(limiter.check("a", "user", 0, 10, now).limited);
+    REQUIRE(limiter.size() == 0);
+  }
+
+  SECTION("Usage should be collected once") {
+    limiter.check("a", "user", 10, 10, now);
+    limiter.check("a", "user", 10, 10, now);
+
+    auto usage = limiter.collectUsage(now);
+    REQUIRE(usage.size() == 1);
+    REQUIRE(usage[0].topic == "a");
+    REQUIRE(usage[0].subject == "user");
+    REQUIRE(usage[0].consumed == 2);
+    REQUIRE(usage[0].ttl == 20);
+
+    usage = limiter.collectUsage(now);
+    REQUIRE(usage.size() == 1);
+    REQUIRE(usage[0].consumed == 0);
+  }
+
+  SECTION("Usage that failed to sync should be sent with the next sync") {
+    limiter.check("a", "user", 10, 10, now);
+    limiter.restoreUsage(limiter.collectUsage(now));
+
+    auto usage = limiter.collectUsage(now);
+    REQUIRE(usage.size() == 1);
+    REQUIRE(usage[0].consumed == 1);
+  }
+
+  SECTION("What other nodes consumed should be taken out of the bucket") {
+    limiter.check("a", "user", 10, 10, now);
+
+    // The first sync only learns the total.
+    auto usage = limiter.collectUsage(now);
+    limiter.applyTotals(usage, {5});
+
+    // Another node published 7 times since.
+    limiter.check("a", "user", 10, 10, now);
+    usage = limiter.collectUsage(now);
+    limiter.applyTotals(usage, {13});
+
+    // 10 - 2 - 7 leaves 1.
+    REQUIRE_FALSE(limiter.check("a", "user", 10, 10, now).limited);
+    REQUIRE(limiter.check("a", "user", 10, 10, now).limited);
+  }
+
+  SECTION("A bucket should never owe more than max") {
+    limiter.check("a", "user", 10, 10, now);
+    limiter.applyTotals(limiter.collectUsage(now), {1});
+    limiter.applyTotals(limiter.collectUsage(now), {1000});
+
+    REQUIRE(limiter.check("a", "user", 10, 10, now + 10s).limited);
+    REQUIRE_FALSE(limiter.check("a", "user", 10, 10, now + 11s).limited);
+  }
+
+  SECTION("Full buckets that aren't used should be dropped") {
+    limiter.check("a", "user", 10, 10, now);
+    limiter.collectUsage(now);
+    REQUIRE(limiter.size() == 1);
+
+    limiter.collectUsage(now + 5s);
+    REQUIRE(limiter.size() == 1);
+
+    limiter.collectUsage(now + 10s);
+    REQUIRE(limiter.size() == 0);
+  }
+}
+
+} // namespace eventhub
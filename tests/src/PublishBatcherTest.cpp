@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PublishBatcher.hpp"
+#include "catch.hpp"
+
+using namespace eventhub;
+
+TEST_CASE("batching", "[publish_batcher]") {
+  std::mutex lock;
+  std::vector<PublishBatchPtr> batches;
+
+  auto collect = [&](PublishBatchPtr batch) {
+    std::lock_guard<std::mutex> guard(lock);
+    batches.push_back(batch);
+  };
+
+  SECTION("A full batch should be handed off immediately") {
+    PublishBatcher batcher(3, std::chrono::seconds(10), collect);
+    batcher.start();
+
+    batcher.add(InternedTopic("topic1"), "msg1");
+    batcher.add(InternedTopic("topic1"), "msg2");
+    batcher.add(InternedTopic("topic2"), "msg3");
+
+    std::lock_guard<std::mutex> guard(lock);
+    REQUIRE(batches.size() == 1);
+    REQUIRE(batches[0]->size() == 3);
+    REQUIRE(batches[0]->at(0).data == "msg1");
+    REQUIRE(batches[0]->at(2).topic.name() == "topic2");
+  }
+
+  SECTION("A partial batch should be handed off after the latency cap") {
+    PublishBatcher batcher(100, std::chrono::milliseconds(5), collect);
+    batcher.start();
+
+    batcher.add(InternedTopic("topic1"), "msg1");
+    batcher.add(InternedTopic("topic1"), "msg2");
+
+    for (int i = 0; i < 200; i++) {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!batches.empty()) {
+          break;
+        }
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    REQUIRE(batches.size() == 1);
+    REQUIRE(batches[0]->size() == 2);
+  }
+
+  SECTION("Batch size of 1 should hand off every message") {
+    PublishBatcher batcher(1, std::chrono::milliseconds(5), collect);
+    batcher.start();
+
+    batcher.add(InternedTopic("topic1"), "msg1");
+    batcher.add(InternedTopic("topic1"), "msg2");
+
+    std::lock_guard<std::mutex> guard(lock);
+    REQUIRE(batches.size() == 2);
+  }
+
+  SECTION("stop() should hand off the remaining messages in order") {
+    PublishBatcher batcher(100, std::chrono::seconds(10), collect);
+    batcher.start();
+
+    for (int i = 0; i < 250; i++) {
+      batcher.add(InternedTopic("topic1"), std::to_string(i));
+    }
+
+    batcher.stop();
+
+    std::lock_guard<std::mutex> guard(lock);
+    REQUIRE(batches.size() == 3);
+
+    int expected = 0;
+    for (const auto& batch : batches) {
+      for (const auto& msg : *batch) {
+        REQUIRE(msg.data == std::to_string(expected++));
+      }
+    }
+
+    REQUIRE(expected == 250);
+  }
+}
+
+TEST_CASE("sequence numbers", "[publish_batcher]") {
+  std::vector<PublishBatchPtr> batches;
+  PublishBatcher batcher(2, std::chrono::seconds(10), [&](PublishBatchPtr batch) {
+    batches.push_back(batch);
+  });
+
+  for (int i = 0; i < 6; i++) {
+    batcher.add(InternedTopic("topic1"), "msg");
+  }
+
+  SECTION("Messages should be numbered in the order they were added") {
+    REQUIRE(batches.size() == 3);
+
+    uint64_t expected = 1;
+    for (const auto& batch : batches) {
+      for (const auto& msg : *batch) {
+        REQUIRE(msg.seq == expected++);
+      }
+    }
+  }
+}
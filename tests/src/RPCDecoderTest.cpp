@@ -0,0 +1,96 @@
+#include <string>
+
+#include "RPCDecoder.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+TEST_CASE("RPC decoder test", "[rpcdecoder]") {
+  RPCRequest req;
+
+  SECTION("Publish requests should be decoded") {
+    REQUIRE(RPCDecoder::decode(R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":"a/b","message":"hello","timestamp":1000,"ttl":60}})", req));
+    REQUIRE(req.method == RPCRequestMethod::PUBLISH);
+    REQUIRE(req.id.type() == jsonrpcpp::Id::value_t::integer);
+    REQUIRE(req.id.int_id() == 1);
+    REQUIRE(req.topic == "a/b");
+    REQUIRE(req.message == "hello");
+    REQUIRE(req.timestamp == 1000);
+    REQUIRE(req.ttl == 60);
+  }
+
+  SECTION("Subscribe requests should be decoded") {
+    REQUIRE(RPCDecoder::decode(" {\n \"method\" : \"SUBSCRIBE\", \"params\": {\"topic\": \"a/#\", \"since\": -5000, \"limit\": 10, \"extra\": [1, {\"x\": null}, 2.5e3, true]}, \"id\": \"abc\", \"jsonrpc\": \"2.0\"}\n", req));
+    REQUIRE(req.method == RPCRequestMethod::SUBSCRIBE);
+    REQUIRE(req.id.type() == jsonrpcpp::Id::value_t::string);
+    REQUIRE(req.id.string_id() == "abc");
+    REQUIRE(req.topic == "a/#");
+    REQUIRE(req.since == -5000);
+    REQUIRE(req.limit.value() == 10);
+    REQUIRE(req.sinceEventId.empty());
+  }
+
+  SECTION("A null ID should be decoded") {
+    REQUIRE(RPCDecoder::decode(R"({"jsonrpc":"2.0","id":null,"method":"subscribe","params":{"topic":"a"}})", req));
+    REQUIRE(req.id.type() == jsonrpcpp::Id::value_t::null);
+    REQUIRE(!req.limit);
+  }
+
+  SECTION("Escapes and UTF-8 in strings should be decoded") {
+    REQUIRE(RPCDecoder::decode(R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":"a","message":"q\"b\\s\/n\nt\tu\u00e6\ud83d\ude00 æ😀"}})", req));
+    REQUIRE(req.message == "q\"b\\s/n\nt\tu\xc3\xa6\xf0\x9f\x98\x80 \xc3\xa6\xf0\x9f\x98\x80");
+  }
+
+  SECTION("The request should be cleared before decoding") {
+    REQUIRE(RPCDecoder::decode(R"({"jsonrpc":"2.0","id":1,"method":"subscribe","params":{"topic":"a","limit":5}})", req));
+    REQUIRE(RPCDecoder::decode(R"({"jsonrpc":"2.0","id":2,"method":"subscribe","params":{"topic":"b"}})", req));
+    REQUIRE(req.topic == "b");
+    REQUIRE(!req.limit);
+  }
+
+  SECTION("Requests the decoder isn't sure about should be left to jsonrpcpp") {
+    const std::string requests[] = {
+      R"({"jsonrpc":"2.0","id":1,"method":"list"})",
+      R"({"jsonrpc":"2.0","id":1,"method":"unsubscribe","params":["a"]})",
+      R"({"jsonrpc":"2.0","method":"publish","params":{"topic":"a","message":"b"}})",
+      R"({"jsonrpc":"1.0","id":1,"method":"publish","params":{"topic":"a","message":"b"}})",
+      R"({"id":1,"method":"publish","params":{"topic":"a","message":"b"}})",
+      R"({"jsonrpc":"2.0","id":1.5,"method":"publish","params":{"topic":"a","message":"b"}})",
+      R"({"jsonrpc":"2.0","id":1,"method":"subscribe","params":{"topic":"a","since":1e3}})",
+      R"({"jsonrpc":"2.0","id":1,"method":"subscribe","params":{"topic":"a","limit":"10"}})",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":1,"message":"b"}})",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","params":["a","b"]})",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":"a","message":"b"}} x)",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":"a","message":"b"})",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":"a","message":"\ud83d"}})",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","params":{"topic":"a","message":"\x"}})",
+      R"({"jsonrpc":"2.0","id":1,"method":"publish","extra":true,"params":{"topic":"a","message":"b"}})",
+      R"({"jsonrpc":"2.0","id":01,"method":"publish","params":{"topic":"a","message":"b"}})",
+      R"({"jsonrpc":"2.0","id":99999999999,"method":"publish","params":{"topic":"a","message":"b"}})",
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"publish\",\"params\":{\"topic\":\"a\",\"message\":\"\xc3\"}}",
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"publish\",\"params\":{\"topic\":\"a\",\"message\":\"\xed\xa0\x80\"}}",
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"publish\",\"params\":{\"topic\":\"a\",\"message\":\"a\nb\"}}",
+      "[]",
+      "{}",
+      ""
+    };
+
+    for (const auto& request : requests) {
+      INFO(request);
+      REQUIRE_FALSE(RPCDecoder::decode(request, req));
+    }
+  }
+
+  SECTION("Decoded requests should match what jsonrpcpp parses") {
+    const std::string request = R"({"jsonrpc":"2.0","id":"x","method":"publish","params":{"topic":"a/b","message":"A\næ"}})";
+    jsonrpcpp::Parser parser;
+    auto parsed = std::dynamic_pointer_cast<jsonrpcpp::Request>(parser.parse(request));
+
+    REQUIRE(RPCDecoder::decode(request, req));
+    REQUIRE(req.id.string_id() == parsed->id().string_id());
+    REQUIRE(req.topic == parsed->params().get("topic").get<std::string>());
+    REQUIRE(req.message == parsed->params().get("message").get<std::string>());
+  }
+}
+
+} // namespace eventhub
@@ -16,6 +16,7 @@
 #include "catch.hpp"
 #include "jwt/json/json.hpp"
 #include "Redis.hpp"
+#include "TestConfig.hpp"
 
 using namespace eventhub;
 
@@ -29,7 +30,8 @@ TEST_CASE("Test redis", "[Redis") {
     { "max_cache_length",         ConfigValueType::INT,    "1000",          ConfigValueSettings::REQUIRED },
     { "max_cache_request_limit",  ConfigValueType::INT,    "100",           ConfigValueSettings::REQUIRED },
     { "default_cache_ttl",        ConfigValueType::INT,    "60",            ConfigValueSettings::REQUIRED },
-    { "enable_cache",             ConfigValueType::BOOL,   "true",          ConfigValueSettings::REQUIRED }
+    { "enable_cache",             ConfigValueType::BOOL,   "true",          ConfigValueSettings::REQUIRED },
+    { "rate_limit_algorithm",     ConfigValueType::STRING, "fixed_window",  ConfigValueSettings::OPTIONAL }
   };
 
   Config cfg(cfgMap);
@@ -135,6 +137,39 @@ TEST_CASE("Test redis", "[Redis") {
     }
   }
 
+  GIVEN("That a user has a rate limit of 3 publishes per 10 seconds") {
+    // Rate limit keys carry the prefix twice, see Redis::checkRateLimit().
+    redis.connection().del("eventhub_test:eventhub_test:rlimit:test/rlimit/#:petter@testmann.no");
+
+    THEN("The first 3 publishes should be allowed and counted") {
+      for (long long i = 1; i <= 3; i++) {
+        auto res = redis.checkRateLimit("test/rlimit/#", "petter@testmann.no", 10, 3);
+        REQUIRE_FALSE(res.limited);
+        REQUIRE(res.count == i);
+      }
+
+      auto res = redis.checkRateLimit("test/rlimit/#", "petter@testmann.no", 10, 3);
+      REQUIRE(res.limited);
+      REQUIRE(res.count == 3);
+    }
+
+    THEN("A limit of 0 should never limit") {
+      REQUIRE_FALSE(redis.checkRateLimit("test/rlimit/#", "petter@testmann.no", 10, 0).limited);
+    }
+  }
+
+  GIVEN("That we parse rate limit algorithm names") {
+    RateLimitAlgorithm algorithm;
+
+    THEN("Known names should be accepted") {
+      REQUIRE(Redis::parseRateLimitAlgorithm("sliding_window", algorithm));
+      REQUIRE(algorithm == RateLimitAlgorithm::SLIDING_WINDOW);
+      REQUIRE(Redis::parseRateLimitAlgorithm("gcra", algorithm));
+      REQUIRE(algorithm == RateLimitAlgorithm::GCRA);
+      REQUIRE_FALSE(Redis::parseRateLimitAlgorithm("token_bucket", algorithm));
+    }
+  }
+
   GIVEN("That we send in 1000-1:10000:petter@testmann.no to CacheItemMeta") {
     auto p = CacheItemMeta{"1000-1:10000:petter@testmann.no"};
 
@@ -193,3 +228,87 @@ TEST_CASE("Test redis", "[Redis") {
     }
   }
 }
+
+TEST_CASE("Test redis rate limit scripts", "[Redis]") {
+  const std::string topic   = "test/rlimit/#";
+  const std::string subject = "petter@testmann.no";
+
+  GIVEN("A sliding window limit of 3 publishes per 10 seconds") {
+    Config cfg(testConfigMap({ { "redis_prefix", "eventhub_test" }, { "rate_limit_algorithm", "sliding_window" } }));
+    cfg.load();
+
+    eventhub::Redis redis(cfg);
+    redis.connection().del("eventhub_test:eventhub_test:rlimit:test/rlimit/#:petter@testmann.no:sw");
+
+    THEN("The 4th publish should be refused and not counted") {
+      for (long long i = 1; i <= 3; i++) {
+        auto res = redis.checkRateLimit(topic, subject, 10, 3);
+        REQUIRE_FALSE(res.limited);
+        REQUIRE(res.count == i);
+      }
+
+      for (int i = 0; i < 2; i++) {
+        auto res = redis.checkRateLimit(topic, subject, 10, 3);
+        REQUIRE(res.limited);
+        REQUIRE(res.count == 3);
+      }
+    }
+  }
+
+  GIVEN("A GCRA limit of 3 publishes per 10 seconds") {
+    Config cfg(testConfigMap({ { "redis_prefix", "eventhub_test" }, { "rate_limit_algorithm", "gcra" } }));
+    cfg.load();
+
+    eventhub::Redis redis(cfg);
+    redis.connection().del("eventhub_test:eventhub_test:rlimit:test/rlimit/#:petter@testmann.no:gcra");
+
+    THEN("A burst of 3 should be allowed and the 4th refused") {
+      for (long long i = 1; i <= 3; i++) {
+        auto res = redis.checkRateLimit(topic, subject, 10, 3);
+        REQUIRE_FALSE(res.limited);
+        REQUIRE(res.count == i);
+      }
+
+      auto res = redis.checkRateLimit(topic, subject, 10, 3);
+      REQUIRE(res.limited);
+      REQUIRE(res.count == 3);
+    }
+  }
+
+  GIVEN("That Redis has dropped its script cache") {
+    Config cfg(testConfigMap({ { "redis_prefix", "eventhub_test" } }));
+    cfg.load();
+
+    eventhub::Redis redis(cfg);
+    redis.connection().del("eventhub_test:eventhub_test:rlimit:test/rlimit/#:petter@testmann.no");
+    redis.connection().script_flush();
+
+    THEN("The script should be sent again instead of failing with NOSCRIPT") {
+      REQUIRE(redis.checkRateLimit(topic, subject, 10, 3).count == 1);
+      REQUIRE(redis.checkRateLimit(topic, subject, 10, 3).count == 2);
+    }
+  }
+
+  GIVEN("That a node has counted publishes against two limits") {
+    Config cfg(testConfigMap({ { "redis_prefix", "eventhub_test" } }));
+    cfg.load();
+
+    eventhub::Redis redis(cfg);
+    redis.connection().del("eventhub_test:eventhub_test:rlimit:test/rlimit/#:petter@testmann.no:tb");
+    redis.connection().del("eventhub_test:eventhub_test:rlimit:test/rlimit/#:ola@testmann.no:tb");
+
+    std::vector<RateLimitUsage> usage = {
+      { topic, subject, 2, 10 },
+      { topic, "ola@testmann.no", 5, 10 }
+    };
+
+    THEN("Syncing should add to the totals kept next to the Redis limits") {
+      REQUIRE(redis.syncRateLimitUsage(usage) == std::vector<long long>{ 2, 5 });
+      REQUIRE(redis.syncRateLimitUsage(usage) == std::vector<long long>{ 4, 10 });
+
+      auto total = redis.connection().get("eventhub_test:eventhub_test:rlimit:test/rlimit/#:petter@testmann.no:tb");
+      REQUIRE(total);
+      REQUIRE(total.value() == "4");
+    }
+  }
+}
@@ -0,0 +1,188 @@
+#include <list>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Common.hpp"
+#include "SlabPool.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+namespace {
+struct Tracked {
+  explicit Tracked(int* alive) : _alive(alive) { (*_alive)++; }
+  ~Tracked() { (*_alive)--; }
+
+  int* _alive;
+  char _payload[100];
+};
+} // namespace
+
+TEST_CASE("SlabPool test", "[slab_pool]") {
+  auto pool = new SlabPool("test");
+
+  SECTION("A block freed by the owner should be handed out again") {
+    pool->getThreadOwner().bind();
+
+    void* a = pool->allocate(64);
+    SlabPool::deallocate(a);
+    void* b = pool->allocate(64);
+
+    REQUIRE(a == b);
+    SlabPool::deallocate(b);
+
+    pool->getThreadOwner().release();
+  }
+
+  SECTION("Stats should follow allocations and slabs") {
+    REQUIRE(pool->getStats().bytes == 0);
+
+    void* a    = pool->allocate(64);
+    void* b    = pool->allocate(64);
+    auto stats = pool->getStats();
+
+    REQUIRE(stats.blocks_in_use == 2);
+    REQUIRE(stats.blocks_free > 0);
+    REQUIRE(stats.bytes == SLAB_POOL_SLAB_SIZE);
+
+    SlabPool::deallocate(a);
+    SlabPool::deallocate(b);
+    const auto after = pool->getStats();
+
+    REQUIRE(after.blocks_in_use == 0);
+    REQUIRE(after.blocks_free == stats.blocks_free + 2);
+    REQUIRE(after.bytes == SLAB_POOL_SLAB_SIZE);
+  }
+
+  SECTION("Allocations should span several slabs without handing out a block twice") {
+    const std::size_t count = 3 * SLAB_POOL_SLAB_SIZE / 256;
+    std::set<void*> blocks;
+
+    for (std::size_t i = 0; i < count; i++) {
+      blocks.insert(pool->allocate(256));
+    }
+
+    REQUIRE(blocks.size() == count);
+    REQUIRE(pool->getStats().bytes >= 3 * SLAB_POOL_SLAB_SIZE);
+
+    for (auto block : blocks) {
+      SlabPool::deallocate(block);
+    }
+
+    REQUIRE(pool->getStats().blocks_in_use == 0);
+  }
+
+  SECTION("Blocks freed by another thread should be reused by the owner") {
+    pool->getThreadOwner().bind();
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 100; i++) {
+      blocks.push_back(pool->allocate(64));
+    }
+
+    const auto bytes = pool->getStats().bytes;
+
+    std::thread other([&blocks]() {
+      for (auto block : blocks) {
+        SlabPool::deallocate(block);
+      }
+    });
+    other.join();
+
+    REQUIRE(pool->getStats().blocks_in_use == 0);
+
+    // Use up the local free list so the pool has to take the remote one.
+    const auto local = pool->getStats().blocks_free - blocks.size();
+    std::vector<void*> again;
+    for (std::size_t i = 0; i < local + blocks.size(); i++) {
+      again.push_back(pool->allocate(64));
+    }
+
+    REQUIRE(pool->getStats().bytes == bytes);
+
+    for (auto block : again) {
+      SlabPool::deallocate(block);
+    }
+
+    pool->getThreadOwner().release();
+  }
+
+  SECTION("Objects should be constructed and destroyed in pooled blocks") {
+    int alive = 0;
+
+    {
+      auto object = makePooled<Tracked>(pool, &alive);
+      REQUIRE(alive == 1);
+      REQUIRE(pool->getStats().blocks_in_use == 1);
+    }
+
+    REQUIRE(alive == 0);
+    REQUIRE(pool->getStats().blocks_in_use == 0);
+  }
+
+  SECTION("Standard containers and shared pointers should work with the allocator") {
+    int alive = 0;
+
+    {
+      auto listPool = new SlabPool("list");
+      std::list<std::shared_ptr<Tracked>, PoolAllocator<std::shared_ptr<Tracked>>> list{PoolAllocator<std::shared_ptr<Tracked>>(listPool)};
+
+      for (int i = 0; i < 10; i++) {
+        list.push_back(std::allocate_shared<Tracked>(PoolAllocator<Tracked>(pool), &alive));
+      }
+
+      REQUIRE(alive == 10);
+      REQUIRE(pool->getStats().blocks_in_use == 10);
+      REQUIRE(listPool->getStats().blocks_in_use == 10);
+
+      list.pop_front();
+      REQUIRE(alive == 9);
+      REQUIRE(pool->getStats().blocks_in_use == 9);
+
+      // The list still holds blocks, so the pool lives on until it is gone.
+      listPool->orphan();
+    }
+
+    REQUIRE(alive == 0);
+    REQUIRE(pool->getStats().blocks_in_use == 0);
+  }
+
+  SECTION("A block larger than the pool's block size should be refused") {
+    pool->getThreadOwner().bind();
+
+    void* block = pool->allocate(64);
+
+    REQUIRE_THROWS_AS(pool->allocate(65), std::length_error);
+    REQUIRE(pool->getStats().blocks_in_use == 1);
+
+    SlabPool::deallocate(block);
+    pool->getThreadOwner().release();
+  }
+
+  SECTION("A block larger than a slab should be refused") {
+    pool->getThreadOwner().bind();
+    REQUIRE_THROWS_AS(pool->allocate(SLAB_POOL_SLAB_SIZE), std::length_error);
+    pool->getThreadOwner().release();
+  }
+
+  SECTION("An orphaned pool should stay alive until its last block is returned") {
+    int alive   = 0;
+    auto object = makePooled<Tracked>(pool, &alive);
+
+    pool->orphan();
+    pool = nullptr;
+
+    REQUIRE(alive == 1);
+    object.reset();
+    REQUIRE(alive == 0);
+  }
+
+  if (pool != nullptr) {
+    pool->orphan();
+  }
+}
+
+} // namespace eventhub
@@ -0,0 +1,36 @@
+#include <thread>
+
+#include "ThreadOwner.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+TEST_CASE("ThreadOwner test", "[thread_owner]") {
+  ThreadOwner owner;
+
+  auto isCurrentThreadElsewhere = [&owner]() {
+    bool result = false;
+    std::thread t([&]() { result = owner.isCurrentThread(); });
+    t.join();
+    return result;
+  };
+
+  SECTION("Unbound objects may be used from any thread") {
+    REQUIRE(owner.isCurrentThread());
+    REQUIRE(isCurrentThreadElsewhere());
+  }
+
+  SECTION("Bound objects only belong to the binding thread") {
+    owner.bind();
+    REQUIRE(owner.isCurrentThread());
+    REQUIRE_FALSE(isCurrentThreadElsewhere());
+  }
+
+  SECTION("Released objects may be used from any thread again") {
+    owner.bind();
+    owner.release();
+    REQUIRE(isCurrentThreadElsewhere());
+  }
+}
+
+} // namespace eventhub
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TimerWheel.hpp"
+#include "EventLoop.hpp"
+#include "catch.hpp"
+
+using namespace eventhub;
+
+namespace {
+std::shared_ptr<TimerCtx> makeTimer(uint64_t fireTick, std::vector<uint64_t>& fired, TimerWheel& wheel) {
+  auto timer       = std::make_shared<TimerCtx>();
+  timer->fire_time = std::chrono::milliseconds(fireTick);
+  timer->repeat    = false;
+  timer->callback  = [&fired, &wheel](TimerCtx* ctx) {
+    fired.push_back(wheel.currentTick());
+  };
+  return timer;
+}
+
+void runUntil(TimerWheel& wheel, uint64_t tick) {
+  TimerWheel::TimerList expired;
+  wheel.advance(tick, expired);
+  for (auto& timer : expired) {
+    timer->callback(timer.get());
+  }
+}
+} // namespace
+
+TEST_CASE("timer wheel", "[timer_wheel]") {
+  const uint64_t start = 1000000;
+  TimerWheel wheel(start);
+  std::vector<uint64_t> fired;
+
+  SECTION("nextExpiry should be 0 without timers") {
+    REQUIRE(wheel.nextExpiry() == 0);
+  }
+
+  SECTION("timers should fire on their tick, not before") {
+    wheel.add(makeTimer(start + 10, fired, wheel));
+
+    REQUIRE(wheel.nextExpiry() == start + 10);
+    runUntil(wheel, start + 9);
+    REQUIRE(fired.empty());
+
+    runUntil(wheel, start + 10);
+    REQUIRE(fired.size() == 1);
+    REQUIRE(wheel.size() == 0);
+  }
+
+  SECTION("timers in higher levels should cascade and fire on time") {
+    const std::vector<uint64_t> delays = {300, 16384, 20000, 1 << 20, (1 << 20) + 12345, uint64_t(3) << 26};
+
+    for (auto delay : delays) {
+      wheel.add(makeTimer(start + delay, fired, wheel));
+    }
+
+    for (std::size_t i = 0; i < delays.size(); i++) {
+      runUntil(wheel, start + delays[i] - 1);
+      REQUIRE(fired.size() == i);
+
+      runUntil(wheel, start + delays[i]);
+      REQUIRE(fired.size() == i + 1);
+      REQUIRE(fired.back() == start + delays[i]);
+    }
+
+    REQUIRE(wheel.size() == 0);
+  }
+
+  SECTION("nextExpiry should never be later than the earliest timer") {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint64_t> dist(1, 5000000);
+    uint64_t earliest = UINT64_MAX;
+
+    for (int i = 0; i < 1000; i++) {
+      const auto fireTick = start + dist(rng);
+      earliest = std::min(earliest, fireTick);
+      wheel.add(makeTimer(fireTick, fired, wheel));
+    }
+
+    REQUIRE(wheel.nextExpiry() <= earliest);
+
+    runUntil(wheel, start + 5000000);
+    REQUIRE(fired.size() == 1000);
+  }
+
+  SECTION("cancelled timers should not fire") {
+    auto timer = makeTimer(start + 50000, fired, wheel);
+    wheel.add(timer);
+    REQUIRE(wheel.size() == 1);
+
+    wheel.cancel(timer.get());
+    REQUIRE(wheel.size() == 0);
+
+    runUntil(wheel, start + 100000);
+    REQUIRE(fired.empty());
+  }
+}
+
+TEST_CASE("timer handles", "[eventloop]") {
+  EventLoop ev;
+  bool timerHasRun = false;
+
+  auto handle = ev.addTimer(10, [&timerHasRun](TimerCtx* ctx) {
+    timerHasRun = true;
+  });
+
+  SECTION("handle should be active until the timer is cancelled") {
+    REQUIRE(handle.active());
+    ev.cancelTimer(handle);
+    REQUIRE(!handle.active());
+    REQUIRE(ev.hasWork() == false);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ev.processTimers();
+    REQUIRE(timerHasRun == false);
+  }
+
+  SECTION("handle should be inactive after the timer has fired") {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ev.processTimers();
+    REQUIRE(timerHasRun == true);
+    REQUIRE(!handle.active());
+
+    // Cancelling a handle to a fired timer is a no-op.
+    ev.cancelTimer(handle);
+  }
+
+  SECTION("a repeating timer should be able to cancel itself through its handle") {
+    int runs = 0;
+    TimerHandle repeating;
+    repeating = ev.addTimer(
+        1, [&](TimerCtx* ctx) {
+          if (++runs == 2) {
+            ev.cancelTimer(repeating);
+          }
+        },
+        true);
+
+    for (int i = 0; i < 10; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      ev.processTimers();
+    }
+
+    REQUIRE(runs == 2);
+  }
+}
@@ -0,0 +1,99 @@
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "TopicManager.hpp"
+#include "TopicMatcher.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+TEST_CASE("TopicMatcher test", "[topic_matcher]") {
+  const std::vector<std::string> filters = {
+    "temperature/kitchen/sensor1",
+    "temperature/+/sensor1",
+    "temperature/#",
+    "temperature/kitchen/#",
+    "v1/+/events/+/supporters/+",
+    "v1/+/#",
+    "+",
+    "test1/+/test",
+    "test",
+    "a//b",
+    "a/#/b"
+  };
+
+  const std::vector<std::string> topics = {
+    "temperature/kitchen/sensor1",
+    "temperature/kitchen/sensor2",
+    "temperature/kitchen",
+    "temperature",
+    "v1/foo/events/bar/supporters/baz",
+    "v1",
+    "v1/baz/foo/bar",
+    "foobar",
+    "foobar/baz",
+    "test1/test",
+    "test1/x/test",
+    "test",
+    "test1",
+    "a//b",
+    "a/b",
+    "a",
+    ""
+  };
+
+  SECTION("Filters should match what isFilterMatched matches") {
+    for (const auto& filter : filters) {
+      TopicMatcher matcher;
+      matcher.add(filter);
+
+      for (const auto& topic : topics) {
+        INFO(topic << " with filter " << filter);
+        REQUIRE(matcher.matches(topic) == TopicManager::isFilterMatched(filter, topic));
+      }
+    }
+  }
+
+  SECTION("A topic should match if any of the filters match") {
+    TopicMatcher matcher;
+    for (const auto& filter : filters) {
+      matcher.add(filter);
+    }
+
+    for (const auto& topic : topics) {
+      bool expected = false;
+      for (const auto& filter : filters) {
+        expected = expected || TopicManager::isFilterMatched(filter, topic);
+      }
+
+      INFO(topic);
+      REQUIRE(matcher.matches(topic) == expected);
+    }
+  }
+
+  SECTION("The closest match should be an equal filter, then the longest one") {
+    TopicMatcher matcher;
+    REQUIRE(matcher.add("#") == 0);
+    REQUIRE(matcher.add("a/+") == 1);
+    REQUIRE(matcher.add("a/b/#") == 2);
+    REQUIRE(matcher.add("a/b") == 3);
+    REQUIRE(matcher.add("a/c") == 4);
+    REQUIRE(matcher.add("+/c") == 5);
+
+    REQUIRE(matcher.findClosestMatch("a/b").value() == 3);
+    REQUIRE(matcher.findClosestMatch("a/b/c").value() == 2);
+    REQUIRE(matcher.findClosestMatch("a/c").value() == 4);
+    REQUIRE(matcher.findClosestMatch("a/d").value() == 1);
+    REQUIRE(matcher.findClosestMatch("b/c").value() == 5);
+    REQUIRE(matcher.findClosestMatch("b").value() == 0);
+  }
+
+  SECTION("Nothing should match an empty matcher") {
+    TopicMatcher matcher;
+    REQUIRE(!matcher.matches("a"));
+    REQUIRE(!matcher.findClosestMatch("a"));
+  }
+}
+
+} // namespace eventhub
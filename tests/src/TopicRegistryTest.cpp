@@ -0,0 +1,85 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TopicRegistry.hpp"
+#include "catch.hpp"
+
+namespace eventhub {
+
+TEST_CASE("TopicRegistry test", "[topic_registry]") {
+  const auto initialSize = TopicRegistry::size();
+
+  SECTION("Interning the same name twice should give the same ID") {
+    InternedTopic a("registry/test1");
+    InternedTopic b("registry/test1");
+    InternedTopic c("registry/test2");
+
+    REQUIRE(a == b);
+    REQUIRE(a.id() == b.id());
+    REQUIRE(a != c);
+    REQUIRE(a.id() != c.id());
+    REQUIRE(c.name() == "registry/test2");
+    REQUIRE(TopicRegistry::size() == initialSize + 2);
+  }
+
+  SECTION("Names should stay interned while a copy refers to them") {
+    InternedTopic copy;
+    REQUIRE(copy.empty());
+
+    {
+      InternedTopic original("registry/test1");
+      copy = original;
+    }
+
+    REQUIRE(copy.name() == "registry/test1");
+    REQUIRE(InternedTopic("registry/test1") == copy);
+    REQUIRE(TopicRegistry::size() == initialSize + 1);
+  }
+
+  SECTION("Names should be removed and IDs reused after the last reference is gone") {
+    TopicId id;
+
+    {
+      InternedTopic topic("registry/test1");
+      InternedTopic moved(std::move(topic));
+      id = moved.id();
+    }
+
+    REQUIRE(TopicRegistry::size() == initialSize);
+
+    // Same name, so same shard and the freed ID is next in line.
+    InternedTopic again("registry/test1");
+    REQUIRE(again.id() == id);
+  }
+
+  SECTION("Threads interning the same names should agree on the IDs") {
+    std::vector<std::vector<TopicId>> ids(4);
+    std::vector<std::thread> threads;
+    const InternedTopic reference("registry/shared");
+
+    for (auto& threadIds : ids) {
+      threads.emplace_back([&threadIds]() {
+        for (int i = 0; i < 1000; i++) {
+          InternedTopic shared("registry/shared");
+          InternedTopic transient("registry/" + std::to_string(i % 10));
+          threadIds.push_back(shared.id());
+        }
+      });
+    }
+
+    for (auto& t : threads) {
+      t.join();
+    }
+
+    for (const auto& threadIds : ids) {
+      REQUIRE(threadIds == std::vector<TopicId>(1000, reference.id()));
+    }
+
+    REQUIRE(TopicRegistry::size() == initialSize + 1);
+  }
+
+  REQUIRE(TopicRegistry::size() == initialSize);
+}
+
+} // namespace eventhub
@@ -1,3 +1,5 @@
+#include <chrono>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <string>
@@ -154,3 +156,48 @@ TEST_CASE("isFilterMatched", "[topic_manager]") {
     }
   }
 }
+
+TEST_CASE("FanoutBudget", "[topic_manager]") {
+  SECTION("Subscriber budget should be exhausted after max deliveries") {
+    FanoutBudget budget(3, std::chrono::microseconds(0));
+
+    for (int i = 0; i < 3; i++) {
+      REQUIRE(budget.exhausted() == false);
+      budget.consume();
+    }
+
+    REQUIRE(budget.exhausted() == true);
+  }
+
+  SECTION("Time budget should be exhausted once the deadline has passed") {
+    FanoutBudget budget(0, std::chrono::microseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // The clock is only checked every 64 deliveries.
+    for (int i = 0; i < 64; i++) {
+      REQUIRE(budget.exhausted() == false);
+      budget.consume();
+    }
+
+    REQUIRE(budget.exhausted() == true);
+  }
+
+  SECTION("Budget without limits should never be exhausted") {
+    FanoutBudget budget(0, std::chrono::microseconds(0));
+
+    for (int i = 0; i < 100000; i++) {
+      budget.consume();
+    }
+
+    REQUIRE(budget.exhausted() == false);
+  }
+}
+
+TEST_CASE("Fan-out queue", "[topic_manager]") {
+  TopicManager topicManager;
+
+  SECTION("Publish to a topic without subscribers should not queue anything") {
+    topicManager.publish(InternedTopic("test/topic1"), "{\"id\": \"1\", \"message\": \"foo\"}");
+    REQUIRE(topicManager.hasPendingFanout() == false);
+  }
+}